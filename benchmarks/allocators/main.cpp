@@ -0,0 +1,111 @@
+/*
+ * Small allocation throughput at 1, 4 and 16 threads. Every thread allocates a batch of mixed
+ * sizes up to 512 bytes and frees it again, once through the global operator new (the thread
+ * local size-class caches) and once through malloc directly. Timings are wall clock per
+ * allocate/free pair on one thread, so flat numbers across thread counts mean linear scaling.
+ */
+
+#include "bench.h"
+
+#include <cstdlib>
+#include <new>
+#include <random>
+#include <thread>
+#include <vector>
+
+using namespace pyroc::bench;
+
+namespace
+{
+constexpr size_t kBatchSize = 1024;
+constexpr size_t kBatches = 256;
+
+struct OperatorNew
+{
+    static void* allocate(size_t size) { return ::operator new(size); }
+    static void free(void* p) { ::operator delete(p); }
+};
+
+struct Malloc
+{
+    static void* allocate(size_t size) { return std::malloc(size); }
+    static void free(void* p) { std::free(p); }
+};
+
+std::vector<size_t> randomSizes(size_t count)
+{
+    std::mt19937 rng(1234);
+    std::uniform_int_distribution<size_t> size(8, 512);
+
+    std::vector<size_t> sizes(count);
+    for (size_t& s : sizes)
+    {
+        s = size(rng);
+    }
+    return sizes;
+}
+
+template <typename Allocator>
+void churn(const std::vector<size_t>& sizes)
+{
+    std::vector<void*> blocks(kBatchSize);
+    for (size_t batch = 0; batch < kBatches; ++batch)
+    {
+        for (size_t i = 0; i < kBatchSize; ++i)
+        {
+            blocks[i] = Allocator::allocate(sizes[i]);
+        }
+        doNotOptimize(blocks);
+
+        // Freed in a different order than allocated, as real containers do
+        for (size_t i = 0; i < kBatchSize; i += 2)
+        {
+            Allocator::free(blocks[i]);
+        }
+        for (size_t i = 1; i < kBatchSize; i += 2)
+        {
+            Allocator::free(blocks[i]);
+        }
+    }
+}
+
+template <typename Allocator>
+double measureThreads(const std::vector<size_t>& sizes, size_t threadCount)
+{
+    return measure(kBatchSize * kBatches,
+                   [&]
+                   {
+                       std::vector<std::thread> threads;
+                       threads.reserve(threadCount);
+                       for (size_t t = 0; t < threadCount; ++t)
+                       {
+                           threads.emplace_back(churn<Allocator>, std::cref(sizes));
+                       }
+                       for (std::thread& thread : threads)
+                       {
+                           thread.join();
+                       }
+                   });
+}
+}  // namespace
+
+int main()
+{
+    const std::vector<size_t> sizes = randomSizes(kBatchSize);
+
+    std::printf("%u hardware threads\n", std::thread::hardware_concurrency());
+
+    for (const size_t threadCount : {size_t{1}, size_t{4}, size_t{16}})
+    {
+        const double system = measureThreads<Malloc>(sizes, threadCount);
+        const double cached = measureThreads<OperatorNew>(sizes, threadCount);
+
+        char name[64];
+        std::snprintf(name, sizeof(name), "malloc, %zu threads", threadCount);
+        report(name, system);
+        std::snprintf(name, sizeof(name), "operator new, %zu threads", threadCount);
+        report(name, cached, system);
+    }
+
+    return 0;
+}
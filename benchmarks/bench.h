@@ -0,0 +1,56 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+
+/*
+ * Minimal timing helpers shared by the benchmark targets. Build them with optimizations on,
+ * numbers from a debug build say nothing.
+ */
+
+namespace pyroc::bench
+{
+// Makes value observable, so the work producing it is not optimized away
+template <typename T>
+inline void doNotOptimize(const T& value)
+{
+    asm volatile("" : : "m"(value) : "memory");
+}
+
+/*
+ * Best of runs timings of fn after one warm up call, in nanoseconds per item when fn processes
+ * items items per call.
+ */
+template <typename Fn>
+double measure(size_t items, Fn&& fn, int runs = 5)
+{
+    fn();
+
+    double best = 0.0;
+    for (int run = 0; run < runs; ++run)
+    {
+        const auto start = std::chrono::steady_clock::now();
+        fn();
+        const auto end = std::chrono::steady_clock::now();
+
+        const double ns = std::chrono::duration<double, std::nano>(end - start).count();
+        best = run == 0 ? ns : std::min(best, ns);
+    }
+
+    return best / static_cast<double>(items);
+}
+
+// One line per case, with the speedup over baselineNs when one is given
+inline void report(const char* name, double ns, double baselineNs = 0.0)
+{
+    if (baselineNs > 0.0)
+    {
+        std::printf("%-40s %10.3f ns %8.2fx\n", name, ns, baselineNs / ns);
+    }
+    else
+    {
+        std::printf("%-40s %10.3f ns\n", name, ns);
+    }
+}
+}  // namespace pyroc::bench
@@ -0,0 +1,170 @@
+/*
+ * Frustum culling throughput at 10k, 100k and 1M objects scattered around the camera. The
+ * baseline tests one object at a time through isSphereVisible/isAabbVisible, the batch versions
+ * fill the visibility bitmask.
+ */
+
+#include "bench.h"
+
+#include "core/camera.h"
+#include "core/frustum.h"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <random>
+#include <vector>
+
+using namespace pyroc::core;
+using namespace pyroc::math;
+using namespace pyroc::bench;
+
+namespace
+{
+struct Bounds
+{
+    std::vector<float> x;
+    std::vector<float> y;
+    std::vector<float> z;
+    std::vector<float> radii;
+    std::vector<float> ex;
+    std::vector<float> ey;
+    std::vector<float> ez;
+
+    soa3<const float> centers() const { return {x, y, z}; }
+    soa3<const float> extents() const { return {ex, ey, ez}; }
+};
+
+Bounds randomBounds(std::mt19937& rng, size_t count)
+{
+    // Roughly a tenth of the objects land inside the frustum
+    std::uniform_real_distribution<float> position(-100.0f, 100.0f);
+    std::uniform_real_distribution<float> size(0.1f, 2.0f);
+
+    Bounds bounds;
+    for (auto* v : {&bounds.x, &bounds.y, &bounds.z, &bounds.radii, &bounds.ex, &bounds.ey,
+                    &bounds.ez})
+    {
+        v->resize(count);
+    }
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        bounds.x[i] = position(rng);
+        bounds.y[i] = position(rng);
+        bounds.z[i] = position(rng);
+        bounds.ex[i] = size(rng);
+        bounds.ey[i] = size(rng);
+        bounds.ez[i] = size(rng);
+        bounds.radii[i] = std::sqrt(bounds.ex[i] * bounds.ex[i] + bounds.ey[i] * bounds.ey[i]
+                                    + bounds.ez[i] * bounds.ez[i]);
+    }
+
+    return bounds;
+}
+
+size_t countVisible(const std::vector<uint64_t>& visibility)
+{
+    size_t count = 0;
+    for (const uint64_t word : visibility)
+    {
+        count += static_cast<size_t>(std::popcount(word));
+    }
+    return count;
+}
+
+void benchCount(const Frustum& frustum, std::mt19937& rng, size_t count)
+{
+    const Bounds bounds = randomBounds(rng, count);
+    std::vector<uint64_t> visibility((count + 63) / 64);
+
+    const double sphereScalar = measure(count,
+                                        [&]
+                                        {
+                                            std::fill(visibility.begin(), visibility.end(), 0);
+                                            for (size_t i = 0; i < count; ++i)
+                                            {
+                                                const vec3 center{bounds.x[i], bounds.y[i],
+                                                                  bounds.z[i]};
+                                                if (isSphereVisible(frustum, center,
+                                                                    bounds.radii[i]))
+                                                {
+                                                    visibility[i / 64] |= uint64_t{1} << (i % 64);
+                                                }
+                                            }
+                                            doNotOptimize(visibility);
+                                        });
+    const size_t sphereScalarVisible = countVisible(visibility);
+
+    const double sphereBatch = measure(count,
+                                       [&]
+                                       {
+                                           cullSpheres(frustum, bounds.centers(), bounds.radii,
+                                                       visibility);
+                                           doNotOptimize(visibility);
+                                       });
+    const size_t sphereBatchVisible = countVisible(visibility);
+
+    const double aabbScalar = measure(count,
+                                      [&]
+                                      {
+                                          std::fill(visibility.begin(), visibility.end(), 0);
+                                          for (size_t i = 0; i < count; ++i)
+                                          {
+                                              const vec3 center{bounds.x[i], bounds.y[i],
+                                                                bounds.z[i]};
+                                              const vec3 extents{bounds.ex[i], bounds.ey[i],
+                                                                 bounds.ez[i]};
+                                              if (isAabbVisible(frustum, center, extents))
+                                              {
+                                                  visibility[i / 64] |= uint64_t{1} << (i % 64);
+                                              }
+                                          }
+                                          doNotOptimize(visibility);
+                                      });
+    const size_t aabbScalarVisible = countVisible(visibility);
+
+    const double aabbBatch = measure(count,
+                                     [&]
+                                     {
+                                         cullAabbs(frustum, bounds.centers(), bounds.extents(),
+                                                   visibility);
+                                         doNotOptimize(visibility);
+                                     });
+    const size_t aabbBatchVisible = countVisible(visibility);
+
+    std::printf("%zu objects, %zu/%zu spheres and %zu/%zu boxes visible\n", count,
+                sphereBatchVisible, sphereScalarVisible, aabbBatchVisible, aabbScalarVisible);
+    report("  spheres one at a time", sphereScalar);
+    report("  cullSpheres", sphereBatch, sphereScalar);
+    report("  boxes one at a time", aabbScalar);
+    report("  cullAabbs", aabbBatch, aabbScalar);
+}
+}  // namespace
+
+int main()
+{
+    const CameraCreateInfo cameraCreateInfo = {
+        .eye = vec3{0.0f, 0.0f, 0.0f},
+        .center = vec3{0.0f, 0.0f, -1.0f},
+        .up = vec3{0.0f, 1.0f, 0.0f},
+        .fovY = 60.0f,
+        .aspect = 16.0f / 9.0f,
+        .nearPlane = 0.1f,
+        .farPlane = 150.0f,
+    };
+
+    Camera camera;
+    camera.init(&cameraCreateInfo);
+
+    const Frustum frustum = makeFrustum(camera);
+
+    std::mt19937 rng(1234);
+
+    for (const size_t count : {size_t{10'000}, size_t{100'000}, size_t{1'000'000}})
+    {
+        benchCount(frustum, rng, count);
+    }
+
+    return 0;
+}
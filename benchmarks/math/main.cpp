@@ -0,0 +1,171 @@
+/*
+ * Math throughput. The generic templates are called explicitly as the baseline, so one build
+ * shows the scalar path next to the SIMD specializations picked for vec4/mat4. The inverse
+ * variants are measured against the full inverse.
+ */
+
+#include "bench.h"
+
+#include "math/math.h"
+
+#include <random>
+#include <vector>
+
+using namespace pyroc::math;
+using namespace pyroc::bench;
+
+namespace
+{
+constexpr size_t kCount = 4096;
+constexpr size_t kRepeats = 64;
+
+std::vector<mat4> randomMatrices(std::mt19937& rng, size_t count)
+{
+    std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+
+    std::vector<mat4> matrices(count);
+    for (mat4& m : matrices)
+    {
+        for (size_t i = 0; i < 4; ++i)
+        {
+            for (size_t j = 0; j < 4; ++j)
+            {
+                m[i][j] = dist(rng);
+            }
+        }
+    }
+    return matrices;
+}
+
+std::vector<vec4> randomVectors(std::mt19937& rng, size_t count)
+{
+    std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+
+    std::vector<vec4> vectors(count);
+    for (vec4& v : vectors)
+    {
+        v = vec4{dist(rng), dist(rng), dist(rng), dist(rng)};
+    }
+    return vectors;
+}
+
+void benchMatMul(const std::vector<mat4>& a, const std::vector<mat4>& b, std::vector<mat4>& out)
+{
+    const double generic = measure(kCount * kRepeats,
+                                   [&]
+                                   {
+                                       for (size_t r = 0; r < kRepeats; ++r)
+                                       {
+                                           for (size_t i = 0; i < kCount; ++i)
+                                           {
+                                               out[i] = operator*<4, 4, 4, float>(a[i], b[i]);
+                                           }
+                                           doNotOptimize(out);
+                                       }
+                                   });
+
+    const double specialized = measure(kCount * kRepeats,
+                                       [&]
+                                       {
+                                           for (size_t r = 0; r < kRepeats; ++r)
+                                           {
+                                               for (size_t i = 0; i < kCount; ++i)
+                                               {
+                                                   out[i] = a[i] * b[i];
+                                               }
+                                               doNotOptimize(out);
+                                           }
+                                       });
+
+    report("mat4 * mat4 generic", generic);
+    report("mat4 * mat4", specialized, generic);
+}
+
+void benchMatVec(const std::vector<mat4>& m, const std::vector<vec4>& v, std::vector<vec4>& out)
+{
+    const double generic = measure(kCount * kRepeats,
+                                   [&]
+                                   {
+                                       for (size_t r = 0; r < kRepeats; ++r)
+                                       {
+                                           for (size_t i = 0; i < kCount; ++i)
+                                           {
+                                               out[i] = operator*<4, 4, float>(m[i], v[i]);
+                                           }
+                                           doNotOptimize(out);
+                                       }
+                                   });
+
+    const double specialized = measure(kCount * kRepeats,
+                                       [&]
+                                       {
+                                           for (size_t r = 0; r < kRepeats; ++r)
+                                           {
+                                               for (size_t i = 0; i < kCount; ++i)
+                                               {
+                                                   out[i] = m[i] * v[i];
+                                               }
+                                               doNotOptimize(out);
+                                           }
+                                       });
+
+    report("mat4 * vec4 generic", generic);
+    report("mat4 * vec4", specialized, generic);
+}
+
+// The specialized inverses against the full inverse they replace for affine and rigid transforms
+template <typename Fn>
+double measureInverse(const std::vector<mat4>& m, std::vector<mat4>& out, Fn&& fn)
+{
+    return measure(kCount * kRepeats,
+                   [&]
+                   {
+                       for (size_t r = 0; r < kRepeats; ++r)
+                       {
+                           for (size_t i = 0; i < kCount; ++i)
+                           {
+                               out[i] = fn(m[i]);
+                           }
+                           doNotOptimize(out);
+                       }
+                   });
+}
+
+void benchInverse(const std::vector<mat4>& m, std::vector<mat4>& out)
+{
+    const double full = measureInverse(m, out, [](const mat4& x) { return inverse(x); });
+    const double affine = measureInverse(m, out, [](const mat4& x) { return inverseAffine(x); });
+    const double rigid = measureInverse(m, out, [](const mat4& x) { return inverseRigid(x); });
+    const double normal =
+        measureInverse(m, out, [](const mat4& x) { return inverseTranspose(x); });
+
+    report("inverse", full);
+    report("inverseAffine", affine, full);
+    report("inverseRigid", rigid, full);
+    report("inverseTranspose", normal, full);
+}
+}  // namespace
+
+int main()
+{
+#ifdef PYROC_MATH_SIMD
+    std::printf("SIMD backend enabled\n");
+#else
+    std::printf("SIMD backend disabled, both columns run the generic templates\n");
+#endif
+
+    std::mt19937 rng(1234);
+
+    const std::vector<mat4> a = randomMatrices(rng, kCount);
+    const std::vector<mat4> b = randomMatrices(rng, kCount);
+    const std::vector<vec4> v = randomVectors(rng, kCount);
+
+    std::vector<mat4> matrices(kCount);
+    std::vector<vec4> vectors(kCount);
+
+    benchMatMul(a, b, matrices);
+    benchMatVec(a, v, vectors);
+    benchInverse(a, matrices);
+
+    return 0;
+}
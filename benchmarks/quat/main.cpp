@@ -0,0 +1,149 @@
+/*
+ * TRS composition throughput at 10k and 100k transforms. The baseline builds each rotation
+ * matrix from cos/sin of a yaw angle per element, the way the basic demo used to, then scales
+ * and translates it. The quaternion paths compose the same transforms through toMat4 one at a
+ * time and through composeTransforms.
+ */
+
+#include "bench.h"
+
+#include "math/batch.h"
+#include "math/math.h"
+
+#include <algorithm>
+#include <cmath>
+#include <numbers>
+#include <random>
+#include <vector>
+
+using namespace pyroc::math;
+using namespace pyroc::bench;
+
+namespace
+{
+struct Transforms
+{
+    std::vector<float> angles;
+    std::vector<fquat> rotations;
+    std::vector<vec3> translations;
+    std::vector<vec3> scales;
+};
+
+Transforms randomTransforms(std::mt19937& rng, size_t count)
+{
+    std::uniform_real_distribution<float> angle(-std::numbers::pi_v<float>,
+                                                std::numbers::pi_v<float>);
+    std::uniform_real_distribution<float> position(-100.0f, 100.0f);
+    std::uniform_real_distribution<float> size(0.5f, 2.0f);
+
+    Transforms transforms;
+    transforms.angles.resize(count);
+    transforms.rotations.resize(count);
+    transforms.translations.resize(count);
+    transforms.scales.resize(count);
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        transforms.angles[i] = angle(rng);
+        transforms.rotations[i] = angleAxis(transforms.angles[i], vec3{0.0f, 1.0f, 0.0f});
+        transforms.translations[i] = vec3{position(rng), position(rng), position(rng)};
+        transforms.scales[i] = vec3{size(rng), size(rng), size(rng)};
+    }
+
+    return transforms;
+}
+
+// Largest element difference, so a broken path shows up next to its timing
+float maxDifference(const std::vector<mat4>& a, const std::vector<mat4>& b)
+{
+    float result = 0.0f;
+    for (size_t i = 0; i < a.size(); ++i)
+    {
+        for (size_t c = 0; c < 4; ++c)
+        {
+            for (size_t r = 0; r < 4; ++r)
+            {
+                result = std::max(result, std::abs(a[i][c][r] - b[i][c][r]));
+            }
+        }
+    }
+    return result;
+}
+
+void benchCount(std::mt19937& rng, size_t count)
+{
+    const Transforms transforms = randomTransforms(rng, count);
+    std::vector<mat4> expected(count);
+    std::vector<mat4> out(count);
+
+    const double trig = measure(count,
+                                [&]
+                                {
+                                    for (size_t i = 0; i < count; ++i)
+                                    {
+                                        const float angle = transforms.angles[i];
+                                        const vec3& s = transforms.scales[i];
+
+                                        mat4 m = mat4::identity();
+                                        m[0][0] = std::cos(angle) * s.x;
+                                        m[0][2] = -std::sin(angle) * s.x;
+                                        m[1][1] = s.y;
+                                        m[2][0] = std::sin(angle) * s.z;
+                                        m[2][2] = std::cos(angle) * s.z;
+                                        m[3][0] = transforms.translations[i].x;
+                                        m[3][1] = transforms.translations[i].y;
+                                        m[3][2] = transforms.translations[i].z;
+                                        expected[i] = m;
+                                    }
+                                    doNotOptimize(expected);
+                                });
+
+    const double quatScalar = measure(count,
+                                      [&]
+                                      {
+                                          for (size_t i = 0; i < count; ++i)
+                                          {
+                                              const vec3& s = transforms.scales[i];
+
+                                              mat4 m = toMat4(transforms.rotations[i]);
+                                              m[0] = s.x * m[0];
+                                              m[1] = s.y * m[1];
+                                              m[2] = s.z * m[2];
+                                              m[3] = vec4{transforms.translations[i].x,
+                                                          transforms.translations[i].y,
+                                                          transforms.translations[i].z, 1.0f};
+                                              out[i] = m;
+                                          }
+                                          doNotOptimize(out);
+                                      });
+    const float quatScalarError = maxDifference(expected, out);
+
+    const double batch = measure(count,
+                                 [&]
+                                 {
+                                     composeTransforms(transforms.rotations,
+                                                       transforms.translations, transforms.scales,
+                                                       out);
+                                     doNotOptimize(out);
+                                 });
+    const float batchError = maxDifference(expected, out);
+
+    std::printf("%zu transforms, max difference %g (toMat4) and %g (composeTransforms)\n", count,
+                static_cast<double>(quatScalarError), static_cast<double>(batchError));
+    report("  cos/sin per element", trig);
+    report("  toMat4 one at a time", quatScalar, trig);
+    report("  composeTransforms", batch, trig);
+}
+}  // namespace
+
+int main()
+{
+    std::mt19937 rng(1234);
+
+    for (const size_t count : {size_t{10'000}, size_t{100'000}})
+    {
+        benchCount(rng, count);
+    }
+
+    return 0;
+}
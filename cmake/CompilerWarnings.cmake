@@ -50,9 +50,10 @@ function(set_project_warnings project_name)
     message(AUTHOR_WARNING "No compiler warnings set for '${CMAKE_CXX_COMPILER_ID}' compiler.")
   endif()
 
-  target_compile_options(${PROJECT_NAME} PUBLIC ${PROJECT_WARNINGS})
-
-  if(NOT TARGET ${PROJECT_NAME})
-    message(AUTHOR_WARNING "${PROJECT_NAME} is not a target, thus no compiler warning were added.")
+  if(NOT TARGET ${project_name})
+    message(AUTHOR_WARNING "${project_name} is not a target, thus no compiler warning were added.")
+    return()
   endif()
+
+  target_compile_options(${project_name} PUBLIC ${PROJECT_WARNINGS})
 endfunction()
\ No newline at end of file
@@ -3,6 +3,13 @@
 #
 
 option(${PROJECT_NAME}_WARNINGS_AS_ERRORS "Treat compiler warnings as errors." ON)
+option(${PROJECT_NAME}_ENABLE_SIMD "Use the SSE/NEON specializations for float vec4/mat4 math." ON)
+option(${PROJECT_NAME}_NATIVE_ARCH "Target the instruction set of the build machine (enables AVX/FMA paths)." OFF)
+option(${PROJECT_NAME}_ENABLE_AVX2 "Target AVX2/FMA for the 8-wide batch math kernels." OFF)
+option(${PROJECT_NAME}_TRACK_ALLOCATIONS "Record allocation statistics in the global operator new." OFF)
+option(${PROJECT_NAME}_ENABLE_X11 "Build X11 presentation support on Linux." ON)
+option(${PROJECT_NAME}_ENABLE_WAYLAND "Build Wayland presentation support on Linux." ON)
+option(${PROJECT_NAME}_SHADER_HOT_RELOAD "Recompile and swap demo shaders edited while the demo runs (Linux)." OFF)
 
 # Generate compile_commands.json for clang based tools
 set(CMAKE_EXPORT_COMPILE_COMMANDS ON)
\ No newline at end of file
@@ -1,4 +1,7 @@
+#include <algorithm>
+#include <cstddef>
 #include <iostream>
+#include <span>
 
 #include "shaders/basic.h"
 
@@ -26,6 +29,12 @@ struct Vertex
     vec3 colour;
 };
 
+// Vertex input state comes from the shader's reflection, which packs the attributes tightly in
+// location order: pos at location 0, colour at location 1 right behind it
+static_assert(offsetof(Vertex, pos) == 0);
+static_assert(offsetof(Vertex, colour) == sizeof(vec3));
+static_assert(sizeof(Vertex) == 2 * sizeof(vec3));
+
 class App
 {
   public:
@@ -66,9 +75,9 @@ class App
         return vk::Result::eSuccess;
     }
 
-    void destroyFramebuffers()
+    void destroyFramebuffers(std::vector<vk::Framebuffer>& framebuffers)
     {
-        for (auto framebuffer : mFramebuffers)
+        for (auto framebuffer : framebuffers)
         {
             if (framebuffer == nullptr)
             {
@@ -76,18 +85,46 @@ class App
             }
             mDevice.destroyFramebuffer(framebuffer);
         }
+        framebuffers.clear();
     }
 
-    void recreateSwapchain()
+    // Resize and focus events only mark the swapchain, drawFrame recreates it once per frame
+    void requestSwapchainRecreation() { mSwapchainDirty = true; }
+
+    // Destroys framebuffers and swapchains retired by frames that have since finished
+    void releaseRetiredSwapchains()
     {
-        auto res = mDevice.waitIdle();
-        if (res != vk::Result::eSuccess)
+        std::erase_if(mRetiredFramebuffers,
+                      [this](RetiredFramebuffers& retired)
+                      {
+                          if (mDevice.getFenceStatus(retired.fence) != vk::Result::eSuccess)
+                          {
+                              return false;
+                          }
+                          destroyFramebuffers(retired.framebuffers);
+                          return true;
+                      });
+
+        pyroc::backend::vulkan::releaseRetiredSwapchains(mCtx, mSurface);
+    }
+
+    /*
+     * retireFence is that of the last frame submitted, the one frame that may still be rendering
+     * to the old images. Their framebuffers and views go once it signals, nothing waits here.
+     */
+    void recreateSwapchain(vk::Fence retireFence)
+    {
+        mSwapchainDirty = false;
+
+        if (!mFramebuffers.empty())
         {
-            abort();
+            mRetiredFramebuffers.push_back({
+                .framebuffers = std::move(mFramebuffers),
+                .fence = retireFence,
+            });
+            mFramebuffers.clear();
         }
 
-        destroyFramebuffers();
-
         int32_t width, height;
         glfwGetFramebufferSize(mWindow->window(), &width, &height);
         std::cout << "Recreating swapchain with size: " << width << "x" << height << std::endl;
@@ -104,9 +141,20 @@ class App
                 .width = static_cast<uint32_t>(width),
                 .height =  static_cast<uint32_t>(height),
             },
+            .retireFence = retireFence,
         };
 
-        res = recreateSurface(mCtx, &recreateInfo, mSurface);
+        auto res = recreateSurface(mCtx, &recreateInfo, mSurface);
+        if (res != vk::Result::eSuccess)
+        {
+            abort();
+        }
+
+        if (mSurface.extent.width != 0 && mSurface.extent.height != 0)
+        {
+            mCamera.setAspect(static_cast<float>(mSurface.extent.width)
+                              / static_cast<float>(mSurface.extent.height));
+        }
 
         res = createFramebuffers();
         if (res != vk::Result::eSuccess)
@@ -126,7 +174,8 @@ class App
                                                          .extent = vk::Extent2D{
                                                              .width = mWindow->width(),
                                                              .height = mWindow->height(),
-                                                         }};
+                                                         },
+                                                         .retireFence = nullptr};
 
             const auto res = createSurface(mCtx, &surfaceCreateInfo, mSurface);
 
@@ -137,112 +186,36 @@ class App
             }
         }
 
-        mVs = createShaderFromFile(mDevice, "demos/basic/shaders/basic.vert.bin");
-        mPs = createShaderFromFile(mDevice, "demos/basic/shaders/basic.frag.bin");
-
-        const vk::PipelineShaderStageCreateInfo vsStageInfo = {
-            .stage = vk::ShaderStageFlagBits::eVertex,
-            .module = mVs,
-            .pName = "main",
-        };
-
-        const vk::PipelineShaderStageCreateInfo psStageInfo = {
-            .stage = vk::ShaderStageFlagBits::eFragment,
-            .module = mPs,
-            .pName = "main",
-        };
-
-        const vk::PipelineShaderStageCreateInfo shaderStages[] = {vsStageInfo, psStageInfo};
-
-        std::vector<vk::DynamicState> dynamicStates = {
-            vk::DynamicState::eViewport,
-            vk::DynamicState::eScissor,
-        };
-
-        const vk::PipelineDynamicStateCreateInfo dynamicStateInfo
-            = {.dynamicStateCount = static_cast<uint32_t>(dynamicStates.size()),
-               .pDynamicStates = dynamicStates.data()};
-
-        const vk::VertexInputBindingDescription vertexBindingDescription = {
-            .binding = IN_BINDING_VERTEX,
-            .stride = sizeof(Vertex),
-            .inputRate = vk::VertexInputRate::eVertex,
-        };
-
-        const vk::VertexInputAttributeDescription attributeDescriptions[2]
-            = {{
-                   .location = IN_VERTEX_POSITION,
-                   .binding = IN_BINDING_VERTEX,
-                   .format = vk::Format::eR32G32B32Sfloat,
-                   .offset = offsetof(Vertex, pos),
-               },
-               {.location = IN_VERTEX_COLOUR,
-                .binding = IN_BINDING_VERTEX,
-                .format = vk::Format::eR32G32B32Sfloat,
-                .offset = offsetof(Vertex, colour)}};
-
-        const vk::PipelineVertexInputStateCreateInfo vertexInputInfo = {
-            .vertexBindingDescriptionCount = 1,
-            .pVertexBindingDescriptions = &vertexBindingDescription,
-            .vertexAttributeDescriptionCount = 2,
-            .pVertexAttributeDescriptions = attributeDescriptions,
-        };
-
-        const vk::PipelineInputAssemblyStateCreateInfo inputAssemblyInfo = {
-            .topology = vk::PrimitiveTopology::eTriangleList,
-            .primitiveRestartEnable = vk::False,
-        };
-
-        const vk::PipelineViewportStateCreateInfo viewportInfo = {
-            .viewportCount = 1,
-            .scissorCount = 1,
-        };
-
-        const vk::PipelineRasterizationStateCreateInfo rasterInfo = {
-            .depthClampEnable = vk::False,
-            .rasterizerDiscardEnable = vk::False,
-            .polygonMode = vk::PolygonMode::eLine,
-            .cullMode = vk::CullModeFlagBits::eNone,
-            .frontFace = vk::FrontFace::eCounterClockwise,
-            .depthBiasEnable = vk::False,
-            .lineWidth = 1.0f,
-        };
+        {
+            ShaderArchive archive;
 
-        const vk::PipelineMultisampleStateCreateInfo msaaInfo = {
-            .rasterizationSamples = vk::SampleCountFlagBits::e1,
-            .sampleShadingEnable = vk::False,
-        };
+            vk::Result res = archive.open("demos/basic/shaders.pak");
+            if (res != vk::Result::eSuccess)
+            {
+                return res;
+            }
 
-        const vk::PipelineColorBlendAttachmentState colorAttachmentBlend = {
-            .blendEnable = vk::False,
-            .colorWriteMask = vk::ColorComponentFlagBits::eR | vk::ColorComponentFlagBits::eG
-                              | vk::ColorComponentFlagBits::eB | vk::ColorComponentFlagBits::eA,
-        };
+            res = mCtx->shaders().load(archive, "basic.vert", mVs, &mVsReflection);
+            if (res != vk::Result::eSuccess)
+            {
+                return res;
+            }
 
-        const vk::PipelineColorBlendStateCreateInfo colorBlendInfo = {
-            .logicOpEnable = vk::False,
-            .attachmentCount = 1,
-            .pAttachments = &colorAttachmentBlend,
-        };
+            res = mCtx->shaders().load(archive, "basic.frag", mPs, &mPsReflection);
+            if (res != vk::Result::eSuccess)
+            {
+                return res;
+            }
+        }
 
         {
-            vk::PushConstantRange pushConstantRange = {
-                .stageFlags = vk::ShaderStageFlagBits::eVertex,
-                .offset = 0,
-                .size = sizeof(PushConstants),
-            };
-
-            vk::PipelineLayoutCreateInfo layoutInfo = {
-                .pushConstantRangeCount = 1,
-                .pPushConstantRanges = &pushConstantRange,
-            };
+            const ShaderReflection* stages[] = {&mVsReflection, &mPsReflection};
 
-            const auto [res, handle] = mDevice.createPipelineLayout(layoutInfo);
+            const auto res = mCtx->layouts().get(stages, mPipelineLayout);
             if (res != vk::Result::eSuccess)
             {
                 return res;
             }
-            mPipelineLayout = handle;
         }
 
         const vk::AttachmentDescription colorAttachment = {
@@ -295,28 +268,34 @@ class App
         }
 
         {
-            const vk::GraphicsPipelineCreateInfo pipelineInfo = {
-                .stageCount = 2,
-                .pStages = shaderStages,
-                .pVertexInputState = &vertexInputInfo,
-                .pInputAssemblyState = &inputAssemblyInfo,
-                .pViewportState = &viewportInfo,
-                .pRasterizationState = &rasterInfo,
-                .pMultisampleState = &msaaInfo,
-                .pDepthStencilState = nullptr,
-                .pColorBlendState = &colorBlendInfo,
-                .pDynamicState = &dynamicStateInfo,
-                .layout = mPipelineLayout,
+            mPipelineDesc = GraphicsPipelineDesc{
+                .vertexShader = mVs,
+                .fragmentShader = mPs,
+                .polygonMode = vk::PolygonMode::eLine,
+                .colorAttachmentCount = 1,
+                .colorFormats = {mSurface.format},
+                .layout = mPipelineLayout.layout,
                 .renderPass = mRenderPass,
                 .subpass = 0,
             };
+            {
+                const auto res = setVertexInputs(mVsReflection, IN_BINDING_VERTEX, mPipelineDesc);
+                if (res != vk::Result::eSuccess)
+                {
+                    return res;
+                }
+            }
 
-            const auto [res, handle] = mDevice.createGraphicsPipeline(nullptr, pipelineInfo);
+            const auto res = mCtx->pipelines().get(mPipelineDesc, mPipeline);
             if (res != vk::Result::eSuccess)
             {
                 return res;
             }
-            mPipeline = handle;
+
+#ifdef PYROC_SHADER_HOT_RELOAD
+            mPendingPipelineDesc = mPipelineDesc;
+            mPendingPipelineLayout = mPipelineLayout;
+#endif
         }
 
         {
@@ -428,10 +407,8 @@ class App
             };
 
             {
-                const auto res = createBuffer(
-                    mCtx, sizeof(verts),
-                    vk::BufferUsageFlagBits::eTransferDst | vk::BufferUsageFlagBits::eVertexBuffer,
-                    vk::MemoryPropertyFlagBits::eDeviceLocal, mVertexBuffer);
+                const auto res = mCtx->uploadQueue().createTarget(
+                    sizeof(verts), vk::BufferUsageFlagBits::eVertexBuffer, mVertexBuffer);
                 if (res != vk::Result::eSuccess)
                 {
                     return res;
@@ -439,8 +416,8 @@ class App
             }
 
             {
-                const auto res = copyBufferBlocking(mCtx, mUpdateCommandBuffers[0], sizeof(verts),
-                                                    verts, 0, mVertexBuffer);
+                const auto res = mCtx->uploadQueue().upload(verts, sizeof(verts), mVertexBuffer,
+                                                            0, mMeshUploadToken);
                 if (res != vk::Result::eSuccess)
                 {
                     return res;
@@ -467,10 +444,8 @@ class App
             };
             // clang-format on
             {
-                const auto res = createBuffer(
-                    mCtx, sizeof(indices),
-                    vk::BufferUsageFlagBits::eTransferDst | vk::BufferUsageFlagBits::eIndexBuffer,
-                    vk::MemoryPropertyFlagBits::eDeviceLocal, mIndexBuffer);
+                const auto res = mCtx->uploadQueue().createTarget(
+                    sizeof(indices), vk::BufferUsageFlagBits::eIndexBuffer, mIndexBuffer);
                 if (res != vk::Result::eSuccess)
                 {
                     return res;
@@ -478,8 +453,8 @@ class App
             }
 
             {
-                const auto res = copyBufferBlocking(mCtx, mUpdateCommandBuffers[0], sizeof(indices),
-                                                    indices, 0, mIndexBuffer);
+                const auto res = mCtx->uploadQueue().upload(indices, sizeof(indices),
+                                                            mIndexBuffer, 0, mMeshUploadToken);
                 if (res != vk::Result::eSuccess)
                 {
                     return res;
@@ -488,7 +463,16 @@ class App
         }
 
         {
-            mCamera = {
+            // The mesh copies run on the transfer queue, the first frame waits on them
+            const auto res = mCtx->uploadQueue().submit();
+            if (res != vk::Result::eSuccess)
+            {
+                return res;
+            }
+        }
+
+        {
+            const pyroc::core::CameraCreateInfo cameraCreateInfo = {
                 .eye = vec3{5.0f, 0.0f, 5.0f},
                 .center = vec3{0.0f, 0.0f, 0.0f},
                 .up = vec3{0.0f, 1.0f, 0.0f},
@@ -499,10 +483,33 @@ class App
                 .farPlane = 100.0f,
             };
 
-            mViewMatrix = mCamera.viewMatrix();
-            mProjMatrix = mCamera.projectionMatrix();
+            mCamera.init(&cameraCreateInfo);
         }
 
+#ifdef PYROC_SHADER_HOT_RELOAD
+        {
+            const ShaderReloaderCreateInfo reloaderCreateInfo = {
+                .pCompilerPath = PYROC_GLSLC,
+                .pTargetEnv = "vulkan1.3",
+            };
+
+            // The demo runs without it, shaders just stay as built
+            auto res = mShaderReloader.init(mCtx, &reloaderCreateInfo);
+            if (res == vk::Result::eSuccess)
+            {
+                res = mShaderReloader.watch(PYROC_SHADER_SOURCE_DIR "/basic.vert", mVsReloadId);
+            }
+            if (res == vk::Result::eSuccess)
+            {
+                res = mShaderReloader.watch(PYROC_SHADER_SOURCE_DIR "/basic.frag", mPsReloadId);
+            }
+            if (res != vk::Result::eSuccess)
+            {
+                std::cerr << "Shader hot reload unavailable: " << vk::to_string(res) << std::endl;
+            }
+        }
+#endif
+
         return vk::Result::eSuccess;
     }
 
@@ -517,20 +524,197 @@ class App
             mDevice.destroySemaphore(cmd.imageAvailableSemaphore);
         }
 
-        destroyFramebuffers();
+        for (RetiredFramebuffers& retired : mRetiredFramebuffers)
+        {
+            destroyFramebuffers(retired.framebuffers);
+        }
+        mRetiredFramebuffers.clear();
+        destroyFramebuffers(mFramebuffers);
 
         mDevice.destroyCommandPool(mCommandPool);
 
-        mDevice.destroyPipeline(mPipeline);
-        mDevice.destroyRenderPass(mRenderPass);
-        mDevice.destroy(mPipelineLayout);
+#ifdef PYROC_SHADER_HOT_RELOAD
+        mShaderReloader.destroy();
 
-        mDevice.destroyShaderModule(mPs);
-        mDevice.destroyShaderModule(mVs);
+        for (const RetiredPipeline& retired : mRetiredPipelines)
+        {
+            mCtx->pipelines().remove(retired.desc);
+        }
+        mRetiredPipelines.clear();
+
+        if (mPipelinePending)
+        {
+            mCtx->pipelines().remove(mPendingPipelineDesc);
+        }
+#endif
+
+        mCtx->pipelines().remove(mPipelineDesc);
+        mDevice.destroyRenderPass(mRenderPass);
 
         destroySurface(mCtx, mSurface);
     }
 
+#ifdef PYROC_SHADER_HOT_RELOAD
+    /*
+     * Called once the frame's fence has signalled. Edited shaders get a new pipeline compiled on
+     * the pipeline map's workers while the current one keeps drawing, and it is swapped in at the
+     * first frame boundary after it is ready. Replaced pipelines are destroyed once every frame
+     * that may have recorded them has retired, nothing waits on the device, and their shader
+     * modules go with them once no desc names them.
+     */
+    void reloadShaders(uint32_t frameIndex)
+    {
+        std::vector<vk::ShaderModule> unusedCandidates;
+
+        std::erase_if(mRetiredPipelines,
+                      [this, frameIndex, &unusedCandidates](const RetiredPipeline& retired)
+                      {
+                          if (frameIndex - retired.frameIndex < MAX_FRAMES_IN_FLIGHT)
+                          {
+                              return false;
+                          }
+                          mCtx->pipelines().remove(retired.desc);
+                          unusedCandidates.push_back(retired.desc.vertexShader);
+                          unusedCandidates.push_back(retired.desc.fragmentShader);
+                          return true;
+                      });
+
+        mReloads.clear();
+        {
+            const auto res = mShaderReloader.poll(mReloads);
+            if (res != vk::Result::eSuccess)
+            {
+                std::cerr << "Failed to reload shaders: " << vk::to_string(res) << std::endl;
+            }
+        }
+
+        if (!mReloads.empty())
+        {
+            // The shaders replaced here, and reloads rejected below, may be left unnamed
+            unusedCandidates.push_back(mPendingPipelineDesc.vertexShader);
+            unusedCandidates.push_back(mPendingPipelineDesc.fragmentShader);
+            for (const ShaderReload& reload : mReloads)
+            {
+                unusedCandidates.push_back(reload.module);
+            }
+
+            applyReloads(frameIndex);
+        }
+
+        releaseUnusedShaders(unusedCandidates);
+
+        if (mPipelinePending)
+        {
+            vk::Pipeline pipeline;
+            const auto res = mCtx->pipelines().request(mPendingPipelineDesc, pipeline);
+            if (res == vk::Result::eSuccess)
+            {
+                mRetiredPipelines.push_back({mPipelineDesc, frameIndex});
+
+                mPipelineDesc = mPendingPipelineDesc;
+                mPipelineLayout = mPendingPipelineLayout;
+                mPipeline = pipeline;
+                mPipelinePending = false;
+            }
+            else if (res != vk::Result::eNotReady)
+            {
+                // The current pipeline keeps drawing, the next edit builds on the failed shaders
+                std::cerr << "Failed to create the reloaded pipeline: " << vk::to_string(res)
+                          << std::endl;
+
+                mCtx->pipelines().remove(mPendingPipelineDesc);
+                mPipelinePending = false;
+            }
+        }
+    }
+
+    // Builds the pending desc from the polled reloads, leaving it as is when they are unusable
+    void applyReloads(uint32_t frameIndex)
+    {
+        GraphicsPipelineDesc desc = mPendingPipelineDesc;
+        ShaderReflection vsReflection = mVsReflection;
+        ShaderReflection psReflection = mPsReflection;
+
+        for (const ShaderReload& reload : mReloads)
+        {
+            if (reload.id == mVsReloadId)
+            {
+                desc.vertexShader = reload.module;
+                vsReflection = reload.reflection;
+            }
+            else if (reload.id == mPsReloadId)
+            {
+                desc.fragmentShader = reload.module;
+                psReflection = reload.reflection;
+            }
+        }
+
+        const ShaderReflection* stages[] = {&vsReflection, &psReflection};
+
+        ReflectedLayout layout;
+        {
+            const auto res = mCtx->layouts().get(stages, layout);
+            if (res != vk::Result::eSuccess)
+            {
+                std::cerr << "Reloaded shaders have no valid layout: " << vk::to_string(res)
+                          << std::endl;
+                return;
+            }
+        }
+
+        desc.layout = layout.layout;
+        {
+            const auto res = setVertexInputs(vsReflection, IN_BINDING_VERTEX, desc);
+            if (res != vk::Result::eSuccess)
+            {
+                std::cerr << "Reloaded vertex shader has unsupported inputs: "
+                          << vk::to_string(res) << std::endl;
+                return;
+            }
+        }
+
+        mVsReflection = std::move(vsReflection);
+        mPsReflection = std::move(psReflection);
+
+        // Superseded before it was ever drawn with, so no frame holds it
+        if (mPipelinePending)
+        {
+            mRetiredPipelines.push_back({mPendingPipelineDesc, frameIndex});
+        }
+
+        // Retired pipelines for this desc are still cached, and about to be in use again
+        std::erase_if(mRetiredPipelines,
+                      [&desc](const RetiredPipeline& retired) { return retired.desc == desc; });
+
+        mPipelinePending = !(desc == mPipelineDesc);
+        mPendingPipelineDesc = desc;
+        mPendingPipelineLayout = layout;
+    }
+
+    bool isShaderNamed(vk::ShaderModule module) const
+    {
+        const auto names = [module](const GraphicsPipelineDesc& desc)
+        { return desc.vertexShader == module || desc.fragmentShader == module; };
+
+        return names(mPipelineDesc) || names(mPendingPipelineDesc)
+               || std::any_of(mRetiredPipelines.begin(), mRetiredPipelines.end(),
+                              [&names](const RetiredPipeline& retired)
+                              { return names(retired.desc); });
+    }
+
+    // Hands modules no desc names any more back to the shader cache, which destroys them
+    void releaseUnusedShaders(std::span<const vk::ShaderModule> candidates)
+    {
+        for (const vk::ShaderModule module : candidates)
+        {
+            if (!isShaderNamed(module))
+            {
+                mCtx->shaders().release(module);
+            }
+        }
+    }
+#endif
+
     void drawFrame(uint32_t frameIndex)
     {
         uint32_t modFrameIndex = frameIndex % MAX_FRAMES_IN_FLIGHT;
@@ -546,6 +730,28 @@ class App
             }
         }
 
+        releaseRetiredSwapchains();
+
+        if (mSwapchainDirty)
+        {
+            // Frames before the previous one have finished, their fences were waited on
+            const uint32_t previousFrame
+                = (frameIndex + MAX_FRAMES_IN_FLIGHT - 1) % MAX_FRAMES_IN_FLIGHT;
+            recreateSwapchain(mRenderCommands[previousFrame].inFlightFence);
+        }
+
+#ifdef PYROC_SHADER_HOT_RELOAD
+        reloadShaders(frameIndex);
+#endif
+
+        {
+            const auto res = mCtx->stagingRing().beginFrame();
+            if (res != vk::Result::eSuccess)
+            {
+                abort();
+            }
+        }
+
         uint32_t imageIndex;
         {
             if (mSurface.swapchain == nullptr)
@@ -559,7 +765,7 @@ class App
             {
                 case vk::Result::eErrorOutOfDateKHR:
                 {
-                    recreateSwapchain();
+                    requestSwapchainRecreation();
                     return;
                 }
                 case vk::Result::eSuccess:
@@ -589,7 +795,14 @@ class App
             return;
         }
 
+        // Only the first frame drawing the mesh waits for its upload
+        const UploadToken meshUploadToken = mMeshUploadToken;
+        mMeshUploadToken = {};
+
         {
+            // Recording must stay allocation free, checked when allocation tracking is enabled
+            const pyroc::util::NoAllocationScope noAllocations;
+
             {
                 const auto res = commandBuffer.reset();
                 if (res != vk::Result::eSuccess)
@@ -650,20 +863,17 @@ class App
 
             if (frameIndex % 100 == 0)
             {
-                mModelMatrix[0][0] = std::cos(mRotationAngle);
-                mModelMatrix[0][2] = -std::sin(mRotationAngle);
-                mModelMatrix[2][0] = std::sin(mRotationAngle);
-                mModelMatrix[2][2] = std::cos(mRotationAngle);
+                mModelMatrix = toMat4(angleAxis(mRotationAngle, vec3{0.0f, 1.0f, 0.0f}));
                 mRotationAngle += 0.1f;
             }
 
             PushConstants pc = {
                 .model = mModelMatrix,
-                .view = mViewMatrix,
-                .projection = mProjMatrix,
+                .view = mCamera.viewMatrix(),
+                .projection = mCamera.projectionMatrix(),
             };
-            commandBuffer.pushConstants(mPipelineLayout, vk::ShaderStageFlagBits::eVertex, 0,
-                                        sizeof(PushConstants), &pc);
+            commandBuffer.pushConstants(mPipelineLayout.layout, mPipelineLayout.pushConstantStages,
+                                        0, sizeof(PushConstants), &pc);
 
             //  int32_t dynamicOffset = static_cast<int32_t>(3u * ((frameIndex / 100u) % 6u));
 
@@ -671,7 +881,17 @@ class App
             //           << ") with dynamic offset " << dynamicOffset << "...\n";
             // commandBuffer.drawIndexed(3, 1, 0, dynamicOffset, 0);
 
-            commandBuffer.drawIndexed(36, 1, 0, 0, 0);
+            if (mFrustumVersion != mCamera.version())
+            {
+                mFrustum = pyroc::core::makeFrustum(mCamera);
+                mFrustumVersion = mCamera.version();
+            }
+
+            // Cube bounding sphere, the model matrix only rotates about the origin
+            if (pyroc::core::isSphereVisible(mFrustum, vec3{0.0f, 0.0f, 0.0f}, std::sqrt(3.0f)))
+            {
+                commandBuffer.drawIndexed(36, 1, 0, 0, 0);
+            }
 
             commandBuffer.endRenderPass();
 
@@ -685,13 +905,35 @@ class App
         }
 
         {
-            const vk::Semaphore waitSemaphores[] = {renderCommand.imageAvailableSemaphore};
+            // Uploads staged this frame land ahead of the draw on the same queue
+            const auto res = mCtx->stagingRing().flush(false);
+            if (res != vk::Result::eSuccess)
+            {
+                abort();
+            }
+        }
+
+        {
+            const vk::Semaphore waitSemaphores[] = {
+                renderCommand.imageAvailableSemaphore,
+                mCtx->uploadQueue().semaphore(),
+            };
             const vk::Semaphore signalSemaphores[] = {renderCommand.renderFinishedSemaphore};
             const vk::PipelineStageFlags waitStages[] = {
                 vk::PipelineStageFlagBits::eColorAttachmentOutput,
+                UploadQueue::kConsumerStages,
+            };
+
+            // The binary semaphore's value is ignored
+            const uint64_t waitValues[] = {0, meshUploadToken.value};
+            const vk::TimelineSemaphoreSubmitInfo timelineInfo = {
+                .waitSemaphoreValueCount = 2,
+                .pWaitSemaphoreValues = waitValues,
             };
+
             const vk::SubmitInfo submitInfo = {
-                .waitSemaphoreCount = 1,
+                .pNext = meshUploadToken.value != 0 ? &timelineInfo : nullptr,
+                .waitSemaphoreCount = meshUploadToken.value != 0 ? 2u : 1u,
                 .pWaitSemaphores = waitSemaphores,
                 .pWaitDstStageMask = waitStages,
                 .commandBufferCount = 1,
@@ -729,7 +971,7 @@ class App
                 case vk::Result::eSuboptimalKHR:
                 case vk::Result::eErrorOutOfDateKHR:
                 {
-                    recreateSwapchain();
+                    requestSwapchainRecreation();
                     break;
                 }
                 case vk::Result::eSuccess:
@@ -756,28 +998,65 @@ class App
     vk::ShaderModule mVs;
     vk::ShaderModule mPs;
 
-    vk::PipelineLayout mPipelineLayout;
+    ShaderReflection mVsReflection;
+    ShaderReflection mPsReflection;
+
+    // Owned by the context's layout cache
+    ReflectedLayout mPipelineLayout;
     vk::RenderPass mRenderPass;
+    GraphicsPipelineDesc mPipelineDesc;
     vk::Pipeline mPipeline;
 
+#ifdef PYROC_SHADER_HOT_RELOAD
+    struct RetiredPipeline
+    {
+        GraphicsPipelineDesc desc;
+
+        // Frame that stopped using it
+        uint32_t frameIndex = 0;
+    };
+
+    ShaderReloader mShaderReloader;
+    uint32_t mVsReloadId = 0;
+    uint32_t mPsReloadId = 0;
+    std::vector<ShaderReload> mReloads;
+
+    // Waiting on the pipeline map's workers. The pending desc always names the newest shaders,
+    // it matches mPipelineDesc once swapped in and stays behind when its pipeline failed
+    bool mPipelinePending = false;
+    GraphicsPipelineDesc mPendingPipelineDesc;
+    ReflectedLayout mPendingPipelineLayout;
+
+    std::vector<RetiredPipeline> mRetiredPipelines;
+#endif
+
     vk::CommandPool mCommandPool;
 
     std::vector<vk::CommandBuffer> mUpdateCommandBuffers;
 
+    struct RetiredFramebuffers
+    {
+        std::vector<vk::Framebuffer> framebuffers;
+        vk::Fence fence;
+    };
+
     Surface mSurface;
     std::vector<vk::Framebuffer> mFramebuffers;
+    std::vector<RetiredFramebuffers> mRetiredFramebuffers;
+    bool mSwapchainDirty = false;
 
     std::vector<RenderCommand> mRenderCommands;
 
     Buffer mVertexBuffer;
     Buffer mIndexBuffer;
+    UploadToken mMeshUploadToken;
 
     float mRotationAngle = 0.0f;
 
     pyroc::core::Camera mCamera;
+    pyroc::core::Frustum mFrustum;
+    uint64_t mFrustumVersion = ~0ull;
     mat4 mModelMatrix = mat4::identity();
-    mat4 mViewMatrix = mat4::identity();
-    mat4 mProjMatrix = mat4::identity();
 };
 
 }  // namespace
@@ -790,21 +1069,37 @@ int main(const int argc, const char** argv)
     bool useValidation = true;
 #endif
 
-    if (argc > 1)
+    PresentPlatform platform = PresentPlatform::eDefault;
+
+    for (int i = 1; i < argc; ++i)
     {
-        std::string arg1 = argv[1];
-        if (arg1 == "--no-validation")
+        std::string arg = argv[i];
+        if (arg == "--no-validation")
         {
             useValidation = false;
         }
-        else if (arg1 == "--validation")
+        else if (arg == "--validation")
         {
             useValidation = true;
         }
+        else if (arg == "--x11")
+        {
+            platform = PresentPlatform::eX11;
+        }
+        else if (arg == "--wayland")
+        {
+            platform = PresentPlatform::eWayland;
+        }
     }
     Context ctx;
     {
-        vk::Result res = ctx.init(useValidation);
+        const ContextCreateInfo contextCreateInfo = {
+            .enableValidationLayers = useValidation,
+            .platform = platform,
+            .pPipelineCachePath = "pipeline_cache.bin",
+        };
+
+        vk::Result res = ctx.init(&contextCreateInfo);
         if (res != vk::Result::eSuccess)
         {
             abort();
@@ -840,8 +1135,7 @@ int main(const int argc, const char** argv)
         [](GLFWwindow* glfwWindow, int, int)
         {
             App* pApp = static_cast<App*>(glfwGetWindowUserPointer(glfwWindow));
-            std::cout << "Framebuffer size changed, recreating swapchain...\n" << std::endl;
-            pApp->recreateSwapchain();
+            pApp->requestSwapchainRecreation();
         });
 
     glfwSetWindowSizeCallback(
@@ -849,9 +1143,7 @@ int main(const int argc, const char** argv)
         [](GLFWwindow* glfwWindow, int, int)
         {
             App* pApp = static_cast<App*>(glfwGetWindowUserPointer(glfwWindow));
-
-            std::cout << "Window size changed, recreating swapchain...\n" << std::endl;
-            pApp->recreateSwapchain();
+            pApp->requestSwapchainRecreation();
         });
 
     glfwSetWindowFocusCallback(
@@ -861,14 +1153,14 @@ int main(const int argc, const char** argv)
             App* pApp = static_cast<App*>(glfwGetWindowUserPointer(glfwWindow));
             if (focused)
             {
-                std::cout << "Window focused, recreating swapchain...\n" << std::endl;
-                pApp->recreateSwapchain();
+                pApp->requestSwapchainRecreation();
             }
         });
 
     uint32_t currentFrame = 0;
     while (!glfwWindowShouldClose(window.window()))
     {
+        pyroc::util::beginAllocationFrame();
         app.drawFrame(currentFrame);
         currentFrame = (currentFrame + 1);
     }
@@ -881,6 +1173,8 @@ int main(const int argc, const char** argv)
         }
     }
 
+    pyroc::util::logAllocationStats();
+
     app.destroy();
     window.cleanup();
     return 0;
@@ -1,6 +1,9 @@
 #pragma once
 
 #include "api.h"
+#include "memory.h"
+
+#include <span>
 
 namespace pyroc::backend::vulkan
 {
@@ -10,19 +13,78 @@ class Context;
 struct Buffer
 {
     vk::Buffer buffer;
-    vk::DeviceMemory memory;
+    Allocation allocation;
     vk::DeviceSize size;
     vk::BufferUsageFlags usage;
+    vk::SharingMode sharingMode;
     vk::MemoryPropertyFlags properties;
+
+    // Start of the buffer in host address space when its memory is host visible
+    void* pMapped;
 };
 
 vk::Result createBuffer(Context* ctx, vk::DeviceSize size, vk::BufferUsageFlags usage,
                         vk::MemoryPropertyFlags properties, Buffer& buffer);
+
+/*
+ * Shares the buffer concurrently between queueFamilies, so queues of each family can use it
+ * without ownership transfers. Duplicates are ignored, one distinct family makes it exclusive.
+ */
+vk::Result createBuffer(Context* ctx, vk::DeviceSize size, vk::BufferUsageFlags usage,
+                        vk::MemoryPropertyFlags properties,
+                        std::span<const uint32_t> queueFamilies, Buffer& buffer);
+
+/*
+ * Creates a buffer the host writes through pMapped for its whole lifetime. Prefers device local,
+ * host visible memory (resizable BAR or unified memory) so the device reads it without a copy,
+ * then host cached memory, then any host visible memory. properties holds the flags of the memory
+ * type picked; when it lacks eHostCoherent writes need flushRange and reads need invalidateRange.
+ */
+vk::Result createMappedBuffer(Context* ctx, vk::DeviceSize size, vk::BufferUsageFlags usage,
+                              Buffer& buffer);
 void destroyBuffer(Context* ctx, Buffer& buffer);
 
+// Both are no-ops on coherent memory, size may be VK_WHOLE_SIZE
+vk::Result flushRange(Context* ctx, const Buffer& buffer, vk::DeviceSize offset,
+                      vk::DeviceSize size);
+vk::Result invalidateRange(Context* ctx, const Buffer& buffer, vk::DeviceSize offset,
+                           vk::DeviceSize size);
+
+// Stages pSrc through the context's staging ring, or a temporary buffer when it does not fit
 vk::Result copyBufferBlocking(Context* ctx, vk::CommandBuffer cmdBuf, vk::DeviceSize srcSize,
                               const void* pSrc, vk::DeviceSize dstOffset, Buffer& dst);
 
+/*
+ * Copies size bytes of src from srcOffset to dst at dstOffset. VK_WHOLE_SIZE copies the rest of
+ * src, clamped to the space left in dst.
+ */
 vk::Result copyBufferBlocking(Context* ctx, vk::CommandBuffer cmdBuf, vk::DeviceSize srcOffset,
-                              Buffer& src, vk::DeviceSize dstOffset, Buffer& dst);
+                              Buffer& src, vk::DeviceSize dstOffset, Buffer& dst,
+                              vk::DeviceSize size = VK_WHOLE_SIZE);
+
+struct BufferCopyRegion
+{
+    vk::Buffer src;
+    vk::DeviceSize srcOffset = 0;
+    vk::Buffer dst;
+    vk::DeviceSize dstOffset = 0;
+    vk::DeviceSize size = 0;
+};
+
+/*
+ * Records regions into cmdBuf, merging regions that are adjacent in both buffers into one copy and
+ * issuing a single vkCmdCopyBuffer per buffer pair. Earlier transfer writes and dstStages reads of
+ * the destinations are ordered before the copies, and the copied ranges are made visible to
+ * dstAccess at dstStages afterwards. regions is sorted in place.
+ */
+void recordBufferCopies(vk::CommandBuffer cmdBuf, std::span<BufferCopyRegion> regions,
+                        vk::PipelineStageFlags dstStages, vk::AccessFlags dstAccess);
+
+/*
+ * Records regions into cmdBuf as recordBufferCopies does and submits it on the graphics queue
+ * without waiting, fence signals once the copies are done
+ */
+vk::Result copyBuffers(Context* ctx, vk::CommandBuffer cmdBuf,
+                       std::span<BufferCopyRegion> regions, vk::PipelineStageFlags dstStages,
+                       vk::AccessFlags dstAccess, vk::Fence fence);
 }  // namespace pyroc::backend::vulkan
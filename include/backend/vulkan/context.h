@@ -1,44 +1,146 @@
 #pragma once
 
 #include "api.h"
+#include "memory.h"
+#include "pipeline.h"
+#include "pipeline_cache.h"
+#include "shader.h"
+#include "shader_reflection.h"
+#include "staging.h"
+#include "upload.h"
 
 namespace pyroc::backend::vulkan
 {
 
+// Window system GLFW presents through, eDefault lets GLFW pick among the ones it was built with
+enum class PresentPlatform
+{
+    eDefault,
+    eWin32,
+    eX11,
+    eWayland,
+};
+
+struct ContextCreateInfo
+{
+    bool enableValidationLayers = false;
+
+    // Falls back to eDefault when the requested platform is not available
+    PresentPlatform platform = PresentPlatform::eDefault;
+
+    /*
+     * Skips GLFW and the surface and swapchain extensions, and accepts any device type (software
+     * implementations such as lavapipe included). Render into a RenderTarget instead of a Surface.
+     */
+    bool headless = false;
+
+    // Where the pipeline cache persists between runs, nullptr keeps it in memory only
+    const char* pPipelineCachePath = nullptr;
+
+    // Background pipeline compilation threads, see PipelineMap
+    uint32_t pipelineCompileThreads = 1;
+};
+
+/*
+ * What the selected device offers. Optional features and extensions are enabled whenever the
+ * device supports them, so a set flag means the fast path that needs it can be taken.
+ */
+struct DeviceCapabilities
+{
+    uint32_t apiVersion = 0;
+    vk::PhysicalDeviceType deviceType = vk::PhysicalDeviceType::eOther;
+
+    // Largest device local heap
+    vk::DeviceSize deviceLocalBytes = 0;
+    bool dedicatedTransferQueue = false;
+
+    // Vulkan 1.2, timeline semaphores are required
+    bool timelineSemaphore = false;
+    bool bufferDeviceAddress = false;
+
+    // Non uniform indexing into partially bound, runtime sized sampled image arrays
+    bool descriptorIndexing = false;
+
+    // Vulkan 1.3
+    bool synchronization2 = false;
+    bool dynamicRendering = false;
+
+    // VK_EXT_memory_budget
+    bool memoryBudget = false;
+};
+
 class Context
 {
   public:
     struct QueueFamilyIndices
     {
         uint32_t graphics = ~0u;
+
+        // Left at ~0u by headless contexts
         uint32_t present = ~0u;
+
+        // Dedicated transfer family when the device has one, graphics otherwise
+        uint32_t transfer = ~0u;
     };
 
-    vk::Result init(bool enableValidationLayers);
+    vk::Result init(const ContextCreateInfo* pCreateInfo);
 
     void destroy();
 
+    bool headless() const { return mHeadless; }
+
+    // Platform GLFW ended up on, eDefault for headless contexts
+    PresentPlatform platform() const { return mPlatform; }
+
     vk::Instance instance() { return mInstance; }
 
     vk::PhysicalDevice physicalDevice() { return mPhysicalDevice; }
+    const DeviceCapabilities& capabilities() const { return mCapabilities; }
     vk::Device device() { return mDevice; }
 
     uint32_t graphicsQueueIdx() { return mQueueFamilyIndices.graphics; }
     uint32_t presentQueueIdx() { return mQueueFamilyIndices.present; }
+    uint32_t transferQueueIdx() { return mQueueFamilyIndices.transfer; }
 
     vk::Queue graphicsQueue() { return mGraphicsQueue; }
     vk::Queue presentQueue() { return mPresentQueue; }
+    vk::Queue transferQueue() { return mTransferQueue; }
+
+    MemoryAllocator& allocator() { return mAllocator; }
+    StagingRing& stagingRing() { return mStagingRing; }
+    UploadQueue& uploadQueue() { return mUploadQueue; }
+    PipelineCache& pipelineCache() { return mPipelineCache; }
+    PipelineMap& pipelines() { return mPipelines; }
+    ShaderCache& shaders() { return mShaders; }
+    PipelineLayoutCache& layouts() { return mLayouts; }
+    const vk::PhysicalDeviceMemoryProperties& memoryProperties() const
+    {
+        return mAllocator.memoryProperties();
+    }
 
   private:
+    bool mHeadless = false;
+    PresentPlatform mPlatform = PresentPlatform::eDefault;
+
     vk::Instance mInstance;
     vk::DebugUtilsMessengerEXT mDebugMessenger;
 
     vk::PhysicalDevice mPhysicalDevice;
+    DeviceCapabilities mCapabilities;
     vk::Device mDevice;
 
     QueueFamilyIndices mQueueFamilyIndices;
     vk::Queue mGraphicsQueue;
     vk::Queue mPresentQueue;
+    vk::Queue mTransferQueue;
+
+    MemoryAllocator mAllocator;
+    StagingRing mStagingRing;
+    UploadQueue mUploadQueue;
+    PipelineCache mPipelineCache;
+    PipelineMap mPipelines;
+    ShaderCache mShaders;
+    PipelineLayoutCache mLayouts;
 };
 
 }  // namespace pyroc::backend::vulkan
@@ -0,0 +1,227 @@
+#pragma once
+
+#include "api.h"
+
+#include <mutex>
+#include <span>
+#include <vector>
+
+namespace pyroc::backend::vulkan
+{
+
+/*
+ * A range of device memory handed out by MemoryAllocator. Resources bind to memory at offset.
+ * pMapped points at offset when the memory type is host visible (blocks stay mapped for their
+ * whole lifetime).
+ */
+struct Allocation
+{
+    static constexpr uint32_t kDedicated = ~0u;
+
+    vk::DeviceMemory memory;
+    vk::DeviceSize offset = 0;
+    vk::DeviceSize size = 0;
+    void* pMapped = nullptr;
+    void* pUserData = nullptr;
+
+    uint32_t memoryType = ~0u;
+    uint32_t block = kDedicated;
+    uint32_t node = ~0u;
+};
+
+struct MemoryStats
+{
+    uint32_t blockCount = 0;
+    uint32_t allocationCount = 0;
+    uint32_t dedicatedAllocationCount = 0;
+
+    // Device memory reserved through vkAllocateMemory, and how much of it is handed out
+    vk::DeviceSize reservedBytes = 0;
+    vk::DeviceSize usedBytes = 0;
+};
+
+/*
+ * Planned relocation of src into dst, see MemoryAllocator::beginDefragmentation
+ */
+struct DefragmentationMove
+{
+    Allocation src;
+    Allocation dst;
+};
+
+/*
+ * Two-level segregated fit over an offset range. The bookkeeping lives on the host so it works
+ * for memory the CPU cannot touch. Not thread safe.
+ */
+class RangeAllocator
+{
+  public:
+    static constexpr uint32_t kInvalidNode = ~0u;
+
+    void init(vk::DeviceSize size);
+
+    // Returns kInvalidNode when no free range fits
+    uint32_t allocate(vk::DeviceSize size, vk::DeviceSize alignment, void* pUserData,
+                      vk::DeviceSize& offset);
+    void free(uint32_t node);
+
+    vk::DeviceSize size() const { return mSize; }
+    vk::DeviceSize used() const { return mUsed; }
+    uint32_t allocationCount() const { return mAllocationCount; }
+
+    // Allocated ranges in address order, pass kInvalidNode to get the first
+    uint32_t nextAllocated(uint32_t node) const;
+
+    vk::DeviceSize offset(uint32_t node) const { return mNodes[node].offset; }
+    vk::DeviceSize size(uint32_t node) const { return mNodes[node].size; }
+    vk::DeviceSize alignment(uint32_t node) const { return mNodes[node].alignment; }
+    void* userData(uint32_t node) const { return mNodes[node].pUserData; }
+
+  private:
+    static constexpr uint32_t kSlIndexCountLog2 = 5;
+    static constexpr uint32_t kSlIndexCount = 1u << kSlIndexCountLog2;
+    static constexpr uint32_t kGranularityLog2 = 4;
+    static constexpr uint32_t kFlIndexShift = kSlIndexCountLog2 + kGranularityLog2;
+    static constexpr uint32_t kFlIndexMax = 40;
+    static constexpr uint32_t kFlIndexCount = kFlIndexMax - kFlIndexShift + 1;
+
+    struct Node
+    {
+        vk::DeviceSize offset = 0;
+        vk::DeviceSize size = 0;
+        vk::DeviceSize alignment = 0;
+        void* pUserData = nullptr;
+
+        uint32_t prevPhys = kInvalidNode;
+        uint32_t nextPhys = kInvalidNode;
+        uint32_t prevFree = kInvalidNode;
+        uint32_t nextFree = kInvalidNode;
+        bool free = false;
+    };
+
+    uint32_t createNode(vk::DeviceSize offset, vk::DeviceSize size);
+    void releaseNode(uint32_t node);
+
+    // Links node into the physical chain after prev
+    void linkAfter(uint32_t prev, uint32_t node);
+    void unlink(uint32_t node);
+
+    void insertFree(uint32_t node);
+    void removeFree(uint32_t node);
+    uint32_t findFree(vk::DeviceSize size) const;
+
+    std::vector<Node> mNodes;
+    std::vector<uint32_t> mUnusedNodes;
+    uint32_t mFirstNode = kInvalidNode;
+
+    uint64_t mFlBitmap = 0;
+    uint32_t mSlBitmap[kFlIndexCount] = {};
+    uint32_t mFreeHeads[kFlIndexCount][kSlIndexCount] = {};
+
+    vk::DeviceSize mSize = 0;
+    vk::DeviceSize mUsed = 0;
+    uint32_t mAllocationCount = 0;
+};
+
+struct MemoryAllocatorCreateInfo
+{
+    // Size of the vkAllocateMemory blocks, requests over half of it get a dedicated allocation
+    vk::DeviceSize blockSize = vk::DeviceSize{64} << 20;
+
+    // Allocate with VK_MEMORY_ALLOCATE_DEVICE_ADDRESS_BIT, needs the bufferDeviceAddress feature
+    bool deviceAddress = false;
+};
+
+/*
+ * Sub-allocates resources from large blocks per memory type to stay well below
+ * maxMemoryAllocationCount and avoid the cost of vkAllocateMemory per resource. Thread safe.
+ *
+ * Blocks are shared between buffers and images, so callers placing images pad their requirements
+ * to bufferImageGranularity (see createRenderTarget).
+ */
+class MemoryAllocator
+{
+  public:
+    vk::Result init(vk::PhysicalDevice physicalDevice, vk::Device device,
+                    const MemoryAllocatorCreateInfo* pCreateInfo);
+    void destroy();
+
+    const vk::PhysicalDeviceMemoryProperties& memoryProperties() const
+    {
+        return mMemoryProperties;
+    }
+
+    // First memory type allowed by typeBits with all of properties, ~0u if there is none
+    uint32_t findMemoryType(uint32_t typeBits, vk::MemoryPropertyFlags properties) const;
+
+    bool isCoherent(const Allocation& allocation) const
+    {
+        return bool(mMemoryProperties.memoryTypes[allocation.memoryType].propertyFlags
+                    & vk::MemoryPropertyFlagBits::eHostCoherent);
+    }
+
+    vk::Result allocate(const vk::MemoryRequirements& requirements,
+                        vk::MemoryPropertyFlags properties, void* pUserData,
+                        Allocation& allocation);
+    void free(Allocation& allocation);
+
+    /*
+     * Makes host writes to [offset, offset + size) of a mapped allocation visible to the device, or
+     * device writes visible to the host. Offsets are relative to the allocation and widened to
+     * nonCoherentAtomSize. No-ops on coherent memory.
+     */
+    vk::Result flush(const Allocation& allocation, vk::DeviceSize offset, vk::DeviceSize size);
+    vk::Result invalidate(const Allocation& allocation, vk::DeviceSize offset, vk::DeviceSize size);
+
+    MemoryStats stats() const;
+    MemoryStats stats(uint32_t memoryType) const;
+
+    /*
+     * Plans moving allocations out of the least used block of each memory type into free space in
+     * the other blocks, writing up to moves.size() moves. The destinations are allocated already.
+     * The caller copies the contents, recreates the resources identified by pUserData against
+     * dst, then passes the same moves to endDefragmentation, which frees the sources.
+     */
+    size_t beginDefragmentation(std::span<DefragmentationMove> moves);
+    void endDefragmentation(std::span<const DefragmentationMove> moves);
+
+  private:
+    struct Block
+    {
+        vk::DeviceMemory memory;
+        void* pMapped = nullptr;
+        RangeAllocator ranges;
+    };
+
+    struct MemoryType
+    {
+        std::vector<Block> blocks;
+        uint32_t liveBlocks = 0;
+        uint32_t dedicatedCount = 0;
+        vk::DeviceSize dedicatedBytes = 0;
+    };
+
+    vk::Result allocateMemory(uint32_t memoryType, vk::DeviceSize size, vk::DeviceMemory& memory,
+                              void*& pMapped);
+    vk::Result createBlock(uint32_t memoryType, uint32_t& blockIndex);
+    void releaseBlock(uint32_t memoryType, uint32_t blockIndex);
+
+    Allocation makeAllocation(uint32_t memoryType, uint32_t blockIndex, uint32_t node) const;
+    vk::MappedMemoryRange mappedRange(const Allocation& allocation, vk::DeviceSize offset,
+                                      vk::DeviceSize size) const;
+    void freeLocked(const Allocation& allocation);
+    void addStats(uint32_t memoryType, MemoryStats& stats) const;
+
+    vk::Device mDevice;
+    vk::PhysicalDeviceMemoryProperties mMemoryProperties;
+    vk::DeviceSize mBlockSize = 0;
+    bool mDeviceAddress = false;
+
+    // Host visible, non coherent allocations are padded to this so flushes stay inside them
+    vk::DeviceSize mNonCoherentAtomSize = 1;
+
+    MemoryType mMemoryTypes[VK_MAX_MEMORY_TYPES];
+    mutable std::mutex mMutex;
+};
+
+}  // namespace pyroc::backend::vulkan
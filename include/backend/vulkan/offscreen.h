@@ -0,0 +1,51 @@
+#pragma once
+
+#include "api.h"
+#include "buffer.h"
+#include "memory.h"
+
+namespace pyroc::backend::vulkan
+{
+
+class Context;
+
+/*
+ * Color image rendered to in place of a swapchain image, for headless contexts. The render pass
+ * clears the image and leaves it in eTransferSrcOptimal, ready for readback.
+ */
+struct RenderTarget
+{
+    vk::Image image;
+    vk::ImageView imageView;
+    Allocation allocation;
+    vk::Format format;
+    vk::Extent2D extent;
+
+    vk::RenderPass renderPass;
+    vk::Framebuffer framebuffer;
+
+    // Host visible copy destination, tightly packed rows
+    Buffer readback;
+};
+
+struct RenderTargetCreateInfo
+{
+    vk::Extent2D extent;
+
+    // Only formats with 4 byte texels are supported, others fail with eErrorFormatNotSupported
+    vk::Format format = vk::Format::eR8G8B8A8Unorm;
+};
+
+vk::Result createRenderTarget(Context* ctx, const RenderTargetCreateInfo* createInfo,
+                              RenderTarget& target);
+void destroyRenderTarget(Context* ctx, RenderTarget& target);
+
+/*
+ * Copies the target's contents into pDst (extent.width * extent.height * 4 bytes) once the work
+ * already submitted to the graphics queue has completed. The target must have been rendered to at
+ * least once. Blocks until the copy is done.
+ */
+vk::Result readRenderTarget(Context* ctx, vk::CommandBuffer cmdBuf, RenderTarget& target,
+                            void* pDst);
+
+}  // namespace pyroc::backend::vulkan
@@ -0,0 +1,179 @@
+#pragma once
+
+#include "api.h"
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace pyroc::backend::vulkan
+{
+
+class Context;
+
+constexpr uint32_t kMaxVertexBindings = 4;
+constexpr uint32_t kMaxVertexAttributes = 8;
+constexpr uint32_t kMaxColorAttachments = 4;
+
+struct VertexBinding
+{
+    uint32_t binding = 0;
+    uint32_t stride = 0;
+    vk::VertexInputRate inputRate = vk::VertexInputRate::eVertex;
+
+    bool operator==(const VertexBinding&) const = default;
+};
+
+struct VertexAttribute
+{
+    uint32_t location = 0;
+    uint32_t binding = 0;
+    vk::Format format = vk::Format::eUndefined;
+    uint32_t offset = 0;
+
+    bool operator==(const VertexAttribute&) const = default;
+};
+
+struct BlendState
+{
+    bool enable = false;
+    vk::BlendFactor srcColor = vk::BlendFactor::eOne;
+    vk::BlendFactor dstColor = vk::BlendFactor::eZero;
+    vk::BlendOp colorOp = vk::BlendOp::eAdd;
+    vk::BlendFactor srcAlpha = vk::BlendFactor::eOne;
+    vk::BlendFactor dstAlpha = vk::BlendFactor::eZero;
+    vk::BlendOp alphaOp = vk::BlendOp::eAdd;
+    vk::ColorComponentFlags writeMask = vk::ColorComponentFlagBits::eR
+                                        | vk::ColorComponentFlagBits::eG
+                                        | vk::ColorComponentFlagBits::eB
+                                        | vk::ColorComponentFlagBits::eA;
+
+    bool operator==(const BlendState&) const = default;
+};
+
+/*
+ * Everything a graphics pipeline is built from, as a plain value to hash and compare. Viewport
+ * and scissor are always dynamic. Array entries past their count must be left at their defaults
+ * so equal pipelines compare equal.
+ *
+ * Handles are part of the key, so a desc only identifies a pipeline for as long as the shader
+ * modules, layout and render pass it names are alive. Without a render pass the pipeline is
+ * created for dynamic rendering with the given attachment formats.
+ */
+struct GraphicsPipelineDesc
+{
+    vk::ShaderModule vertexShader;
+    vk::ShaderModule fragmentShader;
+
+    uint32_t vertexBindingCount = 0;
+    VertexBinding vertexBindings[kMaxVertexBindings] = {};
+    uint32_t vertexAttributeCount = 0;
+    VertexAttribute vertexAttributes[kMaxVertexAttributes] = {};
+
+    vk::PrimitiveTopology topology = vk::PrimitiveTopology::eTriangleList;
+
+    vk::PolygonMode polygonMode = vk::PolygonMode::eFill;
+    vk::CullModeFlags cullMode = vk::CullModeFlagBits::eNone;
+    vk::FrontFace frontFace = vk::FrontFace::eCounterClockwise;
+    vk::SampleCountFlagBits samples = vk::SampleCountFlagBits::e1;
+
+    bool depthTest = false;
+    bool depthWrite = false;
+    vk::CompareOp depthCompareOp = vk::CompareOp::eLessOrEqual;
+
+    uint32_t colorAttachmentCount = 1;
+    vk::Format colorFormats[kMaxColorAttachments] = {};
+    BlendState blend[kMaxColorAttachments] = {};
+    vk::Format depthFormat = vk::Format::eUndefined;
+
+    vk::PipelineLayout layout;
+    vk::RenderPass renderPass;
+    uint32_t subpass = 0;
+
+    bool operator==(const GraphicsPipelineDesc&) const = default;
+};
+
+// Hashes the desc field by field, padding and unused array entries never contribute
+uint64_t hashPipelineDesc(const GraphicsPipelineDesc& desc);
+
+// Creates desc's pipeline through the context's pipeline cache
+vk::Result createGraphicsPipeline(Context* ctx, const GraphicsPipelineDesc& desc,
+                                  vk::Pipeline& pipeline);
+
+struct PipelineMapCreateInfo
+{
+    // Threads compiling requested pipelines in the background, zero compiles them on request
+    uint32_t workerCount = 1;
+};
+
+/*
+ * Owns pipelines keyed by their desc, creating each one once. get() blocks until the pipeline
+ * exists. request() never compiles on the calling thread when there are workers: it queues the
+ * desc and returns eNotReady until the pipeline is ready, so the render loop can skip the draw
+ * (or fall back to another pipeline) instead of stalling. Once compiling has failed it returns
+ * the creation error, until the desc is removed. Thread safe.
+ */
+class PipelineMap
+{
+  public:
+    vk::Result init(Context* ctx, const PipelineMapCreateInfo* pCreateInfo);
+
+    // Waits for the workers and destroys every pipeline
+    void destroy();
+
+    vk::Result get(const GraphicsPipelineDesc& desc, vk::Pipeline& pipeline);
+    vk::Result request(const GraphicsPipelineDesc& desc, vk::Pipeline& pipeline);
+
+    /*
+     * Destroys desc's pipeline, waiting for it if it is being compiled. Call before destroying the
+     * handles the desc names, once the GPU is done with the pipeline, and not while another thread
+     * may still get() the same desc.
+     */
+    void remove(const GraphicsPipelineDesc& desc);
+
+  private:
+    enum class State
+    {
+        eQueued,
+        eCompiling,
+        eReady,
+        eFailed,
+    };
+
+    struct Entry
+    {
+        State state = State::eQueued;
+        vk::Pipeline pipeline;
+        vk::Result result = vk::Result::eNotReady;
+    };
+
+    struct DescHash
+    {
+        size_t operator()(const GraphicsPipelineDesc& desc) const
+        {
+            return hashPipelineDesc(desc);
+        }
+    };
+
+    // Compiles desc's entry with the lock released, lock is held on entry and return
+    void compile(std::unique_lock<std::mutex>& lock, const GraphicsPipelineDesc& desc,
+                 Entry& entry);
+    void workerLoop();
+
+    Context* mCtx = nullptr;
+
+    std::unordered_map<GraphicsPipelineDesc, Entry, DescHash> mPipelines;
+    std::deque<GraphicsPipelineDesc> mQueue;
+
+    std::vector<std::thread> mWorkers;
+    bool mStopping = false;
+
+    std::mutex mMutex;
+    std::condition_variable mQueueCondition;
+    std::condition_variable mCompiledCondition;
+};
+
+}  // namespace pyroc::backend::vulkan
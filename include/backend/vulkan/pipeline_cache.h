@@ -0,0 +1,49 @@
+#pragma once
+
+#include "api.h"
+
+#include <string>
+
+namespace pyroc::backend::vulkan
+{
+
+class Context;
+
+struct PipelineCacheCreateInfo
+{
+    // File the cache is loaded from and saved to, nullptr keeps it in memory only
+    const char* pPath = nullptr;
+};
+
+/*
+ * VkPipelineCache persisted across runs. The file is only used when it was written for the same
+ * vendor, device, driver version and cache UUID, a stale or corrupt file is discarded and the cache
+ * starts out empty. Saving writes to a temporary file renamed over the old one, so a crash midway
+ * never leaves a truncated cache behind.
+ *
+ * The handle is internally synchronized and may be passed to pipeline creation on any thread.
+ */
+class PipelineCache
+{
+  public:
+    vk::Result init(Context* ctx, const PipelineCacheCreateInfo* pCreateInfo);
+
+    // Saves, then destroys the cache
+    void destroy();
+
+    // Writes the cache back to disk, skipped when nothing was added since it was loaded or saved
+    vk::Result save();
+
+    vk::PipelineCache handle() const { return mCache; }
+
+  private:
+    Context* mCtx = nullptr;
+    vk::PipelineCache mCache;
+    std::string mPath;
+
+    // Size and hash of the data last loaded or saved
+    size_t mSavedSize = 0;
+    uint64_t mSavedHash = 0;
+};
+
+}  // namespace pyroc::backend::vulkan
@@ -1,14 +1,145 @@
 #pragma once
 
 #include "api.h"
+#include "shader_archive_format.h"
 
+#include "util/mapped_file.h"
+
+#include <span>
 #include <string>
+#include <string_view>
+#include <unordered_map>
 #include <vector>
 
 namespace pyroc::backend::vulkan
 {
+struct ShaderReflection;
+
 vk::ShaderModule createShaderFromFile(vk::Device device, const std::string& filename);
 
 vk::ShaderModule createShaderFromBytes(vk::Device device, const std::vector<char>& data);
 
-}  // namespace pyroc::backend::vulkan
\ No newline at end of file
+// Checks the size, the 4 byte alignment and the magic number of a SPIR-V binary
+bool isValidSpirv(const void* pCode, size_t size);
+
+/*
+ * Read only view of a packed shader archive, mapped once. Lookups are a binary search over the
+ * sorted name hashes. Code pointers stay valid until close().
+ */
+class ShaderArchive
+{
+  public:
+    // Validates the header, the entry table and every blob's SPIR-V header
+    vk::Result open(const char* path);
+    void close();
+
+    // nullptr when the archive has no shader of that name
+    const ShaderArchiveEntry* find(std::string_view name) const;
+
+    std::span<const ShaderArchiveEntry> entries() const { return {mEntries, mEntryCount}; }
+
+    const char* name(const ShaderArchiveEntry& entry) const
+    {
+        return mStrings + entry.nameOffset;
+    }
+    const char* entryPoint(const ShaderArchiveEntry& entry) const
+    {
+        return mStrings + entry.entryPointOffset;
+    }
+    vk::ShaderStageFlagBits stage(const ShaderArchiveEntry& entry) const
+    {
+        return static_cast<vk::ShaderStageFlagBits>(entry.stage);
+    }
+    const void* code(const ShaderArchiveEntry& entry) const
+    {
+        return static_cast<const char*>(mFile.data()) + entry.dataOffset;
+    }
+
+  private:
+    util::MappedFile mFile;
+
+    const ShaderArchiveEntry* mEntries = nullptr;
+    uint32_t mEntryCount = 0;
+    const char* mStrings = nullptr;
+};
+
+struct ShaderCacheStats
+{
+    uint32_t filesLoaded = 0;
+    uint32_t modulesCreated = 0;
+
+    // Loads answered from the path or content table without creating a module
+    uint32_t cacheHits = 0;
+
+    size_t bytesLoaded = 0;
+
+    // Time spent mapping, validating and hashing files, and in vkCreateShaderModule
+    uint64_t loadNanoseconds = 0;
+    uint64_t createNanoseconds = 0;
+};
+
+/*
+ * Owns shader modules, created once per distinct SPIR-V binary. Files are memory mapped and handed
+ * to the driver directly, the cache keeps its own copy of each binary to compare against.
+ * Identical binaries loaded from different paths or byte arrays share one module, so pipeline
+ * descs naming them compare equal. Not thread safe.
+ */
+class ShaderCache
+{
+  public:
+    void init(vk::Device device);
+
+    // Destroys every module, pipelines created from them stay valid
+    void destroy();
+
+    vk::Result load(const char* path, vk::ShaderModule& module);
+    vk::Result create(const void* pCode, size_t size, vk::ShaderModule& module);
+
+    /*
+     * Reuses the archive's content hash, nothing is read but the blob handed to the driver.
+     * Reflects the blob into pReflection when given, while it is still mapped.
+     */
+    vk::Result load(const ShaderArchive& archive, std::string_view name, vk::ShaderModule& module,
+                    ShaderReflection* pReflection = nullptr);
+
+    /*
+     * Destroys module and forgets every path and binary that named it. Modules are shared, only
+     * call once nothing still creates pipelines from it. Pipelines already created stay valid.
+     */
+    void release(vk::ShaderModule module);
+
+    const ShaderCacheStats& stats() const { return mStats; }
+
+  private:
+    vk::Result create(const void* pCode, size_t size, uint64_t hash, vk::ShaderModule& module);
+
+    struct ContentKey
+    {
+        uint64_t hash = 0;
+        size_t size = 0;
+
+        bool operator==(const ContentKey&) const = default;
+    };
+
+    struct ContentKeyHash
+    {
+        size_t operator()(const ContentKey& key) const { return key.hash; }
+    };
+
+    struct CachedModule
+    {
+        vk::ShaderModule module;
+
+        // Compared on a hash match, so colliding binaries never share a module
+        std::vector<uint32_t> code;
+    };
+
+    vk::Device mDevice;
+
+    std::unordered_multimap<ContentKey, CachedModule, ContentKeyHash> mModules;
+    std::unordered_map<std::string, vk::ShaderModule> mPaths;
+
+    ShaderCacheStats mStats;
+};
+
+}  // namespace pyroc::backend::vulkan
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstdint>
+
+/*
+ * On disk layout of a packed shader archive, written by the shader_pack tool (see compile_shader's
+ * ARCHIVE argument) and read by ShaderArchive. Kept free of Vulkan so the tool builds without it.
+ *
+ * header | entries sorted by nameHash | string table | SPIR-V blobs, each kDataAlignment aligned
+ *
+ * Offsets are from the start of the file. Identical binaries are stored once and share an offset.
+ */
+
+namespace pyroc::backend::vulkan
+{
+constexpr uint32_t kShaderArchiveMagic = 0x52415350;  // "PSAR"
+constexpr uint32_t kShaderArchiveVersion = 1;
+constexpr uint32_t kShaderArchiveDataAlignment = 16;
+
+struct ShaderArchiveHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t entryCount;
+    uint32_t stringTableOffset;
+    uint32_t stringTableSize;
+    uint32_t reserved;
+};
+
+struct ShaderArchiveEntry
+{
+    // FNV-1a of the name and of the SPIR-V, see util/hash.h
+    uint64_t nameHash;
+    uint64_t contentHash;
+
+    // Into the string table, null terminated
+    uint32_t nameOffset;
+    uint32_t entryPointOffset;
+
+    uint32_t dataOffset;
+    uint32_t dataSize;
+
+    // VkShaderStageFlagBits
+    uint32_t stage;
+    uint32_t reserved;
+};
+
+static_assert(sizeof(ShaderArchiveHeader) == 24);
+static_assert(sizeof(ShaderArchiveEntry) == 40);
+}  // namespace pyroc::backend::vulkan
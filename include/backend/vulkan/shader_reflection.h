@@ -0,0 +1,132 @@
+#pragma once
+
+#include "api.h"
+
+#include <span>
+#include <unordered_map>
+#include <vector>
+
+namespace pyroc::backend::vulkan
+{
+
+class Context;
+struct GraphicsPipelineDesc;
+
+constexpr uint32_t kMaxDescriptorSets = 4;
+
+// Descriptor count given to runtime sized arrays, bound as variable count and partially bound
+constexpr uint32_t kMaxRuntimeArrayDescriptors = 1024;
+
+struct DescriptorBinding
+{
+    uint32_t set = 0;
+    uint32_t binding = 0;
+    vk::DescriptorType type = vk::DescriptorType::eUniformBuffer;
+
+    // Zero for runtime sized arrays
+    uint32_t count = 1;
+    vk::ShaderStageFlags stages;
+
+    bool operator==(const DescriptorBinding&) const = default;
+};
+
+struct VertexInput
+{
+    uint32_t location = 0;
+
+    // eUndefined for inputs without a 32 bit component format
+    vk::Format format = vk::Format::eUndefined;
+    uint32_t size = 0;
+};
+
+/*
+ * Resource interface of a shader's first entry point, parsed from the SPIR-V. Uniform buffers are
+ * reported as eUniformBuffer, dynamic offsets are a binding time choice the binary does not carry.
+ */
+struct ShaderReflection
+{
+    vk::ShaderStageFlagBits stage = vk::ShaderStageFlagBits::eVertex;
+
+    // Sorted by set, then binding
+    std::vector<DescriptorBinding> bindings;
+
+    // Byte range of the push constant block, empty when there is none
+    uint32_t pushConstantOffset = 0;
+    uint32_t pushConstantSize = 0;
+
+    // Vertex stage only, sorted by location, built-ins excluded
+    std::vector<VertexInput> vertexInputs;
+};
+
+vk::Result reflectShader(const void* pCode, size_t size, ShaderReflection& reflection);
+
+/*
+ * Fills desc's vertex input state from a vertex shader's inputs, as one interleaved binding with
+ * the attributes tightly packed in location order, so the vertex struct has to lay its members out
+ * the same way. Fails with eErrorFormatNotSupported when an input has no vertex format, and with
+ * eErrorInitializationFailed past kMaxVertexAttributes inputs.
+ */
+vk::Result setVertexInputs(const ShaderReflection& vertexShader, uint32_t binding,
+                     GraphicsPipelineDesc& desc);
+
+struct ReflectedLayout
+{
+    vk::PipelineLayout layout;
+
+    uint32_t setCount = 0;
+    vk::DescriptorSetLayout setLayouts[kMaxDescriptorSets] = {};
+
+    // Stages to pass to pushConstants, the merged stages of every shader declaring the block
+    vk::ShaderStageFlags pushConstantStages;
+};
+
+/*
+ * Builds pipeline and descriptor set layouts from the merged reflection of a pipeline's stages.
+ * Both are cached by content, so pipelines whose shaders declare the same interface get the very
+ * same layout handles and descriptor sets bound for one stay valid for the other. Runtime sized
+ * arrays need the descriptor indexing capability. Not thread safe.
+ */
+class PipelineLayoutCache
+{
+  public:
+    void init(Context* ctx);
+
+    // Destroys every layout handed out
+    void destroy();
+
+    vk::Result get(std::span<const ShaderReflection* const> stages, ReflectedLayout& layout);
+
+  private:
+    struct SetKey
+    {
+        std::vector<DescriptorBinding> bindings;
+
+        bool operator==(const SetKey&) const = default;
+    };
+
+    struct LayoutKey
+    {
+        uint32_t setCount = 0;
+        vk::DescriptorSetLayout setLayouts[kMaxDescriptorSets] = {};
+        vk::ShaderStageFlags pushConstantStages;
+        uint32_t pushConstantSize = 0;
+
+        bool operator==(const LayoutKey&) const = default;
+    };
+
+    struct KeyHash
+    {
+        size_t operator()(const SetKey& key) const;
+        size_t operator()(const LayoutKey& key) const;
+    };
+
+    vk::Result getSetLayout(std::span<const DescriptorBinding> bindings,
+                            vk::DescriptorSetLayout& setLayout);
+
+    Context* mCtx = nullptr;
+
+    std::unordered_map<SetKey, vk::DescriptorSetLayout, KeyHash> mSetLayouts;
+    std::unordered_map<LayoutKey, ReflectedLayout, KeyHash> mLayouts;
+};
+
+}  // namespace pyroc::backend::vulkan
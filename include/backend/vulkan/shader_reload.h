@@ -0,0 +1,98 @@
+#pragma once
+
+#include "api.h"
+#include "shader_reflection.h"
+
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace pyroc::backend::vulkan
+{
+
+class Context;
+
+struct ShaderReloaderCreateInfo
+{
+    // Looked up on PATH unless it has a directory
+    const char* pCompilerPath = "glslc";
+    const char* pTargetEnv = "vulkan1.3";
+};
+
+struct ShaderReload
+{
+    // As returned by watch()
+    uint32_t id = 0;
+
+    // Owned by the context's shader cache
+    vk::ShaderModule module;
+    ShaderReflection reflection;
+};
+
+/*
+ * Development aid recompiling GLSL sources as they are edited. A worker thread waits on inotify for
+ * writes to the watched sources and the headers they include, runs glslc on the changed ones and
+ * keeps the binaries. poll() turns them into modules on the calling thread, so pipelines can be
+ * swapped at a frame boundary of the caller's choosing. Compile errors go to stderr and leave the
+ * previous module in place. Linux only, init() returns eErrorFeatureNotPresent elsewhere.
+ */
+class ShaderReloader
+{
+  public:
+    vk::Result init(Context* ctx, const ShaderReloaderCreateInfo* pCreateInfo);
+    void destroy();
+
+    // Watches sourcePath and, once the worker has scanned it, the files it includes
+    vk::Result watch(const char* sourcePath, uint32_t& id);
+
+    /*
+     * Appends a reload for every shader recompiled since the last call, never blocks on glslc.
+     * Binaries that fail to reflect or to become a module are logged and skipped.
+     */
+    vk::Result poll(std::vector<ShaderReload>& reloads);
+
+  private:
+    struct Source
+    {
+        uint32_t id = 0;
+        std::string path;
+        std::vector<std::string> dependencies;
+        bool dirty = false;
+    };
+
+    struct Compiled
+    {
+        uint32_t id = 0;
+        std::vector<uint32_t> code;
+    };
+
+    void workerLoop();
+
+    // Runs glslc, dependenciesOnly skips code generation. Returns false on a compile error
+    bool compile(Source& source, bool dependenciesOnly, std::vector<uint32_t>& code);
+    void watchDirectories(const Source& source);
+
+    Context* mCtx = nullptr;
+
+    std::string mCompilerPath;
+    std::string mTargetEnv;
+    std::string mTempPrefix;
+
+    int mInotify = -1;
+    int mWakeEvent = -1;
+    std::thread mWorker;
+
+    // Worker thread only
+    std::vector<Source> mSources;
+    std::unordered_map<int, std::string> mDirectories;
+
+    std::mutex mMutex;
+    std::vector<Source> mAdded;
+    std::vector<Compiled> mCompiled;
+    uint32_t mNextId = 1;
+    bool mStopping = false;
+};
+
+}  // namespace pyroc::backend::vulkan
@@ -0,0 +1,121 @@
+#pragma once
+
+#include "api.h"
+#include "buffer.h"
+
+#include <span>
+#include <vector>
+
+namespace pyroc::backend::vulkan
+{
+
+class Context;
+
+struct StagingRingCreateInfo
+{
+    vk::DeviceSize size = vk::DeviceSize{16} << 20;
+    uint32_t framesInFlight = 2;
+
+    // Copies queued per frame that fit without growing the host side copy list
+    uint32_t maxCopiesPerFrame = 256;
+};
+
+/*
+ * Persistently mapped upload ring. Each frame sub-allocates its uploads from the ring, and flush()
+ * records every queued copy into one command buffer, submitted on the graphics queue ahead of the
+ * frame's rendering. Space is recycled once the fence of the submission that used it signals, so
+ * streaming data does not allocate device memory at steady state. A frame that flushes more than
+ * once records into another command buffer of its slot rather than waiting on the first, the slot
+ * keeps as many as it has needed.
+ *
+ * Call beginFrame() once per frame before staging, and flush() before submitting work that reads
+ * the destinations. Not thread safe.
+ */
+class StagingRing
+{
+  public:
+    vk::Result init(Context* ctx, const StagingRingCreateInfo* pCreateInfo);
+    void destroy();
+
+    // Moves to the next frame slot, waiting for the GPU to finish with it if needed
+    vk::Result beginFrame();
+
+    /*
+     * Copies size bytes of pData into the ring and queues a copy to dst at dstOffset.
+     * Returns eErrorOutOfDeviceMemory when the ring has no room left until older frames retire.
+     */
+    vk::Result stage(const void* pData, vk::DeviceSize size, Buffer& dst,
+                     vk::DeviceSize dstOffset);
+
+    /*
+     * Reserves ring space for the caller to write into directly, queueing a copy to dst. Returns
+     * nullptr when the ring is full.
+     */
+    void* reserve(vk::DeviceSize size, Buffer& dst, vk::DeviceSize dstOffset);
+
+    /*
+     * Copies pData to dst right away through cmdBuf and waits for that copy alone. Queued copies
+     * stay queued, and the ring space is handed back before returning. Returns
+     * eErrorOutOfDeviceMemory when the ring has no room.
+     */
+    vk::Result copyBlocking(vk::CommandBuffer cmdBuf, const void* pData, vk::DeviceSize size,
+                            Buffer& dst, vk::DeviceSize dstOffset);
+
+    // Submits the queued copies, optionally waiting until they have completed
+    vk::Result flush(bool wait);
+
+    vk::DeviceSize capacity() const { return mCapacity; }
+    vk::DeviceSize used() const { return mUsed; }
+
+  private:
+    struct Submission
+    {
+        vk::CommandBuffer commandBuffer;
+        vk::Fence fence;
+
+        // Ring position after the submission's uploads and the bytes to hand back when it retires
+        vk::DeviceSize end = 0;
+        vk::DeviceSize consumed = 0;
+        uint64_t index = 0;
+        bool pending = false;
+    };
+
+    struct Frame
+    {
+        std::vector<Submission> submissions;
+
+        // Submissions recorded since the slot was last begun
+        uint32_t submissionCount = 0;
+    };
+
+    vk::Result addSubmission(Frame& frame);
+
+    // Returns the ring offset of size bytes, or ~0 when it does not fit
+    vk::DeviceSize allocate(vk::DeviceSize size, vk::DeviceSize alignment);
+
+    // Newest pending submission of frames, or nullptr when none is pending
+    Submission* newestPending(std::span<Frame> frames);
+
+    // Waits for submission and releases the space of it and every submission made before it
+    vk::Result retire(const Submission& submission);
+    void release(Submission& submission);
+
+    Context* mCtx = nullptr;
+
+    Buffer mBuffer;
+    vk::DeviceSize mCapacity = 0;
+    vk::DeviceSize mHead = 0;
+    vk::DeviceSize mTail = 0;
+    vk::DeviceSize mUsed = 0;
+    vk::DeviceSize mFrameConsumed = 0;
+
+    vk::CommandPool mCommandPool;
+    std::vector<Frame> mFrames;
+    uint32_t mFrameIndex = 0;
+    uint64_t mSubmissionCount = 0;
+
+    std::vector<vk::Buffer> mCopyTargets;
+    std::vector<vk::BufferCopy> mCopyRegions;
+};
+
+}  // namespace pyroc::backend::vulkan
@@ -2,11 +2,21 @@
 
 #include "api.h"
 
+#include <vector>
+
 namespace pyroc::backend::vulkan
 {
 
 class Context;
 
+// A swapchain replaced by recreateSurface, kept until the last frame that used it has finished
+struct RetiredSwapchain
+{
+    vk::SwapchainKHR swapchain;
+    std::vector<vk::ImageView> imageViews;
+    vk::Fence fence;
+};
+
 struct Surface
 {
     vk::SurfaceKHR surface;
@@ -15,16 +25,34 @@ struct Surface
     vk::Extent2D extent;
     std::vector<vk::Image> swapchainImages;
     std::vector<vk::ImageView> swapchainImageViews;
+    std::vector<RetiredSwapchain> retiredSwapchains;
 };
 
 struct SurfaceCreateInfo
 {
     vk::SurfaceKHR surface;
     vk::Extent2D extent;
+
+    /*
+     * recreateSurface only. Fence of the last submission rendering to the current swapchain's
+     * images, null when the caller knows the device is done with them.
+     */
+    vk::Fence retireFence;
 };
 
 vk::Result createSurface(Context* ctx, const SurfaceCreateInfo* createInfo, Surface& surface);
+
+/*
+ * Creates a new swapchain from the current one without waiting on the device. The old swapchain
+ * and its image views are retired until createInfo->retireFence signals. Framebuffers and other
+ * objects made from the old views are the caller's to defer likewise.
+ */
 vk::Result recreateSurface(Context* ctx, const SurfaceCreateInfo* createInfo, Surface& surface);
+
+// Destroys retired swapchains whose fence has signalled, call once a frame before resetting fences
+void releaseRetiredSwapchains(Context* ctx, Surface& surface);
+
+// The device must be idle, retired swapchains are destroyed too
 void destroySurface(Context* ctx, Surface& surface);
 
 }  // namespace pyroc::backend::vulkan
\ No newline at end of file
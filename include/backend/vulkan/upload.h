@@ -0,0 +1,117 @@
+#pragma once
+
+#include "api.h"
+#include "buffer.h"
+#include "memory.h"
+
+#include <mutex>
+#include <vector>
+
+namespace pyroc::backend::vulkan
+{
+
+class Context;
+
+/*
+ * Completion token of an asynchronous upload, the value the upload queue's timeline semaphore
+ * reaches once the copy is done. A zero value is always complete.
+ */
+struct UploadToken
+{
+    uint64_t value = 0;
+};
+
+struct UploadQueueCreateInfo
+{
+    // Uploads larger than this are copied through it in stagingSize pieces
+    vk::DeviceSize stagingSize = vk::DeviceSize{32} << 20;
+};
+
+/*
+ * Uploads buffer data on the context's transfer queue, a dedicated transfer family when the device
+ * has one, without stalling the graphics queue. Uploads are batched into one submission until
+ * submit() (or a wait on one of them). Thread safe.
+ *
+ * Destinations are created with createTarget(), which shares them concurrently with the graphics
+ * family when the transfer family differs, so re-uploading never needs an ownership transfer. The
+ * renderer makes its first submission reading an upload wait on semaphore() at the token value.
+ * Overwriting data the GPU may still be reading is the caller's to avoid, e.g. by waiting for the
+ * frames that read it.
+ */
+class UploadQueue
+{
+  public:
+    vk::Result init(Context* ctx, const UploadQueueCreateInfo* pCreateInfo);
+    void destroy();
+
+    // Device local buffer the queue can upload to, eTransferDst is added to usage
+    vk::Result createTarget(vk::DeviceSize size, vk::BufferUsageFlags usage, Buffer& buffer);
+
+    /*
+     * Copies size bytes of pData to dst at dstOffset. Waits for earlier batches when the staging
+     * buffer is full, and splits uploads larger than it across several batches.
+     */
+    vk::Result upload(const void* pData, vk::DeviceSize size, Buffer& dst,
+                      vk::DeviceSize dstOffset, UploadToken& token);
+
+    // Submits the uploads recorded so far
+    vk::Result submit();
+
+    // Does not submit, a token of the batch still being recorded stays incomplete until submit()
+    bool isComplete(UploadToken token);
+    vk::Result wait(UploadToken token, uint64_t timeout);
+
+    vk::Semaphore semaphore() const { return mSemaphore; }
+
+    // Stages at which uploaded data may be first read
+    static constexpr vk::PipelineStageFlags kConsumerStages
+        = vk::PipelineStageFlagBits::eVertexInput | vk::PipelineStageFlagBits::eVertexShader
+          | vk::PipelineStageFlagBits::eFragmentShader | vk::PipelineStageFlagBits::eComputeShader
+          | vk::PipelineStageFlagBits::eTransfer;
+
+  private:
+    struct Batch
+    {
+        vk::CommandBuffer commandBuffer;
+        uint64_t value = 0;
+        std::vector<uint32_t> stagingNodes;
+
+        // Destinations written so far, a second write to one is ordered after the first
+        std::vector<vk::Buffer> targets;
+    };
+
+    vk::Result beginBatch();
+
+    // Copies up to the staging size, waiting for room in the staging buffer if needed
+    vk::Result uploadChunkLocked(const void* pData, vk::DeviceSize size, Buffer& dst,
+                                 vk::DeviceSize dstOffset);
+
+    vk::Result submitLocked();
+    uint64_t completedValue();
+
+    // Returns staging ranges and command buffers of finished batches
+    void collectLocked();
+
+    Context* mCtx = nullptr;
+    uint32_t mTransferFamily = ~0u;
+    uint32_t mGraphicsFamily = ~0u;
+
+    Buffer mStaging;
+    vk::DeviceSize mStagingSize = 0;
+    RangeAllocator mStagingRanges;
+
+    vk::CommandPool mCommandPool;
+    vk::Semaphore mSemaphore;
+
+    // Value the batch being recorded will signal
+    uint64_t mNextValue = 1;
+
+    std::vector<Batch> mBatches;
+    std::vector<uint32_t> mInFlight;
+    std::vector<uint32_t> mFreeBatches;
+    uint32_t mRecording = ~0u;
+
+    std::mutex mMutex;
+};
+
+}  // namespace pyroc::backend::vulkan
@@ -2,19 +2,118 @@
 
 #include "math/math.h"
 
+#include <cstdint>
+
 namespace pyroc::core
 {
-struct Camera
+enum class ProjectionType
+{
+    ePerspective = 0,
+    eOrthographic = 1,
+};
+
+enum class DepthMode
 {
-    math::vec3 eye;
-    math::vec3 center;
-    math::vec3 up;
-    float fovY;
-    float aspect;
-    float nearPlane;
-    float farPlane;
-
-    math::mat4 viewMatrix() const;
-    math::mat4 projectionMatrix() const;
+    eStandard = 0,  // near -> 0, far -> 1, LESS compare, clear to 1
+    eReverseZ = 1,  // near -> 1, far -> 0, GREATER compare, clear to 0
+};
+
+struct CameraCreateInfo
+{
+    math::vec3 eye = {};
+    math::vec3 center = {};
+    math::vec3 up = {};
+    float fovY = 45.0f;
+    float aspect = 1.0f;
+    float nearPlane = 0.1f;
+    float farPlane = 100.0f;
+    ProjectionType projectionType = ProjectionType::ePerspective;
+    DepthMode depthMode = DepthMode::eStandard;
+    bool infiniteFarPlane = false;  // Perspective only, farPlane is ignored when set
+    float orthographicHeight = 10.0f;  // World space height of the orthographic view volume
+};
+
+/*
+ * Perspective or orthographic camera that caches its matrices, picked by projectionType and
+ * switchable at runtime. Setters only mark the affected matrices dirty, and they are rebuilt on
+ * the next access. version() changes whenever any parameter does, so
+ * consumers (UBO uploads, culling) can skip work when it matches the last value they saw.
+ *
+ * Matrix accessors update the cache and are not safe to call concurrently.
+ */
+class Camera
+{
+  public:
+    void init(const CameraCreateInfo* createInfo);
+
+    void setLookAt(const math::vec3& eye, const math::vec3& center, const math::vec3& up);
+    void setEye(const math::vec3& eye);
+    void setCenter(const math::vec3& center);
+    void setUp(const math::vec3& up);
+
+    void setPerspective(float fovY, float aspect, float nearPlane, float farPlane);
+    void setFovY(float fovY);
+    void setAspect(float aspect);
+    void setPlanes(float nearPlane, float farPlane);
+    void setProjectionType(ProjectionType projectionType);
+    void setDepthMode(DepthMode depthMode);
+    void setInfiniteFarPlane(bool infiniteFarPlane);
+    void setOrthographicHeight(float orthographicHeight);
+
+    const math::vec3& eye() const { return mEye; }
+    const math::vec3& center() const { return mCenter; }
+    const math::vec3& up() const { return mUp; }
+    float fovY() const { return mFovY; }
+    float aspect() const { return mAspect; }
+    float nearPlane() const { return mNearPlane; }
+    float farPlane() const { return mFarPlane; }
+    ProjectionType projectionType() const { return mProjectionType; }
+    DepthMode depthMode() const { return mDepthMode; }
+    bool infiniteFarPlane() const { return mInfiniteFarPlane; }
+    float orthographicHeight() const { return mOrthographicHeight; }
+
+    // Depth value the depth attachment should be cleared to for depthMode()
+    float clearDepth() const { return mDepthMode == DepthMode::eReverseZ ? 0.0f : 1.0f; }
+
+    uint64_t version() const { return mVersion; }
+
+    const math::mat4& viewMatrix() const;
+    const math::mat4& projectionMatrix() const;
+    const math::mat4& viewProjectionMatrix() const;
+    const math::mat4& inverseViewProjectionMatrix() const;
+
+  private:
+    enum DirtyFlagBits : uint32_t
+    {
+        eView = 1u << 0,
+        eProjection = 1u << 1,
+        eViewProjection = 1u << 2,
+        eInverseViewProjection = 1u << 3,
+        eViewDependents = eView | eViewProjection | eInverseViewProjection,
+        eProjectionDependents = eProjection | eViewProjection | eInverseViewProjection,
+        eAll = eViewDependents | eProjectionDependents,
+    };
+
+    void markDirty(uint32_t flags);
+
+    math::vec3 mEye = {};
+    math::vec3 mCenter = {};
+    math::vec3 mUp = {};
+    float mFovY = 45.0f;
+    float mAspect = 1.0f;
+    float mNearPlane = 0.1f;
+    float mFarPlane = 100.0f;
+    ProjectionType mProjectionType = ProjectionType::ePerspective;
+    DepthMode mDepthMode = DepthMode::eStandard;
+    bool mInfiniteFarPlane = false;
+    float mOrthographicHeight = 10.0f;
+
+    uint64_t mVersion = 0;
+
+    mutable uint32_t mDirty = eAll;
+    mutable math::mat4 mView = math::mat4::identity();
+    mutable math::mat4 mProjection = math::mat4::identity();
+    mutable math::mat4 mViewProjection = math::mat4::identity();
+    mutable math::mat4 mInverseViewProjection = math::mat4::identity();
 };
 }  // namespace pyroc::core
@@ -0,0 +1,52 @@
+#pragma once
+
+#include "math/math.h"
+
+#include <cstdint>
+#include <span>
+
+namespace pyroc::core
+{
+class Camera;
+
+/*
+ * Normalized world space planes (n.x, n.y, n.z, d). A point p is inside a plane when
+ * dot(n, p) + d >= 0.
+ */
+struct Frustum
+{
+    enum Plane : uint32_t
+    {
+        eLeft = 0,
+        eRight,
+        eBottom,
+        eTop,
+        eNear,
+        eFar,
+        eCount,
+    };
+
+    math::vec4 planes[eCount];
+};
+
+/*
+ * Extracts the planes of the 0..1 depth clip volume of viewProjection. Degenerate planes (e.g.
+ * the far plane of an infinite projection) are replaced by a plane that accepts everything.
+ * reverseZ must match the projection so eNear/eFar are assigned correctly.
+ */
+Frustum makeFrustum(const math::mat4& viewProjection, bool reverseZ = false);
+Frustum makeFrustum(const Camera& camera);
+
+bool isSphereVisible(const Frustum& frustum, const math::vec3& center, float radius);
+bool isAabbVisible(const Frustum& frustum, const math::vec3& center, const math::vec3& extents);
+
+/*
+ * Batch tests over SoA bounds. Bit i % 64 of visibility[i / 64] is set when object i intersects
+ * the frustum; bits past the last object are cleared. The object count is the smallest of the
+ * input sizes and visibility.size() * 64.
+ */
+void cullSpheres(const Frustum& frustum, math::soa3<const float> centers,
+                 std::span<const float> radii, std::span<uint64_t> visibility);
+void cullAabbs(const Frustum& frustum, math::soa3<const float> centers,
+               math::soa3<const float> extents, std::span<uint64_t> visibility);
+}  // namespace pyroc::core
@@ -0,0 +1,53 @@
+#pragma once
+
+#include "types/mat4_float.h"
+#include "types/quat_float.h"
+#include "types/vec3_float.h"
+
+#include <span>
+
+namespace pyroc::math
+{
+/*
+ * Structure of arrays view over 3 component data, each span holding one component.
+ * All three spans must have the same length.
+ */
+template <typename T>
+struct soa3
+{
+    std::span<T> x;
+    std::span<T> y;
+    std::span<T> z;
+
+    constexpr size_t size() const { return x.size(); }
+};
+
+/*
+ * Batch transforms over arrays of points/directions.
+ *
+ * Matrices are applied the way the shaders consume them: m[3] holds the translation, so a point p
+ * maps to m[0] * p.x + m[1] * p.y + m[2] * p.z + m[3]. Directions skip the translation.
+ * min(in.size(), out.size()) elements are processed, and in may alias out exactly.
+ */
+void transformPoints(const mat4& m, std::span<const vec3> in, std::span<vec3> out);
+void transformPoints(const mat4& m, soa3<const float> in, soa3<float> out);
+
+void transformDirections(const mat4& m, std::span<const vec3> in, std::span<vec3> out);
+void transformDirections(const mat4& m, soa3<const float> in, soa3<float> out);
+
+/*
+ * out[i] = lhs[i] * rhs[i], following operator*. For a transform hierarchy pass the local
+ * transforms as lhs and the parent world transforms as rhs.
+ */
+void multiplyMatrices(std::span<const mat4> lhs, std::span<const mat4> rhs, std::span<mat4> out);
+
+// out[i] = lhs[i] * rhs
+void multiplyMatrices(std::span<const mat4> lhs, const mat4& rhs, std::span<mat4> out);
+
+/*
+ * Builds translation * rotation * scale matrices (in shader order) from unit quaternions,
+ * equivalent to toMat4(rotations[i]) with its basis columns scaled and translations[i] in m[3].
+ */
+void composeTransforms(std::span<const fquat> rotations, std::span<const vec3> translations,
+                       std::span<const vec3> scales, std::span<mat4> out);
+}  // namespace pyroc::math
@@ -24,6 +24,84 @@ constexpr mat<4, 4, T> perspective(T fovYRad, T aspect, T nearPlane, T farPlane)
     return result;
 }
 
+/*
+ * Reverse-Z variant of perspective, near maps to depth 1 and far to depth 0. Pair with a
+ * GREATER depth compare and a depth clear of 0 to spread float precision evenly over the range.
+ */
+template <typename T>
+constexpr mat<4, 4, T> perspectiveReverseZ(T fovYRad, T aspect, T nearPlane, T farPlane)
+{
+    mat<4, 4, T> result = perspective(fovYRad, aspect, nearPlane, farPlane);
+
+    result[2][2] = -static_cast<T>(nearPlane) / (farPlane - nearPlane);
+    result[3][2] = static_cast<T>(farPlane * nearPlane) / (farPlane - nearPlane);
+
+    return result;
+}
+
+/*
+ * perspective with the far plane at infinity, depth approaches 1 as view z grows
+ */
+template <typename T>
+constexpr mat<4, 4, T> perspectiveInfinite(T fovYRad, T aspect, T nearPlane)
+{
+    mat<4, 4, T> result = perspective(fovYRad, aspect, nearPlane, static_cast<T>(1));
+
+    result[2][2] = static_cast<T>(1);
+    result[3][2] = -static_cast<T>(nearPlane);
+
+    return result;
+}
+
+/*
+ * Reverse-Z with the far plane at infinity, depth is nearPlane / z and approaches 0
+ */
+template <typename T>
+constexpr mat<4, 4, T> perspectiveInfiniteReverseZ(T fovYRad, T aspect, T nearPlane)
+{
+    mat<4, 4, T> result = perspective(fovYRad, aspect, nearPlane, static_cast<T>(1));
+
+    result[2][2] = static_cast<T>(0);
+    result[3][2] = static_cast<T>(nearPlane);
+
+    return result;
+}
+
+/*
+ * Orthographic projection with the same conventions as perspective, depth 0 at near and 1 at far
+ */
+template <typename T>
+constexpr mat<4, 4, T> orthographic(T left, T right, T bottom, T top, T nearPlane, T farPlane)
+{
+    mat<4, 4, T> result = mat<4, 4, T>::identity();
+
+    result[0][0] = static_cast<T>(2) / (right - left);
+    result[3][0] = -(right + left) / (right - left);
+
+    result[1][1] = static_cast<T>(2) / (top - bottom);
+    result[3][1] = -(top + bottom) / (top - bottom);
+
+    result[2][2] = static_cast<T>(1) / (farPlane - nearPlane);
+    result[3][2] = -nearPlane / (farPlane - nearPlane);
+
+    return result;
+}
+
+/*
+ * Reverse-Z variant of orthographic, depth 1 at near and 0 at far
+ */
+template <typename T>
+constexpr mat<4, 4, T> orthographicReverseZ(T left, T right, T bottom, T top, T nearPlane,
+                                            T farPlane)
+{
+    mat<4, 4, T> result = orthographic(left, right, bottom, top, nearPlane, farPlane);
+
+    result[2][2] = -static_cast<T>(1) / (farPlane - nearPlane);
+    result[3][2] = farPlane / (farPlane - nearPlane);
+
+    return result;
+}
+
 template <typename T>
 constexpr T radians(T degrees)
 {
@@ -8,4 +8,8 @@
 #include "types/mat.h"
 #include "types/mat4_float.h"
 
+#include "types/quat.h"
+#include "types/quat_float.h"
+
+#include "batch.h"
 #include "func.h"
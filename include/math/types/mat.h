@@ -2,6 +2,8 @@
 
 #include "qualifier.h"
 
+#include <algorithm>
+
 namespace pyroc::math
 {
 template <size_t N, size_t M, typename T>
@@ -10,7 +12,7 @@ union mat
     typename detail::storage<N, vec<M, T>>::type cols;
 
     constexpr vec<M, T>& operator[](size_t i) { return cols[i]; }
-    constexpr vec<M, T>& operator[](size_t i) const { return cols[i]; }
+    constexpr const vec<M, T>& operator[](size_t i) const { return cols[i]; }
 
     static constexpr mat<N, M, T> identity()
     {
@@ -53,4 +55,174 @@ constexpr vec<N, T> operator*(const mat<N, M, T>& lhs, const vec<N, T>& rhs)
     }
     return result;
 }
+
+template <size_t N, size_t M, typename T>
+constexpr mat<M, N, T> transpose(const mat<N, M, T>& m)
+{
+    mat<M, N, T> result = {};
+    for (size_t i = 0; i < N; ++i)
+    {
+        for (size_t j = 0; j < M; ++j)
+        {
+            result[j][i] = m[i][j];
+        }
+    }
+    return result;
+}
+
+/*
+ * General 4x4 inverse via 2x2 sub-determinants. Singular matrices produce a zero matrix.
+ */
+template <typename T>
+constexpr mat<4, 4, T> inverse(const mat<4, 4, T>& m)
+{
+    const T s0 = m[0][0] * m[1][1] - m[1][0] * m[0][1];
+    const T s1 = m[0][0] * m[1][2] - m[1][0] * m[0][2];
+    const T s2 = m[0][0] * m[1][3] - m[1][0] * m[0][3];
+    const T s3 = m[0][1] * m[1][2] - m[1][1] * m[0][2];
+    const T s4 = m[0][1] * m[1][3] - m[1][1] * m[0][3];
+    const T s5 = m[0][2] * m[1][3] - m[1][2] * m[0][3];
+
+    const T c5 = m[2][2] * m[3][3] - m[3][2] * m[2][3];
+    const T c4 = m[2][1] * m[3][3] - m[3][1] * m[2][3];
+    const T c3 = m[2][1] * m[3][2] - m[3][1] * m[2][2];
+    const T c2 = m[2][0] * m[3][3] - m[3][0] * m[2][3];
+    const T c1 = m[2][0] * m[3][2] - m[3][0] * m[2][2];
+    const T c0 = m[2][0] * m[3][1] - m[3][0] * m[2][1];
+
+    const T det = s0 * c5 - s1 * c4 + s2 * c3 + s3 * c2 - s4 * c1 + s5 * c0;
+
+    mat<4, 4, T> result = {};
+    if (det == static_cast<T>(0))
+    {
+        return result;
+    }
+
+    const T invDet = static_cast<T>(1) / det;
+
+    result[0][0] = (m[1][1] * c5 - m[1][2] * c4 + m[1][3] * c3) * invDet;
+    result[0][1] = (-m[0][1] * c5 + m[0][2] * c4 - m[0][3] * c3) * invDet;
+    result[0][2] = (m[3][1] * s5 - m[3][2] * s4 + m[3][3] * s3) * invDet;
+    result[0][3] = (-m[2][1] * s5 + m[2][2] * s4 - m[2][3] * s3) * invDet;
+
+    result[1][0] = (-m[1][0] * c5 + m[1][2] * c2 - m[1][3] * c1) * invDet;
+    result[1][1] = (m[0][0] * c5 - m[0][2] * c2 + m[0][3] * c1) * invDet;
+    result[1][2] = (-m[3][0] * s5 + m[3][2] * s2 - m[3][3] * s1) * invDet;
+    result[1][3] = (m[2][0] * s5 - m[2][2] * s2 + m[2][3] * s1) * invDet;
+
+    result[2][0] = (m[1][0] * c4 - m[1][1] * c2 + m[1][3] * c0) * invDet;
+    result[2][1] = (-m[0][0] * c4 + m[0][1] * c2 - m[0][3] * c0) * invDet;
+    result[2][2] = (m[3][0] * s4 - m[3][1] * s2 + m[3][3] * s0) * invDet;
+    result[2][3] = (-m[2][0] * s4 + m[2][1] * s2 - m[2][3] * s0) * invDet;
+
+    result[3][0] = (-m[1][0] * c3 + m[1][1] * c1 - m[1][2] * c0) * invDet;
+    result[3][1] = (m[0][0] * c3 - m[0][1] * c1 + m[0][2] * c0) * invDet;
+    result[3][2] = (-m[3][0] * s3 + m[3][1] * s1 - m[3][2] * s0) * invDet;
+    result[3][3] = (m[2][0] * s3 - m[2][1] * s1 + m[2][2] * s0) * invDet;
+
+    return result;
+}
+
+namespace detail
+{
+// Rows of the adjugate of the upper 3x3: the cross products of basis columns (1, 2), (2, 0), (0, 1)
+template <typename T>
+constexpr void adjugateRows3(const mat<4, 4, T>& m, T (&r)[3][3])
+{
+    for (size_t i = 0; i < 3; ++i)
+    {
+        const vec<4, T>& a = m[(i + 1) % 3];
+        const vec<4, T>& b = m[(i + 2) % 3];
+        r[i][0] = a[1] * b[2] - a[2] * b[1];
+        r[i][1] = a[2] * b[0] - a[0] * b[2];
+        r[i][2] = a[0] * b[1] - a[1] * b[0];
+    }
+}
+}  // namespace detail
+
+/*
+ * Inverse of an affine transform, i.e. m[0..2][3] == 0 and m[3][3] == 1 (m[3] holds the
+ * translation). The rows of the inverse 3x3 are the cross products of the basis columns divided
+ * by the determinant. Singular matrices produce a zero matrix.
+ */
+template <typename T>
+constexpr mat<4, 4, T> inverseAffine(const mat<4, 4, T>& m)
+{
+    T r[3][3] = {};
+    detail::adjugateRows3(m, r);
+
+    const T det = m[0][0] * r[0][0] + m[0][1] * r[0][1] + m[0][2] * r[0][2];
+
+    mat<4, 4, T> result = {};
+    if (det == static_cast<T>(0))
+    {
+        return result;
+    }
+
+    const T invDet = static_cast<T>(1) / det;
+
+    for (size_t i = 0; i < 3; ++i)
+    {
+        for (size_t j = 0; j < 3; ++j)
+        {
+            result[j][i] = r[i][j] * invDet;
+        }
+        result[3][i] = -(r[i][0] * m[3][0] + r[i][1] * m[3][1] + r[i][2] * m[3][2]) * invDet;
+    }
+    result[3][3] = static_cast<T>(1);
+
+    return result;
+}
+
+/*
+ * Inverse of a rigid transform (orthonormal basis plus translation), the 3x3 part is transposed
+ */
+template <typename T>
+constexpr mat<4, 4, T> inverseRigid(const mat<4, 4, T>& m)
+{
+    mat<4, 4, T> result = {};
+    for (size_t i = 0; i < 3; ++i)
+    {
+        for (size_t j = 0; j < 3; ++j)
+        {
+            result[j][i] = m[i][j];
+        }
+        result[3][i] = -(m[i][0] * m[3][0] + m[i][1] * m[3][1] + m[i][2] * m[3][2]);
+    }
+    result[3][3] = static_cast<T>(1);
+
+    return result;
+}
+
+/*
+ * Normal matrix: inverse-transpose of the upper 3x3 with the translation dropped. Singular
+ * matrices produce a zero matrix.
+ */
+template <typename T>
+constexpr mat<4, 4, T> inverseTranspose(const mat<4, 4, T>& m)
+{
+    T r[3][3] = {};
+    detail::adjugateRows3(m, r);
+
+    const T det = m[0][0] * r[0][0] + m[0][1] * r[0][1] + m[0][2] * r[0][2];
+
+    mat<4, 4, T> result = {};
+    if (det == static_cast<T>(0))
+    {
+        return result;
+    }
+
+    const T invDet = static_cast<T>(1) / det;
+
+    for (size_t i = 0; i < 3; ++i)
+    {
+        for (size_t j = 0; j < 3; ++j)
+        {
+            result[i][j] = r[i][j] * invDet;
+        }
+    }
+    result[3][3] = static_cast<T>(1);
+
+    return result;
+}
 }  // namespace pyroc::math
@@ -1,9 +1,319 @@
 #pragma once
 
 #include "mat.h"
+#include "simd.h"
+#include "vec4_float.h"
+
+#include <type_traits>
 
 namespace pyroc::math
 {
 typedef mat<4, 4, float> mat4;
 typedef mat<4, 4, float> fmat4;
+
+#ifdef PYROC_MATH_SIMD
+/*
+ * 4-wide overloads of the generic mat operators, matching their indexing convention:
+ * (lhs * rhs)[i][j] = sum_k lhs[i][k] * rhs[k][j] and (m * v)[i] = dot(m[i], v).
+ */
+constexpr mat4 operator*(const mat4& lhs, const mat4& rhs)
+{
+    if (std::is_constant_evaluated())
+    {
+        return operator*<4, 4, 4, float>(lhs, rhs);
+    }
+
+    const detail::float4 r0 = detail::load4(rhs[0].data.data);
+    const detail::float4 r1 = detail::load4(rhs[1].data.data);
+    const detail::float4 r2 = detail::load4(rhs[2].data.data);
+    const detail::float4 r3 = detail::load4(rhs[3].data.data);
+
+    mat4 result;
+    for (size_t i = 0; i < 4; ++i)
+    {
+        const detail::float4 l = detail::load4(lhs[i].data.data);
+
+        detail::float4 v = detail::mul4(detail::splatLane4<0>(l), r0);
+        v = detail::madd4(detail::splatLane4<1>(l), r1, v);
+        v = detail::madd4(detail::splatLane4<2>(l), r2, v);
+        v = detail::madd4(detail::splatLane4<3>(l), r3, v);
+
+        detail::store4(result[i].data.data, v);
+    }
+    return result;
+}
+
+constexpr vec4 operator*(const mat4& lhs, const vec4& rhs)
+{
+    if (std::is_constant_evaluated())
+    {
+        return operator*<4, 4, float>(lhs, rhs);
+    }
+
+    detail::float4 c0 = detail::load4(lhs[0].data.data);
+    detail::float4 c1 = detail::load4(lhs[1].data.data);
+    detail::float4 c2 = detail::load4(lhs[2].data.data);
+    detail::float4 c3 = detail::load4(lhs[3].data.data);
+    detail::transpose4(c0, c1, c2, c3);
+
+    const detail::float4 v = detail::load4(rhs.data.data);
+
+    detail::float4 r = detail::mul4(detail::splatLane4<0>(v), c0);
+    r = detail::madd4(detail::splatLane4<1>(v), c1, r);
+    r = detail::madd4(detail::splatLane4<2>(v), c2, r);
+    r = detail::madd4(detail::splatLane4<3>(v), c3, r);
+
+    vec4 result;
+    detail::store4(result.data.data, r);
+    return result;
+}
+
+constexpr mat4 transpose(const mat4& m)
+{
+    if (std::is_constant_evaluated())
+    {
+        return transpose<4, 4, float>(m);
+    }
+
+    detail::float4 r0 = detail::load4(m[0].data.data);
+    detail::float4 r1 = detail::load4(m[1].data.data);
+    detail::float4 r2 = detail::load4(m[2].data.data);
+    detail::float4 r3 = detail::load4(m[3].data.data);
+    detail::transpose4(r0, r1, r2, r3);
+
+    mat4 result;
+    detail::store4(result[0].data.data, r0);
+    detail::store4(result[1].data.data, r1);
+    detail::store4(result[2].data.data, r2);
+    detail::store4(result[3].data.data, r3);
+    return result;
+}
+
+    #ifdef PYROC_MATH_SIMD_SSE
+namespace detail
+{
+template <int x, int y, int z, int w>
+inline float4 swizzle4(float4 v)
+{
+    return _mm_shuffle_ps(v, v, _MM_SHUFFLE(w, z, y, x));
+}
+
+template <int x, int y, int z, int w>
+inline float4 shuffle4(float4 a, float4 b)
+{
+    return _mm_shuffle_ps(a, b, _MM_SHUFFLE(w, z, y, x));
+}
+
+// 2x2 blocks packed as (a00, a01, a10, a11): a * b, adj(a) * b and a * adj(b)
+inline float4 mat2Mul(float4 a, float4 b)
+{
+    return _mm_add_ps(_mm_mul_ps(a, swizzle4<0, 3, 0, 3>(b)),
+                      _mm_mul_ps(swizzle4<1, 0, 3, 2>(a), swizzle4<2, 1, 2, 1>(b)));
+}
+
+inline float4 mat2AdjMul(float4 a, float4 b)
+{
+    return _mm_sub_ps(_mm_mul_ps(swizzle4<3, 3, 0, 0>(a), b),
+                      _mm_mul_ps(swizzle4<1, 1, 2, 2>(a), swizzle4<2, 3, 0, 1>(b)));
+}
+
+inline float4 mat2MulAdj(float4 a, float4 b)
+{
+    return _mm_sub_ps(_mm_mul_ps(a, swizzle4<3, 0, 3, 0>(b)),
+                      _mm_mul_ps(swizzle4<1, 0, 3, 2>(a), swizzle4<2, 1, 2, 1>(b)));
+}
+
+// xyz cross product, w is 0 when both inputs have w == 0
+inline float4 cross4(float4 a, float4 b)
+{
+    return _mm_sub_ps(_mm_mul_ps(swizzle4<1, 2, 0, 3>(a), swizzle4<2, 0, 1, 3>(b)),
+                      _mm_mul_ps(swizzle4<2, 0, 1, 3>(a), swizzle4<1, 2, 0, 3>(b)));
+}
+
+inline float4 clearW4(float4 v)
+{
+    return _mm_and_ps(v, _mm_castsi128_ps(_mm_set_epi32(0, -1, -1, -1)));
+}
+
+inline void loadMat4(const mat4& m, float4& c0, float4& c1, float4& c2, float4& c3)
+{
+    c0 = load4(m[0].data.data);
+    c1 = load4(m[1].data.data);
+    c2 = load4(m[2].data.data);
+    c3 = load4(m[3].data.data);
+}
+
+inline void storeMat4(mat4& m, float4 c0, float4 c1, float4 c2, float4 c3)
+{
+    store4(m[0].data.data, c0);
+    store4(m[1].data.data, c1);
+    store4(m[2].data.data, c2);
+    store4(m[3].data.data, c3);
+}
+}  // namespace detail
+
+/*
+ * Block-wise 2x2 adjugate inverse. The inverse is independent of the storage order, so m[i] is
+ * treated as row i. Singular matrices produce a zero matrix, matching the generic version.
+ */
+constexpr mat4 inverse(const mat4& m)
+{
+    if (std::is_constant_evaluated())
+    {
+        return inverse<float>(m);
+    }
+
+    detail::float4 r0, r1, r2, r3;
+    detail::loadMat4(m, r0, r1, r2, r3);
+
+    const detail::float4 a = _mm_movelh_ps(r0, r1);
+    const detail::float4 b = _mm_movehl_ps(r1, r0);
+    const detail::float4 c = _mm_movelh_ps(r2, r3);
+    const detail::float4 d = _mm_movehl_ps(r3, r2);
+
+    // (|A|, |B|, |C|, |D|)
+    const detail::float4 detSub
+        = _mm_sub_ps(_mm_mul_ps(detail::shuffle4<0, 2, 0, 2>(r0, r2),
+                                detail::shuffle4<1, 3, 1, 3>(r1, r3)),
+                     _mm_mul_ps(detail::shuffle4<1, 3, 1, 3>(r0, r2),
+                                detail::shuffle4<0, 2, 0, 2>(r1, r3)));
+    const detail::float4 detA = detail::splatLane4<0>(detSub);
+    const detail::float4 detB = detail::splatLane4<1>(detSub);
+    const detail::float4 detC = detail::splatLane4<2>(detSub);
+    const detail::float4 detD = detail::splatLane4<3>(detSub);
+
+    const detail::float4 dc = detail::mat2AdjMul(d, c);
+    const detail::float4 ab = detail::mat2AdjMul(a, b);
+
+    detail::float4 x = _mm_sub_ps(_mm_mul_ps(detD, a), detail::mat2Mul(b, dc));
+    detail::float4 w = _mm_sub_ps(_mm_mul_ps(detA, d), detail::mat2Mul(c, ab));
+    detail::float4 y = _mm_sub_ps(_mm_mul_ps(detB, c), detail::mat2MulAdj(d, ab));
+    detail::float4 z = _mm_sub_ps(_mm_mul_ps(detC, b), detail::mat2MulAdj(a, dc));
+
+    // |M| = |A||D| + |B||C| - tr(adj(A)B adj(D)C)
+    detail::float4 tr = _mm_mul_ps(ab, detail::swizzle4<0, 2, 1, 3>(dc));
+    tr = _mm_add_ps(tr, detail::swizzle4<1, 0, 3, 2>(tr));
+    tr = _mm_add_ps(tr, detail::swizzle4<2, 3, 0, 1>(tr));
+    const detail::float4 det
+        = _mm_sub_ps(_mm_add_ps(_mm_mul_ps(detA, detD), _mm_mul_ps(detB, detC)), tr);
+
+    mat4 result;
+    if (_mm_cvtss_f32(det) == 0.0f)
+    {
+        result = {};
+        return result;
+    }
+
+    const detail::float4 invDet = _mm_div_ps(_mm_setr_ps(1.0f, -1.0f, -1.0f, 1.0f), det);
+    x = _mm_mul_ps(x, invDet);
+    y = _mm_mul_ps(y, invDet);
+    z = _mm_mul_ps(z, invDet);
+    w = _mm_mul_ps(w, invDet);
+
+    detail::storeMat4(result, detail::shuffle4<3, 1, 3, 1>(x, y),
+                      detail::shuffle4<2, 0, 2, 0>(x, y), detail::shuffle4<3, 1, 3, 1>(z, w),
+                      detail::shuffle4<2, 0, 2, 0>(z, w));
+    return result;
+}
+
+constexpr mat4 inverseAffine(const mat4& m)
+{
+    if (std::is_constant_evaluated())
+    {
+        return inverseAffine<float>(m);
+    }
+
+    detail::float4 c0, c1, c2, t;
+    detail::loadMat4(m, c0, c1, c2, t);
+    c0 = detail::clearW4(c0);
+    c1 = detail::clearW4(c1);
+    c2 = detail::clearW4(c2);
+
+    detail::float4 r0 = detail::cross4(c1, c2);
+    detail::float4 r1 = detail::cross4(c2, c0);
+    detail::float4 r2 = detail::cross4(c0, c1);
+
+    const float det = detail::dot4(c0, r0);
+
+    mat4 result;
+    if (det == 0.0f)
+    {
+        result = {};
+        return result;
+    }
+
+    const detail::float4 invDet = detail::splat4(1.0f / det);
+    r0 = _mm_mul_ps(r0, invDet);
+    r1 = _mm_mul_ps(r1, invDet);
+    r2 = _mm_mul_ps(r2, invDet);
+
+    detail::float4 r3 = _mm_setzero_ps();
+    detail::transpose4(r0, r1, r2, r3);
+
+    detail::float4 translation = detail::mul4(detail::splatLane4<0>(t), r0);
+    translation = detail::madd4(detail::splatLane4<1>(t), r1, translation);
+    translation = detail::madd4(detail::splatLane4<2>(t), r2, translation);
+    translation = _mm_sub_ps(_mm_setr_ps(0.0f, 0.0f, 0.0f, 1.0f), translation);
+
+    detail::storeMat4(result, r0, r1, r2, translation);
+    return result;
+}
+
+constexpr mat4 inverseRigid(const mat4& m)
+{
+    if (std::is_constant_evaluated())
+    {
+        return inverseRigid<float>(m);
+    }
+
+    detail::float4 c0, c1, c2, t;
+    detail::loadMat4(m, c0, c1, c2, t);
+    c0 = detail::clearW4(c0);
+    c1 = detail::clearW4(c1);
+    c2 = detail::clearW4(c2);
+    detail::float4 c3 = _mm_setzero_ps();
+    detail::transpose4(c0, c1, c2, c3);
+
+    detail::float4 translation = detail::mul4(detail::splatLane4<0>(t), c0);
+    translation = detail::madd4(detail::splatLane4<1>(t), c1, translation);
+    translation = detail::madd4(detail::splatLane4<2>(t), c2, translation);
+    translation = _mm_sub_ps(_mm_setr_ps(0.0f, 0.0f, 0.0f, 1.0f), translation);
+
+    mat4 result;
+    detail::storeMat4(result, c0, c1, c2, translation);
+    return result;
+}
+
+constexpr mat4 inverseTranspose(const mat4& m)
+{
+    if (std::is_constant_evaluated())
+    {
+        return inverseTranspose<float>(m);
+    }
+
+    detail::float4 c0, c1, c2, t;
+    detail::loadMat4(m, c0, c1, c2, t);
+    c0 = detail::clearW4(c0);
+    c1 = detail::clearW4(c1);
+    c2 = detail::clearW4(c2);
+
+    const detail::float4 r0 = detail::cross4(c1, c2);
+    const float det = detail::dot4(c0, r0);
+
+    mat4 result;
+    if (det == 0.0f)
+    {
+        result = {};
+        return result;
+    }
+
+    const detail::float4 invDet = detail::splat4(1.0f / det);
+    detail::storeMat4(result, _mm_mul_ps(r0, invDet),
+                      _mm_mul_ps(detail::cross4(c2, c0), invDet),
+                      _mm_mul_ps(detail::cross4(c0, c1), invDet),
+                      _mm_setr_ps(0.0f, 0.0f, 0.0f, 1.0f));
+    return result;
+}
+    #endif
+#endif
 }  // namespace pyroc::math
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
 
 namespace pyroc::math
@@ -26,6 +27,19 @@ struct storage
         constexpr const T& operator[](size_t i) const { return data[i]; }
     } type;
 };
+
+// Four float lanes are kept 16 byte aligned so vec4/mat4 can be loaded straight into SIMD registers
+template <>
+struct storage<4, float>
+{
+    typedef struct alignas(16) type
+    {
+        float data[4];
+
+        constexpr float& operator[](size_t i) { return data[i]; }
+        constexpr const float& operator[](size_t i) const { return data[i]; }
+    } type;
+};
 }  // namespace detail
 
 }  // namespace pyroc::math
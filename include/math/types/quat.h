@@ -2,17 +2,39 @@
 
 #include "qualifier.h"
 
+#include "mat.h"
 #include "vec.h"
+#include "vec3.h"
+#include "vec4.h"
+
+#include <cmath>
 
 namespace pyroc::math
 {
-template <typename L>
+/*
+ * Rotation quaternion, x/y/z hold the imaginary part and w the real part
+ */
+template <typename T>
 union quat
 {
+    struct
+    {
+        T x;
+        T y;
+        T z;
+        T w;
+    };
     vec<4, T> data;
 
     constexpr T& operator[](size_t i) { return data[i]; }
     constexpr const T& operator[](size_t i) const { return data[i]; }
+
+    static constexpr quat<T> identity()
+    {
+        quat<T> result = {};
+        result.w = static_cast<T>(1);
+        return result;
+    }
 };
 
 template <typename T>
@@ -29,4 +51,128 @@ constexpr quat<T> operator*(const quat<T>& lhs, const quat<T>& rhs)
     return result;
 }
 
+// Rotation of angleRad radians about a unit length axis
+template <typename T>
+constexpr quat<T> angleAxis(T angleRad, const vec<3, T>& axis)
+{
+    const T halfAngle = angleRad / static_cast<T>(2);
+    const T s = static_cast<T>(sin(halfAngle));
+
+    quat<T> result = {};
+    result.x = axis.x * s;
+    result.y = axis.y * s;
+    result.z = axis.z * s;
+    result.w = static_cast<T>(cos(halfAngle));
+    return result;
+}
+
+template <typename T>
+constexpr T dot(const quat<T>& lhs, const quat<T>& rhs)
+{
+    return dot(lhs.data, rhs.data);
+}
+
+template <typename T>
+constexpr quat<T> conjugate(const quat<T>& q)
+{
+    quat<T> result = {};
+    result.x = -q.x;
+    result.y = -q.y;
+    result.z = -q.z;
+    result.w = q.w;
+    return result;
+}
+
+template <typename T>
+constexpr quat<T> normalize(const quat<T>& q)
+{
+    quat<T> result = {};
+    result.data = normalize(q.data);
+    return result;
+}
+
+template <typename T>
+constexpr quat<T> inverse(const quat<T>& q)
+{
+    const T length2 = dot(q, q);
+
+    quat<T> result = {};
+    if (length2 > static_cast<T>(0))
+    {
+        result.data = (static_cast<T>(1) / length2) * conjugate(q).data;
+    }
+    return result;
+}
+
+// q * v * conjugate(q) for a unit quaternion q
+template <typename T>
+constexpr vec<3, T> rotate(const quat<T>& q, const vec<3, T>& v)
+{
+    const vec<3, T> u = {.x = q.x, .y = q.y, .z = q.z};
+    const vec<3, T> t = static_cast<T>(2) * cross(u, v);
+    return v + q.w * t + cross(u, t);
+}
+
+// Normalized linear interpolation along the shortest arc
+template <typename T>
+constexpr quat<T> nlerp(const quat<T>& a, const quat<T>& b, T t)
+{
+    const T sign = dot(a, b) < static_cast<T>(0) ? static_cast<T>(-1) : static_cast<T>(1);
+
+    quat<T> result = {};
+    result.data = normalize((static_cast<T>(1) - t) * a.data + (sign * t) * b.data);
+    return result;
+}
+
+// Spherical linear interpolation along the shortest arc, falls back to nlerp when nearly parallel
+template <typename T>
+constexpr quat<T> slerp(const quat<T>& a, const quat<T>& b, T t)
+{
+    T cosTheta = dot(a, b);
+    T sign = static_cast<T>(1);
+    if (cosTheta < static_cast<T>(0))
+    {
+        cosTheta = -cosTheta;
+        sign = static_cast<T>(-1);
+    }
+
+    if (cosTheta > static_cast<T>(0.9995))
+    {
+        return nlerp(a, b, t);
+    }
+
+    const T theta = static_cast<T>(acos(cosTheta));
+    const T invSinTheta = static_cast<T>(1) / static_cast<T>(sin(theta));
+    const T wa = static_cast<T>(sin((static_cast<T>(1) - t) * theta)) * invSinTheta;
+    const T wb = sign * static_cast<T>(sin(t * theta)) * invSinTheta;
+
+    quat<T> result = {};
+    result.data = wa * a.data + wb * b.data;
+    return result;
+}
+
+/*
+ * Rotation matrix of a unit quaternion, laid out like the other transforms (m[i] is the image of
+ * basis vector i as the shaders consume it)
+ */
+template <typename T>
+constexpr mat<4, 4, T> toMat4(const quat<T>& q)
+{
+    const T two = static_cast<T>(2);
+    const T one = static_cast<T>(1);
+
+    mat<4, 4, T> result = mat<4, 4, T>::identity();
+    result[0][0] = one - two * (q.y * q.y + q.z * q.z);
+    result[0][1] = two * (q.x * q.y + q.w * q.z);
+    result[0][2] = two * (q.x * q.z - q.w * q.y);
+
+    result[1][0] = two * (q.x * q.y - q.w * q.z);
+    result[1][1] = one - two * (q.x * q.x + q.z * q.z);
+    result[1][2] = two * (q.y * q.z + q.w * q.x);
+
+    result[2][0] = two * (q.x * q.z + q.w * q.y);
+    result[2][1] = two * (q.y * q.z - q.w * q.x);
+    result[2][2] = one - two * (q.x * q.x + q.y * q.y);
+    return result;
+}
 }  // namespace pyroc::math
@@ -0,0 +1,8 @@
+#pragma once
+
+#include "quat.h"
+
+namespace pyroc::math
+{
+typedef quat<float> fquat;
+}  // namespace pyroc::math
@@ -0,0 +1,155 @@
+#pragma once
+
+/*
+ * Compile time selection of the 4-wide float backend used by the vec4/mat4 specializations.
+ * SSE is baseline on x86-64, so it is always available there; FMA/AVX are picked up when the
+ * compiler targets them (e.g. -march=native). Define PYROC_MATH_NO_SIMD to force the generic
+ * scalar templates.
+ */
+#if !defined(PYROC_MATH_NO_SIMD) && (defined(__SSE2__) || defined(_M_X64))
+    #define PYROC_MATH_SIMD 1
+    #define PYROC_MATH_SIMD_SSE 1
+    #if defined(__AVX2__) && defined(__FMA__)
+        #define PYROC_MATH_SIMD_AVX2 1
+    #endif
+    #include <immintrin.h>
+#elif !defined(PYROC_MATH_NO_SIMD) && defined(__ARM_NEON) && defined(__aarch64__)
+    #define PYROC_MATH_SIMD 1
+    #define PYROC_MATH_SIMD_NEON 1
+    #include <arm_neon.h>
+#endif
+
+#ifdef PYROC_MATH_SIMD
+
+namespace pyroc::math::detail
+{
+#if defined(PYROC_MATH_SIMD_SSE)
+typedef __m128 float4;
+
+inline float4 load4(const float* p) { return _mm_load_ps(p); }
+inline void store4(float* p, float4 v) { _mm_store_ps(p, v); }
+inline float4 splat4(float s) { return _mm_set1_ps(s); }
+
+template <int i>
+inline float4 splatLane4(float4 v)
+{
+    return _mm_shuffle_ps(v, v, _MM_SHUFFLE(i, i, i, i));
+}
+
+inline float4 add4(float4 a, float4 b) { return _mm_add_ps(a, b); }
+inline float4 sub4(float4 a, float4 b) { return _mm_sub_ps(a, b); }
+inline float4 mul4(float4 a, float4 b) { return _mm_mul_ps(a, b); }
+
+// a * b + c
+inline float4 madd4(float4 a, float4 b, float4 c)
+{
+    #ifdef __FMA__
+    return _mm_fmadd_ps(a, b, c);
+    #else
+    return _mm_add_ps(_mm_mul_ps(a, b), c);
+    #endif
+}
+
+inline float dot4(float4 a, float4 b)
+{
+    const float4 m = _mm_mul_ps(a, b);
+    float4 shuf = _mm_shuffle_ps(m, m, _MM_SHUFFLE(2, 3, 0, 1));
+    float4 sums = _mm_add_ps(m, shuf);
+    shuf = _mm_movehl_ps(shuf, sums);
+    sums = _mm_add_ss(sums, shuf);
+    return _mm_cvtss_f32(sums);
+}
+
+inline void transpose4(float4& r0, float4& r1, float4& r2, float4& r3)
+{
+    const float4 t0 = _mm_unpacklo_ps(r0, r1);
+    const float4 t1 = _mm_unpacklo_ps(r2, r3);
+    const float4 t2 = _mm_unpackhi_ps(r0, r1);
+    const float4 t3 = _mm_unpackhi_ps(r2, r3);
+    r0 = _mm_movelh_ps(t0, t1);
+    r1 = _mm_movehl_ps(t1, t0);
+    r2 = _mm_movelh_ps(t2, t3);
+    r3 = _mm_movehl_ps(t3, t2);
+}
+
+    #ifdef PYROC_MATH_SIMD_AVX2
+typedef __m256 float8;
+
+inline float8 loadu8(const float* p) { return _mm256_loadu_ps(p); }
+inline void storeu8(float* p, float8 v) { _mm256_storeu_ps(p, v); }
+inline float8 splat8(float s) { return _mm256_set1_ps(s); }
+
+// a * b + c
+inline float8 madd8(float8 a, float8 b, float8 c) { return _mm256_fmadd_ps(a, b, c); }
+
+// Deinterleaves 8 packed xyz triples (24 floats) into x, y and z registers, lanes in order
+inline void loadXyz8(const float* p, float8& x, float8& y, float8& z)
+{
+    float8 m03 = _mm256_castps128_ps256(_mm_loadu_ps(p + 0));
+    float8 m14 = _mm256_castps128_ps256(_mm_loadu_ps(p + 4));
+    float8 m25 = _mm256_castps128_ps256(_mm_loadu_ps(p + 8));
+    m03 = _mm256_insertf128_ps(m03, _mm_loadu_ps(p + 12), 1);
+    m14 = _mm256_insertf128_ps(m14, _mm_loadu_ps(p + 16), 1);
+    m25 = _mm256_insertf128_ps(m25, _mm_loadu_ps(p + 20), 1);
+
+    const float8 xy = _mm256_shuffle_ps(m14, m25, _MM_SHUFFLE(2, 1, 3, 2));
+    const float8 yz = _mm256_shuffle_ps(m03, m14, _MM_SHUFFLE(1, 0, 2, 1));
+    x = _mm256_shuffle_ps(m03, xy, _MM_SHUFFLE(2, 0, 3, 0));
+    y = _mm256_shuffle_ps(yz, xy, _MM_SHUFFLE(3, 1, 2, 0));
+    z = _mm256_shuffle_ps(yz, m25, _MM_SHUFFLE(3, 0, 3, 1));
+}
+
+// Inverse of loadXyz8
+inline void storeXyz8(float* p, float8 x, float8 y, float8 z)
+{
+    const float8 rxy = _mm256_shuffle_ps(x, y, _MM_SHUFFLE(2, 0, 2, 0));
+    const float8 ryz = _mm256_shuffle_ps(y, z, _MM_SHUFFLE(3, 1, 3, 1));
+    const float8 rzx = _mm256_shuffle_ps(z, x, _MM_SHUFFLE(3, 1, 2, 0));
+
+    const float8 r03 = _mm256_shuffle_ps(rxy, rzx, _MM_SHUFFLE(2, 0, 2, 0));
+    const float8 r14 = _mm256_shuffle_ps(ryz, rxy, _MM_SHUFFLE(3, 1, 2, 0));
+    const float8 r25 = _mm256_shuffle_ps(rzx, ryz, _MM_SHUFFLE(3, 1, 3, 1));
+
+    _mm_storeu_ps(p + 0, _mm256_castps256_ps128(r03));
+    _mm_storeu_ps(p + 4, _mm256_castps256_ps128(r14));
+    _mm_storeu_ps(p + 8, _mm256_castps256_ps128(r25));
+    _mm_storeu_ps(p + 12, _mm256_extractf128_ps(r03, 1));
+    _mm_storeu_ps(p + 16, _mm256_extractf128_ps(r14, 1));
+    _mm_storeu_ps(p + 20, _mm256_extractf128_ps(r25, 1));
+}
+    #endif
+#elif defined(PYROC_MATH_SIMD_NEON)
+typedef float32x4_t float4;
+
+inline float4 load4(const float* p) { return vld1q_f32(p); }
+inline void store4(float* p, float4 v) { vst1q_f32(p, v); }
+inline float4 splat4(float s) { return vdupq_n_f32(s); }
+
+template <int i>
+inline float4 splatLane4(float4 v)
+{
+    return vdupq_laneq_f32(v, i);
+}
+
+inline float4 add4(float4 a, float4 b) { return vaddq_f32(a, b); }
+inline float4 sub4(float4 a, float4 b) { return vsubq_f32(a, b); }
+inline float4 mul4(float4 a, float4 b) { return vmulq_f32(a, b); }
+
+// a * b + c
+inline float4 madd4(float4 a, float4 b, float4 c) { return vfmaq_f32(c, a, b); }
+
+inline float dot4(float4 a, float4 b) { return vaddvq_f32(vmulq_f32(a, b)); }
+
+inline void transpose4(float4& r0, float4& r1, float4& r2, float4& r3)
+{
+    const float32x4x2_t t01 = vtrnq_f32(r0, r1);
+    const float32x4x2_t t23 = vtrnq_f32(r2, r3);
+    r0 = vcombine_f32(vget_low_f32(t01.val[0]), vget_low_f32(t23.val[0]));
+    r1 = vcombine_f32(vget_low_f32(t01.val[1]), vget_low_f32(t23.val[1]));
+    r2 = vcombine_f32(vget_high_f32(t01.val[0]), vget_high_f32(t23.val[0]));
+    r3 = vcombine_f32(vget_high_f32(t01.val[1]), vget_high_f32(t23.val[1]));
+}
+#endif
+}  // namespace pyroc::math::detail
+
+#endif
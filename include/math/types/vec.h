@@ -39,6 +39,19 @@ constexpr vec<L, T> operator-(const vec<L, T>& lhs, const vec<L, T>& rhs)
     return result;
 }
 
+template <size_t L, typename T>
+constexpr bool operator==(const vec<L, T>& lhs, const vec<L, T>& rhs)
+{
+    for (size_t i = 0; i < L; ++i)
+    {
+        if (lhs[i] != rhs[i])
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
 template <size_t L, typename T>
 constexpr T dot(const vec<L, T>& lhs, const vec<L, T>& rhs)
 {
@@ -1,9 +1,68 @@
 #pragma once
 
+#include "simd.h"
+#include "vec.h"
 #include "vec4.h"
 
+#include <type_traits>
+
 namespace pyroc::math
 {
 typedef vec<4, float> vec4;
 typedef vec<4, float> fvec4;
+
+#ifdef PYROC_MATH_SIMD
+/*
+ * 4-wide overloads of the generic vec operators. Constant evaluation falls back to the generic
+ * templates so vec4 math stays usable in constexpr contexts.
+ */
+constexpr vec4 operator*(float lhs, const vec4& rhs)
+{
+    if (std::is_constant_evaluated())
+    {
+        return operator*<4, float>(lhs, rhs);
+    }
+
+    vec4 result;
+    detail::store4(result.data.data,
+                   detail::mul4(detail::splat4(lhs), detail::load4(rhs.data.data)));
+    return result;
+}
+
+constexpr vec4 operator+(const vec4& lhs, const vec4& rhs)
+{
+    if (std::is_constant_evaluated())
+    {
+        return operator+<4, float>(lhs, rhs);
+    }
+
+    vec4 result;
+    detail::store4(result.data.data,
+                   detail::add4(detail::load4(lhs.data.data), detail::load4(rhs.data.data)));
+    return result;
+}
+
+constexpr vec4 operator-(const vec4& lhs, const vec4& rhs)
+{
+    if (std::is_constant_evaluated())
+    {
+        return operator-<4, float>(lhs, rhs);
+    }
+
+    vec4 result;
+    detail::store4(result.data.data,
+                   detail::sub4(detail::load4(lhs.data.data), detail::load4(rhs.data.data)));
+    return result;
+}
+
+constexpr float dot(const vec4& lhs, const vec4& rhs)
+{
+    if (std::is_constant_evaluated())
+    {
+        return dot<4, float>(lhs, rhs);
+    }
+
+    return detail::dot4(detail::load4(lhs.data.data), detail::load4(rhs.data.data));
+}
+#endif
 }  // namespace pyroc::math
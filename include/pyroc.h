@@ -3,11 +3,21 @@
 #include "backend/vulkan/api.h"
 #include "backend/vulkan/buffer.h"
 #include "backend/vulkan/context.h"
+#include "backend/vulkan/memory.h"
+#include "backend/vulkan/offscreen.h"
+#include "backend/vulkan/pipeline.h"
+#include "backend/vulkan/pipeline_cache.h"
 #include "backend/vulkan/shader.h"
+#include "backend/vulkan/shader_reflection.h"
+#include "backend/vulkan/shader_reload.h"
 #include "backend/vulkan/surface.h"
 
 #include "math/math.h"
 
 #include "core/camera.h"
+#include "core/frustum.h"
+
+#include "util/allocation_tracking.h"
+#include "util/allocators.h"
 
 #include "window/window.h"
@@ -0,0 +1,112 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+/*
+ * Instrumentation for the global operator new/delete, compiled in with PYROC_TRACK_ALLOCATIONS
+ * (the pyroc_TRACK_ALLOCATIONS CMake option). When it is off the scopes are empty types and every
+ * query returns zeroed stats, so call sites can stay in place in release builds.
+ *
+ * Scope tags are compared by pointer first, pass string literals.
+ */
+
+namespace pyroc::util
+{
+struct AllocationStats
+{
+    uint64_t allocations = 0;
+    uint64_t frees = 0;
+    uint64_t bytesAllocated = 0;
+    uint64_t bytesFreed = 0;
+
+    // Live bytes and their high water mark, only meaningful for totalAllocationStats()
+    uint64_t currentBytes = 0;
+    uint64_t peakBytes = 0;
+};
+
+struct AllocationCallSite
+{
+    const void* address = nullptr;
+    uint64_t allocations = 0;
+    uint64_t bytes = 0;
+};
+
+#ifdef PYROC_TRACK_ALLOCATIONS
+
+// Starts a new frame, the stats gathered since the previous call become lastFrameAllocationStats
+void beginAllocationFrame();
+
+AllocationStats totalAllocationStats();
+AllocationStats currentFrameAllocationStats();
+AllocationStats lastFrameAllocationStats();
+
+// Stats of every allocation made while tag was the innermost ScopedAllocationTag on its thread
+AllocationStats taggedAllocationStats(const char* tag);
+
+// Allocations made inside a NoAllocationScope so far
+uint64_t allocationViolations();
+
+/*
+ * Fills out with the call sites (return addresses into the callers of operator new) with the most
+ * allocations, busiest first, and returns how many entries were written
+ */
+size_t hotAllocationCallSites(std::span<AllocationCallSite> out);
+
+void logAllocationStats();
+
+class ScopedAllocationTag
+{
+  public:
+    explicit ScopedAllocationTag(const char* tag);
+    ~ScopedAllocationTag();
+
+    ScopedAllocationTag(const ScopedAllocationTag&) = delete;
+    ScopedAllocationTag& operator=(const ScopedAllocationTag&) = delete;
+
+  private:
+    const char* mPrevious;
+};
+
+/*
+ * Any allocation on this thread while the scope is alive is logged with its call site, counted in
+ * allocationViolations() and asserts in debug builds
+ */
+class NoAllocationScope
+{
+  public:
+    NoAllocationScope();
+    ~NoAllocationScope();
+
+    NoAllocationScope(const NoAllocationScope&) = delete;
+    NoAllocationScope& operator=(const NoAllocationScope&) = delete;
+};
+
+#else
+
+inline void beginAllocationFrame() {}
+
+inline AllocationStats totalAllocationStats() { return {}; }
+inline AllocationStats currentFrameAllocationStats() { return {}; }
+inline AllocationStats lastFrameAllocationStats() { return {}; }
+inline AllocationStats taggedAllocationStats(const char*) { return {}; }
+inline uint64_t allocationViolations() { return 0; }
+inline size_t hotAllocationCallSites(std::span<AllocationCallSite>) { return 0; }
+inline void logAllocationStats() {}
+
+class ScopedAllocationTag
+{
+  public:
+    explicit ScopedAllocationTag(const char*) {}
+};
+
+class NoAllocationScope
+{
+  public:
+    NoAllocationScope() {}
+    ~NoAllocationScope() {}
+};
+
+#endif
+}  // namespace pyroc::util
@@ -0,0 +1,189 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <new>
+#include <utility>
+
+namespace pyroc::util
+{
+/*
+ * Allocators usable directly or as std::pmr memory resources. None of them are thread safe, give
+ * each thread its own instance or lock externally. Backing memory comes from malloc rather than
+ * the global operator new so it is not counted twice by allocation tracking.
+ *
+ * Allocation never fails outright: when a resource runs out of its own memory it falls back to
+ * malloc and counts the bytes in overflowBytes() so the sizes can be tuned. The count is a
+ * running total of every overflowing request, freeing them does not lower it.
+ */
+
+/*
+ * Bump allocator over a fixed block. deallocate is a no-op and reset() releases everything at
+ * once, intended to be reset at frame boundaries (one arena per frame in flight).
+ */
+class LinearArena : public std::pmr::memory_resource
+{
+  public:
+    bool init(size_t capacity);
+    void destroy();
+
+    // Releases every allocation, including overflow allocations
+    void reset();
+
+    size_t capacity() const { return mCapacity; }
+    size_t used() const { return mOffset; }
+    size_t peak() const { return mPeak; }
+
+    // Total since the last reset()
+    size_t overflowBytes() const { return mOverflowBytes; }
+
+  private:
+    struct Overflow
+    {
+        Overflow* next;
+    };
+
+    void* do_allocate(size_t bytes, size_t alignment) override;
+    void do_deallocate(void* p, size_t bytes, size_t alignment) override;
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override;
+
+    std::byte* mBuffer = nullptr;
+    size_t mCapacity = 0;
+    size_t mOffset = 0;
+    size_t mPeak = 0;
+
+    Overflow* mOverflow = nullptr;
+    size_t mOverflowBytes = 0;
+};
+
+/*
+ * Fixed-size block pool. Requests up to blockSize bytes (and blockAlignment) are served from a
+ * free list that grows by blocksPerChunk blocks at a time; larger requests go to malloc.
+ */
+class PoolResource : public std::pmr::memory_resource
+{
+  public:
+    bool init(size_t blockSize, size_t blockAlignment, size_t blocksPerChunk);
+    void destroy();
+
+    size_t blockSize() const { return mBlockSize; }
+    size_t blocksInUse() const { return mBlocksInUse; }
+    size_t blocksReserved() const { return mBlocksReserved; }
+
+    // Total since init()
+    size_t overflowBytes() const { return mOverflowBytes; }
+
+  private:
+    struct FreeBlock
+    {
+        FreeBlock* next;
+    };
+
+    struct Chunk
+    {
+        Chunk* next;
+    };
+
+    bool grow();
+
+    void* do_allocate(size_t bytes, size_t alignment) override;
+    void do_deallocate(void* p, size_t bytes, size_t alignment) override;
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override;
+
+    size_t mBlockSize = 0;
+    size_t mBlockAlignment = 0;
+    size_t mBlocksPerChunk = 0;
+    size_t mChunkHeaderSize = 0;
+
+    FreeBlock* mFreeList = nullptr;
+    Chunk* mChunks = nullptr;
+
+    size_t mBlocksInUse = 0;
+    size_t mBlocksReserved = 0;
+    size_t mOverflowBytes = 0;
+};
+
+/*
+ * Typed convenience wrapper over PoolResource
+ */
+template <typename T>
+class ObjectPool
+{
+  public:
+    bool init(size_t objectsPerChunk)
+    {
+        return mResource.init(sizeof(T), alignof(T), objectsPerChunk);
+    }
+    void destroy() { mResource.destroy(); }
+
+    template <typename... Args>
+    T* create(Args&&... args)
+    {
+        void* p = mResource.allocate(sizeof(T), alignof(T));
+        return new (p) T(std::forward<Args>(args)...);
+    }
+
+    void destroy(T* object)
+    {
+        object->~T();
+        mResource.deallocate(object, sizeof(T), alignof(T));
+    }
+
+    PoolResource& resource() { return mResource; }
+
+  private:
+    PoolResource mResource;
+};
+
+/*
+ * General purpose two-level segregated fit heap. O(1) allocate and free with immediate
+ * coalescing keeps fragmentation low for long running mixed-size workloads. The heap grows by
+ * adding further pools of at least poolSize bytes when it runs out of space.
+ */
+class TlsfHeap : public std::pmr::memory_resource
+{
+  public:
+    bool init(size_t poolSize);
+    void destroy();
+
+    size_t capacity() const { return mCapacity; }
+    size_t used() const { return mUsed; }
+    size_t peak() const { return mPeak; }
+
+  private:
+    static constexpr uint32_t kSlIndexCountLog2 = 4;
+    static constexpr uint32_t kSlIndexCount = 1u << kSlIndexCountLog2;
+    static constexpr uint32_t kAlignSizeLog2 = 4;
+    static constexpr uint32_t kFlIndexShift = kSlIndexCountLog2 + kAlignSizeLog2;
+    static constexpr uint32_t kFlIndexMax = 40;
+    static constexpr uint32_t kFlIndexCount = kFlIndexMax - kFlIndexShift + 1;
+
+    struct Block;
+    struct Pool;
+
+    bool addPool(size_t size);
+
+    void* allocateBlock(size_t bytes);
+    void freeBlock(void* p);
+
+    void insertFreeBlock(Block* block);
+    void removeFreeBlock(Block* block);
+    Block* findFreeBlock(size_t size);
+
+    void* do_allocate(size_t bytes, size_t alignment) override;
+    void do_deallocate(void* p, size_t bytes, size_t alignment) override;
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override;
+
+    size_t mPoolSize = 0;
+    Pool* mPools = nullptr;
+
+    uint64_t mFlBitmap = 0;
+    uint32_t mSlBitmap[kFlIndexCount] = {};
+    Block* mFreeBlocks[kFlIndexCount][kSlIndexCount] = {};
+
+    size_t mCapacity = 0;
+    size_t mUsed = 0;
+    size_t mPeak = 0;
+};
+}  // namespace pyroc::util
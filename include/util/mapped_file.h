@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstddef>
+
+namespace pyroc::util
+{
+/*
+ * Read only view of a whole file mapped into memory. The data is page aligned, and pages are only
+ * read from disk once touched.
+ */
+class MappedFile
+{
+  public:
+    MappedFile() = default;
+    ~MappedFile() { close(); }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    // Returns false when the file cannot be opened or mapped, empty files included
+    bool open(const char* path);
+    void close();
+
+    const void* data() const { return mData; }
+    size_t size() const { return mSize; }
+
+  private:
+    const void* mData = nullptr;
+    size_t mSize = 0;
+
+#ifdef _WIN32
+    void* mFile = nullptr;
+    void* mMapping = nullptr;
+#endif
+};
+}  // namespace pyroc::util
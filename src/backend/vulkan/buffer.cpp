@@ -2,20 +2,54 @@
 
 #include "backend/vulkan/context.h"
 
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
 namespace pyroc::backend::vulkan
 {
+namespace
+{
+// Copies and barriers are gathered on the stack and recorded in chunks of this many
+constexpr uint32_t kRecordChunkSize = 64;
+
+bool isAdjacent(const BufferCopyRegion& first, const BufferCopyRegion& second)
+{
+    return first.src == second.src && first.dst == second.dst
+           && first.srcOffset + first.size == second.srcOffset
+           && first.dstOffset + first.size == second.dstOffset;
+}
+
+// Tries each set of memory properties in turn, the first one that can be allocated wins
 vk::Result createBuffer(Context* ctx, vk::DeviceSize size, vk::BufferUsageFlags usage,
-                        vk::MemoryPropertyFlags properties, Buffer& buffer)
+                        std::span<const vk::MemoryPropertyFlags> candidates,
+                        std::span<const uint32_t> queueFamilies, Buffer& buffer)
 {
+    // Graphics, compute, transfer and present at most
+    uint32_t families[4] = {};
+    uint32_t familyCount = 0;
+    for (const uint32_t family : queueFamilies)
+    {
+        if (familyCount < std::size(families)
+            && std::find(families, families + familyCount, family) == families + familyCount)
+        {
+            families[familyCount++] = family;
+        }
+    }
+
+    const vk::SharingMode sharingMode
+        = familyCount > 1 ? vk::SharingMode::eConcurrent : vk::SharingMode::eExclusive;
+
     vk::Device device = ctx->device();
     vk::BufferCreateInfo bufferInfo = {
         .size = size,
         .usage = usage,
-        .sharingMode = vk::SharingMode::eExclusive,
+        .sharingMode = sharingMode,
+        .queueFamilyIndexCount = familyCount > 1 ? familyCount : 0,
+        .pQueueFamilyIndices = familyCount > 1 ? families : nullptr,
     };
 
     vk::Buffer bufferHandle;
-    vk::DeviceMemory memoryHandle;
     {
         const auto [res, handle] = device.createBuffer(bufferInfo);
         if (res != vk::Result::eSuccess)
@@ -26,68 +60,120 @@ vk::Result createBuffer(Context* ctx, vk::DeviceSize size, vk::BufferUsageFlags
         bufferHandle = handle;
     }
 
-    vk::MemoryRequirements memRequirements = device.getBufferMemoryRequirements(bufferHandle);
-
-    vk::PhysicalDeviceMemoryProperties memProperties = ctx->physicalDevice().getMemoryProperties();
+    const vk::MemoryRequirements memRequirements
+        = device.getBufferMemoryRequirements(bufferHandle);
 
-    for (uint32_t i = 0; i < memProperties.memoryTypeCount; i++)
+    Allocation allocation;
     {
-        if ((memRequirements.memoryTypeBits & (1 << i))
-            && (memProperties.memoryTypes[i].propertyFlags & properties) == properties)
+        vk::Result res = vk::Result::eErrorUnknown;
+        for (const vk::MemoryPropertyFlags properties : candidates)
         {
-            vk::MemoryAllocateInfo allocInfo = {
-                .allocationSize = memRequirements.size,
-                .memoryTypeIndex = i,
-            };
-
+            res = ctx->allocator().allocate(memRequirements, properties, nullptr, allocation);
+            if (res == vk::Result::eSuccess)
             {
-                const auto [res, handle] = device.allocateMemory(allocInfo);
-                if (res != vk::Result::eSuccess)
-                {
-                    device.destroyBuffer(bufferHandle);
-                    return res;
-                }
-                memoryHandle = handle;
+                break;
             }
+        }
 
-            {
-                const auto res = device.bindBufferMemory(bufferHandle, memoryHandle, 0);
-
-                if (res != vk::Result::eSuccess)
-                {
-                    device.freeMemory(memoryHandle);
-                    device.destroyBuffer(bufferHandle);
+        if (res != vk::Result::eSuccess)
+        {
+            device.destroyBuffer(bufferHandle);
+            return res;
+        }
+    }
 
-                    return res;
-                }
-            }
+    {
+        const auto res
+            = device.bindBufferMemory(bufferHandle, allocation.memory, allocation.offset);
 
-            buffer.size = size;
-            buffer.usage = usage;
-            buffer.properties = properties;
-            buffer.memory = memoryHandle;
-            buffer.buffer = bufferHandle;
+        if (res != vk::Result::eSuccess)
+        {
+            ctx->allocator().free(allocation);
+            device.destroyBuffer(bufferHandle);
 
-            return vk::Result::eSuccess;
+            return res;
         }
     }
 
-    return vk::Result::eErrorUnknown;
+    buffer.size = size;
+    buffer.usage = usage;
+    buffer.sharingMode = sharingMode;
+    buffer.properties = ctx->memoryProperties().memoryTypes[allocation.memoryType].propertyFlags;
+    buffer.pMapped = allocation.pMapped;
+    buffer.allocation = allocation;
+    buffer.buffer = bufferHandle;
+
+    return vk::Result::eSuccess;
+}
+}  // namespace
+
+vk::Result createBuffer(Context* ctx, vk::DeviceSize size, vk::BufferUsageFlags usage,
+                        vk::MemoryPropertyFlags properties, Buffer& buffer)
+{
+    return createBuffer(ctx, size, usage, std::span(&properties, 1), {}, buffer);
+}
+
+vk::Result createBuffer(Context* ctx, vk::DeviceSize size, vk::BufferUsageFlags usage,
+                        vk::MemoryPropertyFlags properties,
+                        std::span<const uint32_t> queueFamilies, Buffer& buffer)
+{
+    return createBuffer(ctx, size, usage, std::span(&properties, 1), queueFamilies, buffer);
+}
+
+vk::Result createMappedBuffer(Context* ctx, vk::DeviceSize size, vk::BufferUsageFlags usage,
+                              Buffer& buffer)
+{
+    const vk::MemoryPropertyFlags candidates[] = {
+        vk::MemoryPropertyFlagBits::eDeviceLocal | vk::MemoryPropertyFlagBits::eHostVisible
+            | vk::MemoryPropertyFlagBits::eHostCoherent,
+        vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCached,
+        vk::MemoryPropertyFlagBits::eHostVisible,
+    };
+
+    return createBuffer(ctx, size, usage, candidates, {}, buffer);
 }
 
 void destroyBuffer(Context* ctx, Buffer& buffer)
 {
-    ctx->device().freeMemory(buffer.memory);
     ctx->device().destroyBuffer(buffer.buffer);
+    ctx->allocator().free(buffer.allocation);
 
     return;
 }
 
+vk::Result flushRange(Context* ctx, const Buffer& buffer, vk::DeviceSize offset,
+                      vk::DeviceSize size)
+{
+    if (size == VK_WHOLE_SIZE)
+    {
+        size = buffer.size - offset;
+    }
+
+    return ctx->allocator().flush(buffer.allocation, offset, size);
+}
+
+vk::Result invalidateRange(Context* ctx, const Buffer& buffer, vk::DeviceSize offset,
+                           vk::DeviceSize size)
+{
+    if (size == VK_WHOLE_SIZE)
+    {
+        size = buffer.size - offset;
+    }
+
+    return ctx->allocator().invalidate(buffer.allocation, offset, size);
+}
+
 vk::Result copyBufferBlocking(Context* ctx, vk::CommandBuffer cmdBuf, vk::DeviceSize srcOffset,
-                              Buffer& src, vk::DeviceSize dstOffset, Buffer& dst)
+                              Buffer& src, vk::DeviceSize dstOffset, Buffer& dst,
+                              vk::DeviceSize size)
 {
     vk::Result res;
 
+    if (size == VK_WHOLE_SIZE)
+    {
+        size = std::min(src.size - srcOffset, dst.size - dstOffset);
+    }
+
     res = cmdBuf.reset();
 
     if (res != vk::Result::eSuccess)
@@ -112,7 +198,7 @@ vk::Result copyBufferBlocking(Context* ctx, vk::CommandBuffer cmdBuf, vk::Device
         vk::BufferCopy copyRegion = {
             .srcOffset = srcOffset,
             .dstOffset = dstOffset,
-            .size = src.size,
+            .size = size,
         };
 
         cmdBuf.copyBuffer(src.buffer, dst.buffer, copyRegion);
@@ -127,30 +213,39 @@ vk::Result copyBufferBlocking(Context* ctx, vk::CommandBuffer cmdBuf, vk::Device
         }
     }
 
+    // Waits on a fence of its own rather than for the whole queue to drain
+    vk::Fence fence;
     {
-        const vk::SubmitInfo submitInfo = {
-            .commandBufferCount = 1,
-            .pCommandBuffers = &cmdBuf,
-        };
+        const vk::FenceCreateInfo fenceInfo = {};
 
-        res = ctx->graphicsQueue().submit(submitInfo);
+        const auto [fenceRes, handle] = ctx->device().createFence(fenceInfo);
 
-        if (res != vk::Result::eSuccess)
+        if (fenceRes != vk::Result::eSuccess)
         {
-            return res;
+            return fenceRes;
         }
+
+        fence = handle;
     }
 
     {
-        res = ctx->graphicsQueue().waitIdle();
+        const vk::SubmitInfo submitInfo = {
+            .commandBufferCount = 1,
+            .pCommandBuffers = &cmdBuf,
+        };
 
-        if (res != vk::Result::eSuccess)
+        res = ctx->graphicsQueue().submit(submitInfo, fence);
+
+        if (res == vk::Result::eSuccess)
         {
-            return res;
+            res = ctx->device().waitForFences(fence, vk::True,
+                                              std::numeric_limits<uint64_t>::max());
         }
     }
 
-    return vk::Result::eSuccess;
+    ctx->device().destroyFence(fence);
+
+    return res;
 }
 
 vk::Result copyBufferBlocking(Context* ctx, vk::CommandBuffer cmdBuf, vk::DeviceSize srcSize,
@@ -158,6 +253,13 @@ vk::Result copyBufferBlocking(Context* ctx, vk::CommandBuffer cmdBuf, vk::Device
 {
     vk::Result res;
 
+    // Go through the context's staging ring, only uploads larger than it get a temporary buffer
+    res = ctx->stagingRing().copyBlocking(cmdBuf, pSrc, srcSize, dst, dstOffset);
+    if (res != vk::Result::eErrorOutOfDeviceMemory)
+    {
+        return res;
+    }
+
     Buffer srcBuffer;
     res = createBuffer(
         ctx, srcSize, vk::BufferUsageFlagBits::eTransferSrc,
@@ -169,26 +271,181 @@ vk::Result copyBufferBlocking(Context* ctx, vk::CommandBuffer cmdBuf, vk::Device
         return res;
     }
 
+    // Host visible memory stays mapped for the lifetime of its block
+    std::memcpy(srcBuffer.pMapped, pSrc, srcSize);
+
+    res = copyBufferBlocking(ctx, cmdBuf, 0, srcBuffer, dstOffset, dst, srcSize);
+
+    destroyBuffer(ctx, srcBuffer);
+
+    return res;
+}
+
+void recordBufferCopies(vk::CommandBuffer cmdBuf, std::span<BufferCopyRegion> regions,
+                        vk::PipelineStageFlags dstStages, vk::AccessFlags dstAccess)
+{
+    // Group by destination then source, in source order so adjacent ranges sit next to each other
+    std::sort(regions.begin(), regions.end(),
+              [](const BufferCopyRegion& a, const BufferCopyRegion& b)
+              {
+                  if (a.dst != b.dst)
+                  {
+                      return a.dst < b.dst;
+                  }
+                  if (a.src != b.src)
+                  {
+                      return a.src < b.src;
+                  }
+                  return a.srcOffset < b.srcOffset;
+              });
+
+    size_t count = 0;
+    for (size_t i = 0; i < regions.size(); ++i)
+    {
+        if (regions[i].size == 0)
+        {
+            continue;
+        }
+
+        if (count > 0 && isAdjacent(regions[count - 1], regions[i]))
+        {
+            regions[count - 1].size += regions[i].size;
+        }
+        else
+        {
+            regions[count++] = regions[i];
+        }
+    }
+
+    if (count == 0)
+    {
+        return;
+    }
+
+    {
+        // Earlier writes and reads of the destinations must finish before they are overwritten
+        const vk::MemoryBarrier hazardBarrier = {
+            .srcAccessMask = vk::AccessFlagBits::eTransferWrite,
+            .dstAccessMask = vk::AccessFlagBits::eTransferWrite,
+        };
+
+        cmdBuf.pipelineBarrier(dstStages | vk::PipelineStageFlagBits::eTransfer,
+                               vk::PipelineStageFlagBits::eTransfer, {}, 1, &hazardBarrier, 0,
+                               nullptr, 0, nullptr);
+    }
+
+    vk::BufferCopy copies[kRecordChunkSize];
+    vk::BufferMemoryBarrier barriers[kRecordChunkSize];
+    uint32_t barrierCount = 0;
+
+    const auto recordBarriers = [&]()
+    {
+        cmdBuf.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, dstStages, {}, 0, nullptr,
+                               barrierCount, barriers, 0, nullptr);
+        barrierCount = 0;
+    };
+
+    for (size_t i = 0; i < count;)
+    {
+        const vk::Buffer dst = regions[i].dst;
+        vk::DeviceSize rangeBegin = std::numeric_limits<vk::DeviceSize>::max();
+        vk::DeviceSize rangeEnd = 0;
+
+        while (i < count && regions[i].dst == dst)
+        {
+            const vk::Buffer src = regions[i].src;
+            uint32_t copyCount = 0;
+
+            while (i < count && regions[i].dst == dst && regions[i].src == src)
+            {
+                const BufferCopyRegion& region = regions[i++];
+
+                copies[copyCount++] = {
+                    .srcOffset = region.srcOffset,
+                    .dstOffset = region.dstOffset,
+                    .size = region.size,
+                };
+
+                rangeBegin = std::min(rangeBegin, region.dstOffset);
+                rangeEnd = std::max(rangeEnd, region.dstOffset + region.size);
+
+                if (copyCount == kRecordChunkSize)
+                {
+                    cmdBuf.copyBuffer(src, dst, copyCount, copies);
+                    copyCount = 0;
+                }
+            }
+
+            if (copyCount > 0)
+            {
+                cmdBuf.copyBuffer(src, dst, copyCount, copies);
+            }
+        }
+
+        // One barrier per destination, covering everything written to it
+        barriers[barrierCount++] = {
+            .srcAccessMask = vk::AccessFlagBits::eTransferWrite,
+            .dstAccessMask = dstAccess,
+            .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .buffer = dst,
+            .offset = rangeBegin,
+            .size = rangeEnd - rangeBegin,
+        };
+
+        if (barrierCount == kRecordChunkSize)
+        {
+            recordBarriers();
+        }
+    }
+
+    if (barrierCount > 0)
+    {
+        recordBarriers();
+    }
+}
+
+vk::Result copyBuffers(Context* ctx, vk::CommandBuffer cmdBuf,
+                       std::span<BufferCopyRegion> regions, vk::PipelineStageFlags dstStages,
+                       vk::AccessFlags dstAccess, vk::Fence fence)
+{
+    vk::Result res;
+
+    res = cmdBuf.reset();
+
+    if (res != vk::Result::eSuccess)
+    {
+        return res;
+    }
+
     {
-        void* pData;
-        res = ctx->device().mapMemory(srcBuffer.memory, 0, srcSize, {}, &pData);
+        const vk::CommandBufferBeginInfo beginInfo = {
+            .flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit,
+        };
+
+        res = cmdBuf.begin(beginInfo);
 
         if (res != vk::Result::eSuccess)
         {
-            destroyBuffer(ctx, srcBuffer);
             return res;
         }
+    }
 
-        std::memcpy(pData, pSrc, srcSize);
+    recordBufferCopies(cmdBuf, regions, dstStages, dstAccess);
 
-        ctx->device().unmapMemory(srcBuffer.memory);
-    }
+    res = cmdBuf.end();
 
-    res = copyBufferBlocking(ctx, cmdBuf, 0, srcBuffer, dstOffset, dst);
+    if (res != vk::Result::eSuccess)
+    {
+        return res;
+    }
 
-    destroyBuffer(ctx, srcBuffer);
+    const vk::SubmitInfo submitInfo = {
+        .commandBufferCount = 1,
+        .pCommandBuffers = &cmdBuf,
+    };
 
-    return res;
+    return ctx->graphicsQueue().submit(submitInfo, fence);
 }
 
 }  // namespace pyroc::backend::vulkan
\ No newline at end of file
@@ -25,13 +25,74 @@ debugCallback(vk::DebugUtilsMessageSeverityFlagBitsEXT /*messageSeverity*/,
     return VK_FALSE;
 }
 
-vk::Bool32 getPresentationSupport(vk::PhysicalDevice device, uint32_t queueFamilyIndex)
+vk::Bool32 getPresentationSupport(vk::Instance instance, vk::PhysicalDevice device,
+                                  uint32_t queueFamilyIndex)
 {
-#ifdef _WIN32
-    return device.getWin32PresentationSupportKHR(queueFamilyIndex);
-#else
-    #error "Unsupported operating system"
-#endif
+    // Dispatches to the Win32, Xlib/XCB or Wayland query for the platform GLFW was initialized on
+    const int supported = glfwGetPhysicalDevicePresentationSupport(
+        static_cast<VkInstance>(instance), static_cast<VkPhysicalDevice>(device), queueFamilyIndex);
+
+    return supported == GLFW_TRUE ? vk::True : vk::False;
+}
+
+int toGlfwPlatform(PresentPlatform platform)
+{
+    switch (platform)
+    {
+        case PresentPlatform::eWin32:
+            return GLFW_PLATFORM_WIN32;
+        case PresentPlatform::eX11:
+            return GLFW_PLATFORM_X11;
+        case PresentPlatform::eWayland:
+            return GLFW_PLATFORM_WAYLAND;
+        default:
+            return GLFW_ANY_PLATFORM;
+    }
+}
+
+PresentPlatform fromGlfwPlatform(int platform)
+{
+    switch (platform)
+    {
+        case GLFW_PLATFORM_WIN32:
+            return PresentPlatform::eWin32;
+        case GLFW_PLATFORM_X11:
+            return PresentPlatform::eX11;
+        case GLFW_PLATFORM_WAYLAND:
+            return PresentPlatform::eWayland;
+        default:
+            return PresentPlatform::eDefault;
+    }
+}
+
+const char* platformName(PresentPlatform platform)
+{
+    switch (platform)
+    {
+        case PresentPlatform::eWin32:
+            return "Win32";
+        case PresentPlatform::eX11:
+            return "X11";
+        case PresentPlatform::eWayland:
+            return "Wayland";
+        default:
+            return "Default";
+    }
+}
+
+void initGlfw(PresentPlatform platform)
+{
+    const int glfwPlatform = toGlfwPlatform(platform);
+    if (glfwPlatform != GLFW_ANY_PLATFORM && glfwPlatformSupported(glfwPlatform) == GLFW_TRUE)
+    {
+        glfwInitHint(GLFW_PLATFORM, glfwPlatform);
+    }
+    else if (glfwPlatform != GLFW_ANY_PLATFORM)
+    {
+        LOG_DEBUG("Platform %s is not available, letting GLFW pick", platformName(platform));
+    }
+
+    glfwInit();
 }
 
 bool checkValidationLayerSupport()
@@ -64,13 +125,18 @@ bool checkValidationLayerSupport()
     return true;
 }
 
-std::vector<const char*> getRequiredInstanceExtensions(bool useValidation)
+std::vector<const char*> getRequiredInstanceExtensions(bool useValidation, bool headless)
 {
-    uint32_t glfwExtensionCount = 0;
-    const char** glfwExtensions;
-    glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
+    std::vector<const char*> extensions;
 
-    std::vector<const char*> extensions(glfwExtensions, glfwExtensions + glfwExtensionCount);
+    if (!headless)
+    {
+        uint32_t glfwExtensionCount = 0;
+        const char** glfwExtensions;
+        glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
+
+        extensions.assign(glfwExtensions, glfwExtensions + glfwExtensionCount);
+    }
 
     if (useValidation)
     {
@@ -81,11 +147,14 @@ std::vector<const char*> getRequiredInstanceExtensions(bool useValidation)
     return extensions;
 }
 
-std::vector<const char*> getRequiredDeviceExtensions()
+std::vector<const char*> getRequiredDeviceExtensions(bool headless)
 {
-    std::vector<const char*> extensions = {
-        VK_KHR_SWAPCHAIN_EXTENSION_NAME,
-    };
+    std::vector<const char*> extensions;
+
+    if (!headless)
+    {
+        extensions.push_back(VK_KHR_SWAPCHAIN_EXTENSION_NAME);
+    }
 
     return extensions;
 }
@@ -116,14 +185,27 @@ uint32_t findBestQueue(vk::QueueFlags desiredFlags,
     return targetIndex;
 }
 
-Context::QueueFamilyIndices findQueueFamiles(vk::PhysicalDevice device)
+Context::QueueFamilyIndices findQueueFamiles(vk::Instance instance, vk::PhysicalDevice device,
+                                             bool headless)
 {
     Context::QueueFamilyIndices indices;
     const auto queueFamilies = device.getQueueFamilyProperties();
 
     indices.graphics = findBestQueue(vk::QueueFlagBits::eGraphics, queueFamilies);
 
-    if (getPresentationSupport(device, indices.graphics))
+    // Graphics queues accept transfer work even when they do not report it
+    indices.transfer = findBestQueue(vk::QueueFlagBits::eTransfer, queueFamilies);
+    if (indices.transfer == ~0u)
+    {
+        indices.transfer = indices.graphics;
+    }
+
+    if (headless)
+    {
+        return indices;
+    }
+
+    if (getPresentationSupport(instance, device, indices.graphics))
     {
         indices.present = indices.graphics;  // Graphics and present are the same queue
         return indices;
@@ -131,7 +213,7 @@ Context::QueueFamilyIndices findQueueFamiles(vk::PhysicalDevice device)
 
     for (uint32_t i = 0; i < queueFamilies.size(); ++i)
     {
-        const vk::Bool32 presentSupport = getPresentationSupport(device, i);
+        const vk::Bool32 presentSupport = getPresentationSupport(instance, device, i);
 
         if (presentSupport)
         {
@@ -143,7 +225,7 @@ Context::QueueFamilyIndices findQueueFamiles(vk::PhysicalDevice device)
     return indices;
 }
 
-bool checkDeviceExtensionSupport(vk::PhysicalDevice device)
+bool checkDeviceExtensionSupport(vk::PhysicalDevice device, bool headless)
 {
     const auto [res, availableExtensions] = device.enumerateDeviceExtensionProperties();
 
@@ -152,7 +234,7 @@ bool checkDeviceExtensionSupport(vk::PhysicalDevice device)
         return false;
     }
 
-    const auto requiredExtensions = getRequiredDeviceExtensions();
+    const auto requiredExtensions = getRequiredDeviceExtensions(headless);
 
     // Just gonna do a n^2 search I CBA
     for (const auto& extensionName : requiredExtensions)
@@ -175,23 +257,135 @@ bool checkDeviceExtensionSupport(vk::PhysicalDevice device)
     return true;
 }
 
-bool isDeviceSuitable(vk::PhysicalDevice device)
+DeviceCapabilities queryCapabilities(vk::PhysicalDevice device)
 {
+    DeviceCapabilities capabilities;
+
     const auto properties = device.getProperties();
+    capabilities.apiVersion = properties.apiVersion;
+    capabilities.deviceType = properties.deviceType;
+
+    const auto memoryProperties = device.getMemoryProperties();
+    for (uint32_t i = 0; i < memoryProperties.memoryHeapCount; ++i)
+    {
+        const vk::MemoryHeap& heap = memoryProperties.memoryHeaps[i];
+        if (heap.flags & vk::MemoryHeapFlagBits::eDeviceLocal)
+        {
+            capabilities.deviceLocalBytes = std::max(capabilities.deviceLocalBytes, heap.size);
+        }
+    }
+
+    {
+        const auto queueFamilies = device.getQueueFamilyProperties();
+        const uint32_t transfer = findBestQueue(vk::QueueFlagBits::eTransfer, queueFamilies);
+        capabilities.dedicatedTransferQueue
+            = transfer != ~0u
+              && !(queueFamilies[transfer].queueFlags
+                   & (vk::QueueFlagBits::eGraphics | vk::QueueFlagBits::eCompute));
+    }
+
+    {
+        const auto [res, extensions] = device.enumerateDeviceExtensionProperties();
+        if (res == vk::Result::eSuccess)
+        {
+            for (const auto& extension : extensions)
+            {
+                if (!strcmp(extension.extensionName, VK_EXT_MEMORY_BUDGET_EXTENSION_NAME))
+                {
+                    capabilities.memoryBudget = true;
+                }
+            }
+        }
+    }
+
+    if (properties.apiVersion < VK_API_VERSION_1_2)
+    {
+        return capabilities;
+    }
+
+    // The 1.3 struct may only be chained on devices that report 1.3
+    vk::PhysicalDeviceVulkan13Features vulkan13Features = {};
+    vk::PhysicalDeviceVulkan12Features vulkan12Features = {
+        .pNext = properties.apiVersion >= VK_API_VERSION_1_3 ? &vulkan13Features : nullptr,
+    };
+    vk::PhysicalDeviceFeatures2 features = {
+        .pNext = &vulkan12Features,
+    };
+
+    device.getFeatures2(&features);
+
+    capabilities.timelineSemaphore = vulkan12Features.timelineSemaphore == vk::True;
+    capabilities.bufferDeviceAddress = vulkan12Features.bufferDeviceAddress == vk::True;
+    capabilities.descriptorIndexing
+        = vulkan12Features.descriptorIndexing == vk::True
+          && vulkan12Features.shaderSampledImageArrayNonUniformIndexing == vk::True
+          && vulkan12Features.descriptorBindingPartiallyBound == vk::True
+          && vulkan12Features.descriptorBindingVariableDescriptorCount == vk::True
+          && vulkan12Features.runtimeDescriptorArray == vk::True;
+
+    capabilities.synchronization2 = vulkan13Features.synchronization2 == vk::True;
+    capabilities.dynamicRendering = vulkan13Features.dynamicRendering == vk::True;
+
+    return capabilities;
+}
+
+/*
+ * Higher is better. Device type dominates, then the fast paths the device supports, then the
+ * amount of device local memory. Headless contexts accept software rasterizers, they just lose to
+ * any real GPU.
+ */
+uint64_t scoreDevice(const DeviceCapabilities& capabilities)
+{
+    uint64_t score = 0;
+
+    switch (capabilities.deviceType)
+    {
+        case vk::PhysicalDeviceType::eDiscreteGpu:
+            score += 100000;
+            break;
+        case vk::PhysicalDeviceType::eIntegratedGpu:
+            score += 50000;
+            break;
+        case vk::PhysicalDeviceType::eVirtualGpu:
+            score += 25000;
+            break;
+        default:
+            break;
+    }
 
-    if (properties.deviceType != vk::PhysicalDeviceType::eDiscreteGpu)
+    const bool fastPaths[] = {
+        capabilities.dedicatedTransferQueue, capabilities.bufferDeviceAddress,
+        capabilities.descriptorIndexing,     capabilities.synchronization2,
+        capabilities.dynamicRendering,       capabilities.memoryBudget,
+    };
+    for (const bool supported : fastPaths)
+    {
+        score += supported ? 1000 : 0;
+    }
+
+    // One point per 64 MiB of device local memory, to break ties between similar devices
+    score += capabilities.deviceLocalBytes >> 26;
+
+    return score;
+}
+
+bool isDeviceSuitable(vk::Instance instance, vk::PhysicalDevice device, bool headless,
+                      const DeviceCapabilities& capabilities)
+{
+    // Uploads are tracked with timeline semaphores
+    if (!capabilities.timelineSemaphore)
     {
         return false;
     }
 
-    const auto queueFamily = findQueueFamiles(device);
+    const auto queueFamily = findQueueFamiles(instance, device, headless);
     if (queueFamily.graphics == std::numeric_limits<uint32_t>::max()
-        || queueFamily.present == std::numeric_limits<uint32_t>::max())
+        || (!headless && queueFamily.present == std::numeric_limits<uint32_t>::max()))
     {
         return false;
     }
 
-    const bool extSupport = checkDeviceExtensionSupport(device);
+    const bool extSupport = checkDeviceExtensionSupport(device, headless);
     if (!extSupport)
     {
         return false;
@@ -202,9 +396,17 @@ bool isDeviceSuitable(vk::PhysicalDevice device)
 
 }  // namespace
 
-vk::Result Context::init(bool enableValidationLayers)
+vk::Result Context::init(const ContextCreateInfo* pCreateInfo)
 {
-    glfwInit();
+    mHeadless = pCreateInfo->headless;
+
+    if (!mHeadless)
+    {
+        initGlfw(pCreateInfo->platform);
+
+        mPlatform = fromGlfwPlatform(glfwGetPlatform());
+        LOG_DEBUG("Presenting through %s", platformName(mPlatform));
+    }
 
     const vk::ApplicationInfo appInfo{
         .pApplicationName = "PyroC Backend",
@@ -214,10 +416,10 @@ vk::Result Context::init(bool enableValidationLayers)
         .apiVersion = VK_API_VERSION_1_3,
     };
 
-    const bool useValidation = enableValidationLayers && checkValidationLayerSupport();
+    const bool useValidation = pCreateInfo->enableValidationLayers && checkValidationLayerSupport();
     LOG_DEBUG("Using validation?: %s", (useValidation ? "TRUE" : "FALSE"));
 
-    auto extensions = getRequiredInstanceExtensions(useValidation);
+    auto extensions = getRequiredInstanceExtensions(useValidation, mHeadless);
 
     {
         const vk::ValidationFeatureEnableEXT validationFeaturesEnabled[] = {
@@ -287,13 +489,25 @@ vk::Result Context::init(bool enableValidationLayers)
         }
 
         bool found = false;
+        uint64_t bestScore = 0;
         for (const auto& device : devices)
         {
-            if (isDeviceSuitable(device))
+            const DeviceCapabilities capabilities = queryCapabilities(device);
+            if (!isDeviceSuitable(mInstance, device, mHeadless, capabilities))
+            {
+                continue;
+            }
+
+            const uint64_t score = scoreDevice(capabilities);
+            LOG_DEBUG("Device %s scored %llu", device.getProperties().deviceName.data(),
+                      static_cast<unsigned long long>(score));
+
+            if (!found || score > bestScore)
             {
                 found = true;
+                bestScore = score;
                 mPhysicalDevice = device;
-                break;
+                mCapabilities = capabilities;
             }
         }
 
@@ -304,7 +518,7 @@ vk::Result Context::init(bool enableValidationLayers)
     }
 
     {
-        mQueueFamilyIndices = findQueueFamiles(mPhysicalDevice);
+        mQueueFamilyIndices = findQueueFamiles(mInstance, mPhysicalDevice, mHeadless);
     }
 
     {
@@ -318,7 +532,7 @@ vk::Result Context::init(bool enableValidationLayers)
             .pQueuePriorities = queuePriority,
         });
 
-        if (mQueueFamilyIndices.graphics != mQueueFamilyIndices.present)
+        if (!mHeadless && mQueueFamilyIndices.graphics != mQueueFamilyIndices.present)
         {
             queueCreateInfos.push_back({
                 .queueFamilyIndex = mQueueFamilyIndices.present,
@@ -327,11 +541,46 @@ vk::Result Context::init(bool enableValidationLayers)
             });
         }
 
+        if (mQueueFamilyIndices.transfer != mQueueFamilyIndices.graphics
+            && mQueueFamilyIndices.transfer != mQueueFamilyIndices.present)
+        {
+            queueCreateInfos.push_back({
+                .queueFamilyIndex = mQueueFamilyIndices.transfer,
+                .queueCount = 1,
+                .pQueuePriorities = queuePriority,
+            });
+        }
+
         const vk::PhysicalDeviceFeatures deviceFeatures = {};
 
-        const auto requiredExts = getRequiredDeviceExtensions();
+        // Everything optional the device supports is enabled, see queryCapabilities
+        const auto enable = [](bool supported) { return supported ? vk::True : vk::False; };
+
+        vk::PhysicalDeviceVulkan13Features vulkan13Features = {
+            .synchronization2 = enable(mCapabilities.synchronization2),
+            .dynamicRendering = enable(mCapabilities.dynamicRendering),
+        };
+
+        const vk::PhysicalDeviceVulkan12Features vulkan12Features = {
+            .pNext
+            = mCapabilities.apiVersion >= VK_API_VERSION_1_3 ? &vulkan13Features : nullptr,
+            .descriptorIndexing = enable(mCapabilities.descriptorIndexing),
+            .shaderSampledImageArrayNonUniformIndexing = enable(mCapabilities.descriptorIndexing),
+            .descriptorBindingPartiallyBound = enable(mCapabilities.descriptorIndexing),
+            .descriptorBindingVariableDescriptorCount = enable(mCapabilities.descriptorIndexing),
+            .runtimeDescriptorArray = enable(mCapabilities.descriptorIndexing),
+            .timelineSemaphore = vk::True,
+            .bufferDeviceAddress = enable(mCapabilities.bufferDeviceAddress),
+        };
+
+        auto requiredExts = getRequiredDeviceExtensions(mHeadless);
+        if (mCapabilities.memoryBudget)
+        {
+            requiredExts.push_back(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+        }
 
         const vk::DeviceCreateInfo deviceCreateInfo = {
+            .pNext = &vulkan12Features,
             .queueCreateInfoCount = static_cast<uint32_t>(queueCreateInfos.size()),
             .pQueueCreateInfos = queueCreateInfos.data(),
             .enabledLayerCount = 0,
@@ -352,7 +601,65 @@ vk::Result Context::init(bool enableValidationLayers)
 
     {
         mGraphicsQueue = mDevice.getQueue(mQueueFamilyIndices.graphics, 0);
-        mPresentQueue = mDevice.getQueue(mQueueFamilyIndices.present, 0);
+        if (!mHeadless)
+        {
+            mPresentQueue = mDevice.getQueue(mQueueFamilyIndices.present, 0);
+        }
+        mTransferQueue = mDevice.getQueue(mQueueFamilyIndices.transfer, 0);
+    }
+
+    {
+        const MemoryAllocatorCreateInfo allocatorCreateInfo = {
+            .deviceAddress = mCapabilities.bufferDeviceAddress,
+        };
+        const auto res = mAllocator.init(mPhysicalDevice, mDevice, &allocatorCreateInfo);
+        if (res != vk::Result::eSuccess)
+        {
+            return res;
+        }
+    }
+
+    {
+        const StagingRingCreateInfo stagingCreateInfo = {};
+        const auto res = mStagingRing.init(this, &stagingCreateInfo);
+        if (res != vk::Result::eSuccess)
+        {
+            return res;
+        }
+    }
+
+    {
+        const UploadQueueCreateInfo uploadCreateInfo = {};
+        const auto res = mUploadQueue.init(this, &uploadCreateInfo);
+        if (res != vk::Result::eSuccess)
+        {
+            return res;
+        }
+    }
+
+    {
+        const PipelineCacheCreateInfo pipelineCacheCreateInfo = {
+            .pPath = pCreateInfo->pPipelineCachePath,
+        };
+        const auto res = mPipelineCache.init(this, &pipelineCacheCreateInfo);
+        if (res != vk::Result::eSuccess)
+        {
+            return res;
+        }
+    }
+
+    mShaders.init(mDevice);
+    mLayouts.init(this);
+
+    {
+        const PipelineMapCreateInfo pipelineMapCreateInfo = {
+            .workerCount = pCreateInfo->pipelineCompileThreads,
+        };
+        const auto res = mPipelines.init(this, &pipelineMapCreateInfo);
+        if (res != vk::Result::eSuccess)
+        {
+            return res;
+        }
     }
 
     return vk::Result::eSuccess;
@@ -360,10 +667,20 @@ vk::Result Context::init(bool enableValidationLayers)
 
 void Context::destroy()
 {
+    mPipelines.destroy();
+    mLayouts.destroy();
+    mShaders.destroy();
+    mPipelineCache.destroy();
+    mUploadQueue.destroy();
+    mStagingRing.destroy();
+    mAllocator.destroy();
     mDevice.destroy();
     mInstance.destroy();
 
-    glfwTerminate();
+    if (!mHeadless)
+    {
+        glfwTerminate();
+    }
 }
 
 }  // namespace pyroc::backend::vulkan
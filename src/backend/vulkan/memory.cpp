@@ -0,0 +1,698 @@
+#include "backend/vulkan/memory.h"
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+
+namespace pyroc::backend::vulkan
+{
+namespace
+{
+vk::DeviceSize alignUp(vk::DeviceSize value, vk::DeviceSize alignment)
+{
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+
+struct BinIndex
+{
+    uint32_t fl;
+    uint32_t sl;
+};
+
+template <uint32_t SlLog2, uint32_t FlShift>
+BinIndex binIndex(vk::DeviceSize size)
+{
+    constexpr vk::DeviceSize smallSize = vk::DeviceSize{1} << FlShift;
+    if (size < smallSize)
+    {
+        return {.fl = 0, .sl = static_cast<uint32_t>(size / (smallSize >> SlLog2))};
+    }
+
+    const auto fl = static_cast<uint32_t>(std::bit_width(size) - 1);
+    const auto sl = static_cast<uint32_t>((size >> (fl - SlLog2)) ^ (vk::DeviceSize{1} << SlLog2));
+    return {.fl = fl - (FlShift - 1), .sl = sl};
+}
+}  // namespace
+
+void RangeAllocator::init(vk::DeviceSize size)
+{
+    mNodes.clear();
+    mUnusedNodes.clear();
+
+    mFlBitmap = 0;
+    std::fill(std::begin(mSlBitmap), std::end(mSlBitmap), 0u);
+    for (auto& heads : mFreeHeads)
+    {
+        std::fill(std::begin(heads), std::end(heads), kInvalidNode);
+    }
+
+    mSize = size & ~((vk::DeviceSize{1} << kGranularityLog2) - 1);
+    mUsed = 0;
+    mAllocationCount = 0;
+
+    mFirstNode = createNode(0, mSize);
+    insertFree(mFirstNode);
+}
+
+uint32_t RangeAllocator::createNode(vk::DeviceSize offset, vk::DeviceSize size)
+{
+    uint32_t index = 0;
+    if (!mUnusedNodes.empty())
+    {
+        index = mUnusedNodes.back();
+        mUnusedNodes.pop_back();
+    }
+    else
+    {
+        index = static_cast<uint32_t>(mNodes.size());
+        mNodes.emplace_back();
+    }
+
+    mNodes[index] = {.offset = offset, .size = size};
+    return index;
+}
+
+void RangeAllocator::releaseNode(uint32_t node) { mUnusedNodes.push_back(node); }
+
+void RangeAllocator::linkAfter(uint32_t prev, uint32_t node)
+{
+    const uint32_t next = mNodes[prev].nextPhys;
+    mNodes[node].prevPhys = prev;
+    mNodes[node].nextPhys = next;
+    mNodes[prev].nextPhys = node;
+    if (next != kInvalidNode)
+    {
+        mNodes[next].prevPhys = node;
+    }
+}
+
+void RangeAllocator::unlink(uint32_t node)
+{
+    const uint32_t prev = mNodes[node].prevPhys;
+    const uint32_t next = mNodes[node].nextPhys;
+    if (prev != kInvalidNode)
+    {
+        mNodes[prev].nextPhys = next;
+    }
+    if (next != kInvalidNode)
+    {
+        mNodes[next].prevPhys = prev;
+    }
+}
+
+void RangeAllocator::insertFree(uint32_t node)
+{
+    const BinIndex bin = binIndex<kSlIndexCountLog2, kFlIndexShift>(mNodes[node].size);
+
+    const uint32_t head = mFreeHeads[bin.fl][bin.sl];
+    mNodes[node].free = true;
+    mNodes[node].prevFree = kInvalidNode;
+    mNodes[node].nextFree = head;
+    if (head != kInvalidNode)
+    {
+        mNodes[head].prevFree = node;
+    }
+
+    mFreeHeads[bin.fl][bin.sl] = node;
+    mFlBitmap |= uint64_t{1} << bin.fl;
+    mSlBitmap[bin.fl] |= 1u << bin.sl;
+}
+
+void RangeAllocator::removeFree(uint32_t node)
+{
+    const BinIndex bin = binIndex<kSlIndexCountLog2, kFlIndexShift>(mNodes[node].size);
+
+    const uint32_t prev = mNodes[node].prevFree;
+    const uint32_t next = mNodes[node].nextFree;
+    if (prev != kInvalidNode)
+    {
+        mNodes[prev].nextFree = next;
+    }
+    if (next != kInvalidNode)
+    {
+        mNodes[next].prevFree = prev;
+    }
+
+    if (mFreeHeads[bin.fl][bin.sl] == node)
+    {
+        mFreeHeads[bin.fl][bin.sl] = next;
+        if (next == kInvalidNode)
+        {
+            mSlBitmap[bin.fl] &= ~(1u << bin.sl);
+            if (mSlBitmap[bin.fl] == 0)
+            {
+                mFlBitmap &= ~(uint64_t{1} << bin.fl);
+            }
+        }
+    }
+
+    mNodes[node].free = false;
+}
+
+uint32_t RangeAllocator::findFree(vk::DeviceSize size) const
+{
+    // Round up to the next bin so any range found is large enough
+    if (size >= (vk::DeviceSize{1} << kFlIndexShift))
+    {
+        size += (vk::DeviceSize{1} << (std::bit_width(size) - 1 - kSlIndexCountLog2)) - 1;
+    }
+
+    BinIndex bin = binIndex<kSlIndexCountLog2, kFlIndexShift>(size);
+    if (bin.fl >= kFlIndexCount)
+    {
+        return kInvalidNode;
+    }
+
+    uint32_t slMap = bin.sl < kSlIndexCount ? mSlBitmap[bin.fl] & (~0u << bin.sl) : 0;
+    if (slMap == 0)
+    {
+        const uint64_t flMap = bin.fl + 1 < 64 ? mFlBitmap & (~uint64_t{0} << (bin.fl + 1)) : 0;
+        if (flMap == 0)
+        {
+            return kInvalidNode;
+        }
+
+        bin.fl = static_cast<uint32_t>(std::countr_zero(flMap));
+        slMap = mSlBitmap[bin.fl];
+    }
+
+    bin.sl = static_cast<uint32_t>(std::countr_zero(slMap));
+    return mFreeHeads[bin.fl][bin.sl];
+}
+
+uint32_t RangeAllocator::allocate(vk::DeviceSize size, vk::DeviceSize alignment, void* pUserData,
+                                  vk::DeviceSize& offset)
+{
+    constexpr vk::DeviceSize granularity = vk::DeviceSize{1} << kGranularityLog2;
+
+    size = alignUp(std::max(size, vk::DeviceSize{1}), granularity);
+    alignment = std::max(alignment, granularity);
+
+    // Free ranges start on the granularity, so this much slack always covers the alignment
+    const uint32_t found = findFree(size + alignment - granularity);
+    if (found == kInvalidNode)
+    {
+        return kInvalidNode;
+    }
+
+    removeFree(found);
+
+    uint32_t node = found;
+    const vk::DeviceSize alignedOffset = alignUp(mNodes[found].offset, alignment);
+    const vk::DeviceSize padding = alignedOffset - mNodes[found].offset;
+    if (padding > 0)
+    {
+        // The found range keeps the padding in front and stays free
+        node = createNode(alignedOffset, mNodes[found].size - padding);
+        linkAfter(found, node);
+        mNodes[found].size = padding;
+        insertFree(found);
+    }
+
+    if (mNodes[node].size > size)
+    {
+        const uint32_t remainder = createNode(alignedOffset + size, mNodes[node].size - size);
+        linkAfter(node, remainder);
+        mNodes[node].size = size;
+        insertFree(remainder);
+    }
+
+    mNodes[node].alignment = alignment;
+    mNodes[node].pUserData = pUserData;
+
+    mUsed += size;
+    ++mAllocationCount;
+
+    offset = alignedOffset;
+    return node;
+}
+
+void RangeAllocator::free(uint32_t node)
+{
+    mUsed -= mNodes[node].size;
+    --mAllocationCount;
+
+    const uint32_t prev = mNodes[node].prevPhys;
+    if (prev != kInvalidNode && mNodes[prev].free)
+    {
+        removeFree(prev);
+        mNodes[prev].size += mNodes[node].size;
+        unlink(node);
+        releaseNode(node);
+        node = prev;
+    }
+
+    const uint32_t next = mNodes[node].nextPhys;
+    if (next != kInvalidNode && mNodes[next].free)
+    {
+        removeFree(next);
+        mNodes[node].size += mNodes[next].size;
+        unlink(next);
+        releaseNode(next);
+    }
+
+    mNodes[node].pUserData = nullptr;
+    insertFree(node);
+}
+
+uint32_t RangeAllocator::nextAllocated(uint32_t node) const
+{
+    node = node == kInvalidNode ? mFirstNode : mNodes[node].nextPhys;
+    while (node != kInvalidNode && mNodes[node].free)
+    {
+        node = mNodes[node].nextPhys;
+    }
+    return node;
+}
+
+vk::Result MemoryAllocator::init(vk::PhysicalDevice physicalDevice, vk::Device device,
+                                 const MemoryAllocatorCreateInfo* pCreateInfo)
+{
+    mDevice = device;
+    mMemoryProperties = physicalDevice.getMemoryProperties();
+    mBlockSize = pCreateInfo->blockSize;
+    mDeviceAddress = pCreateInfo->deviceAddress;
+    mNonCoherentAtomSize = physicalDevice.getProperties().limits.nonCoherentAtomSize;
+
+    return vk::Result::eSuccess;
+}
+
+void MemoryAllocator::destroy()
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+
+    for (uint32_t memoryType = 0; memoryType < mMemoryProperties.memoryTypeCount; ++memoryType)
+    {
+        MemoryType& type = mMemoryTypes[memoryType];
+        for (Block& block : type.blocks)
+        {
+            if (block.memory)
+            {
+                mDevice.freeMemory(block.memory);
+            }
+        }
+
+        type = {};
+    }
+}
+
+uint32_t MemoryAllocator::findMemoryType(uint32_t typeBits,
+                                         vk::MemoryPropertyFlags properties) const
+{
+    for (uint32_t i = 0; i < mMemoryProperties.memoryTypeCount; ++i)
+    {
+        if ((typeBits & (1u << i))
+            && (mMemoryProperties.memoryTypes[i].propertyFlags & properties) == properties)
+        {
+            return i;
+        }
+    }
+
+    return ~0u;
+}
+
+vk::Result MemoryAllocator::allocateMemory(uint32_t memoryType, vk::DeviceSize size,
+                                           vk::DeviceMemory& memory, void*& pMapped)
+{
+    const vk::MemoryAllocateFlagsInfo flagsInfo = {
+        .flags = vk::MemoryAllocateFlagBits::eDeviceAddress,
+    };
+
+    const vk::MemoryAllocateInfo allocInfo = {
+        .pNext = mDeviceAddress ? &flagsInfo : nullptr,
+        .allocationSize = size,
+        .memoryTypeIndex = memoryType,
+    };
+
+    {
+        const auto [res, handle] = mDevice.allocateMemory(allocInfo);
+        if (res != vk::Result::eSuccess)
+        {
+            return res;
+        }
+
+        memory = handle;
+    }
+
+    pMapped = nullptr;
+    if (mMemoryProperties.memoryTypes[memoryType].propertyFlags
+        & vk::MemoryPropertyFlagBits::eHostVisible)
+    {
+        const auto res = mDevice.mapMemory(memory, 0, vk::WholeSize, {}, &pMapped);
+        if (res != vk::Result::eSuccess)
+        {
+            mDevice.freeMemory(memory);
+            return res;
+        }
+    }
+
+    return vk::Result::eSuccess;
+}
+
+vk::Result MemoryAllocator::createBlock(uint32_t memoryType, uint32_t& blockIndex)
+{
+    MemoryType& type = mMemoryTypes[memoryType];
+
+    // Reuse a released slot so the indices held by allocations stay valid
+    blockIndex = static_cast<uint32_t>(type.blocks.size());
+    for (uint32_t i = 0; i < type.blocks.size(); ++i)
+    {
+        if (!type.blocks[i].memory)
+        {
+            blockIndex = i;
+            break;
+        }
+    }
+
+    Block block;
+    {
+        const auto res = allocateMemory(memoryType, mBlockSize, block.memory, block.pMapped);
+        if (res != vk::Result::eSuccess)
+        {
+            return res;
+        }
+    }
+
+    block.ranges.init(mBlockSize);
+    if (blockIndex == type.blocks.size())
+    {
+        type.blocks.push_back(std::move(block));
+    }
+    else
+    {
+        type.blocks[blockIndex] = std::move(block);
+    }
+
+    ++type.liveBlocks;
+    return vk::Result::eSuccess;
+}
+
+void MemoryAllocator::releaseBlock(uint32_t memoryType, uint32_t blockIndex)
+{
+    MemoryType& type = mMemoryTypes[memoryType];
+
+    // Freeing implicitly unmaps
+    mDevice.freeMemory(type.blocks[blockIndex].memory);
+    type.blocks[blockIndex] = {};
+    --type.liveBlocks;
+}
+
+Allocation MemoryAllocator::makeAllocation(uint32_t memoryType, uint32_t blockIndex,
+                                           uint32_t node) const
+{
+    const Block& block = mMemoryTypes[memoryType].blocks[blockIndex];
+    const vk::DeviceSize offset = block.ranges.offset(node);
+
+    return {
+        .memory = block.memory,
+        .offset = offset,
+        .size = block.ranges.size(node),
+        .pMapped = block.pMapped ? static_cast<std::byte*>(block.pMapped) + offset : nullptr,
+        .pUserData = block.ranges.userData(node),
+        .memoryType = memoryType,
+        .block = blockIndex,
+        .node = node,
+    };
+}
+
+vk::Result MemoryAllocator::allocate(const vk::MemoryRequirements& requirements,
+                                     vk::MemoryPropertyFlags properties, void* pUserData,
+                                     Allocation& allocation)
+{
+    const uint32_t memoryType = findMemoryType(requirements.memoryTypeBits, properties);
+    if (memoryType == ~0u)
+    {
+        return vk::Result::eErrorUnknown;
+    }
+
+    vk::MemoryRequirements padded = requirements;
+    {
+        const vk::MemoryPropertyFlags typeFlags
+            = mMemoryProperties.memoryTypes[memoryType].propertyFlags;
+        if ((typeFlags & vk::MemoryPropertyFlagBits::eHostVisible)
+            && !(typeFlags & vk::MemoryPropertyFlagBits::eHostCoherent))
+        {
+            padded.alignment = std::max(padded.alignment, mNonCoherentAtomSize);
+            padded.size = alignUp(padded.size, mNonCoherentAtomSize);
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(mMutex);
+    MemoryType& type = mMemoryTypes[memoryType];
+
+    if (padded.size <= mBlockSize / 2)
+    {
+        for (uint32_t i = 0; i < type.blocks.size(); ++i)
+        {
+            Block& block = type.blocks[i];
+            if (!block.memory)
+            {
+                continue;
+            }
+
+            vk::DeviceSize offset = 0;
+            const uint32_t node = block.ranges.allocate(padded.size, padded.alignment,
+                                                        pUserData, offset);
+            if (node != RangeAllocator::kInvalidNode)
+            {
+                allocation = makeAllocation(memoryType, i, node);
+                return vk::Result::eSuccess;
+            }
+        }
+
+        // Out of space, fall back to a dedicated allocation if a new block does not fit the heap
+        uint32_t blockIndex = 0;
+        if (createBlock(memoryType, blockIndex) == vk::Result::eSuccess)
+        {
+            vk::DeviceSize offset = 0;
+            const uint32_t node = type.blocks[blockIndex].ranges.allocate(
+                padded.size, padded.alignment, pUserData, offset);
+            if (node != RangeAllocator::kInvalidNode)
+            {
+                allocation = makeAllocation(memoryType, blockIndex, node);
+                return vk::Result::eSuccess;
+            }
+
+            // The new block could not fit the request either, only keep it if it is the last one
+            if (type.liveBlocks > 1)
+            {
+                releaseBlock(memoryType, blockIndex);
+            }
+        }
+    }
+
+    Allocation dedicated;
+    dedicated.size = padded.size;
+    dedicated.pUserData = pUserData;
+    dedicated.memoryType = memoryType;
+
+    {
+        const auto res
+            = allocateMemory(memoryType, padded.size, dedicated.memory, dedicated.pMapped);
+        if (res != vk::Result::eSuccess)
+        {
+            return res;
+        }
+    }
+
+    ++type.dedicatedCount;
+    type.dedicatedBytes += padded.size;
+
+    allocation = dedicated;
+    return vk::Result::eSuccess;
+}
+
+void MemoryAllocator::freeLocked(const Allocation& allocation)
+{
+    MemoryType& type = mMemoryTypes[allocation.memoryType];
+
+    if (allocation.block == Allocation::kDedicated)
+    {
+        mDevice.freeMemory(allocation.memory);
+        --type.dedicatedCount;
+        type.dedicatedBytes -= allocation.size;
+        return;
+    }
+
+    Block& block = type.blocks[allocation.block];
+    block.ranges.free(allocation.node);
+
+    // Keep one empty block around so alternating alloc/free does not hit vkAllocateMemory
+    if (block.ranges.allocationCount() == 0 && type.liveBlocks > 1)
+    {
+        releaseBlock(allocation.memoryType, allocation.block);
+    }
+}
+
+void MemoryAllocator::free(Allocation& allocation)
+{
+    if (!allocation.memory)
+    {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        freeLocked(allocation);
+    }
+
+    allocation = {};
+}
+
+vk::MappedMemoryRange MemoryAllocator::mappedRange(const Allocation& allocation,
+                                                   vk::DeviceSize offset,
+                                                   vk::DeviceSize size) const
+{
+    if (size == vk::WholeSize)
+    {
+        size = allocation.size - offset;
+    }
+
+    // Allocations of non coherent types start and end on an atom boundary, see allocate
+    const vk::DeviceSize begin = (allocation.offset + offset) & ~(mNonCoherentAtomSize - 1);
+    const vk::DeviceSize end = std::min(alignUp(allocation.offset + offset + size,
+                                                mNonCoherentAtomSize),
+                                        allocation.offset + allocation.size);
+
+    return {
+        .memory = allocation.memory,
+        .offset = begin,
+        .size = end - begin,
+    };
+}
+
+vk::Result MemoryAllocator::flush(const Allocation& allocation, vk::DeviceSize offset,
+                                  vk::DeviceSize size)
+{
+    if (isCoherent(allocation))
+    {
+        return vk::Result::eSuccess;
+    }
+
+    const vk::MappedMemoryRange range = mappedRange(allocation, offset, size);
+    return mDevice.flushMappedMemoryRanges(1, &range);
+}
+
+vk::Result MemoryAllocator::invalidate(const Allocation& allocation, vk::DeviceSize offset,
+                                       vk::DeviceSize size)
+{
+    if (isCoherent(allocation))
+    {
+        return vk::Result::eSuccess;
+    }
+
+    const vk::MappedMemoryRange range = mappedRange(allocation, offset, size);
+    return mDevice.invalidateMappedMemoryRanges(1, &range);
+}
+
+void MemoryAllocator::addStats(uint32_t memoryType, MemoryStats& stats) const
+{
+    const MemoryType& type = mMemoryTypes[memoryType];
+    for (const Block& block : type.blocks)
+    {
+        if (!block.memory)
+        {
+            continue;
+        }
+
+        ++stats.blockCount;
+        stats.allocationCount += block.ranges.allocationCount();
+        stats.reservedBytes += block.ranges.size();
+        stats.usedBytes += block.ranges.used();
+    }
+
+    stats.allocationCount += type.dedicatedCount;
+    stats.dedicatedAllocationCount += type.dedicatedCount;
+    stats.reservedBytes += type.dedicatedBytes;
+    stats.usedBytes += type.dedicatedBytes;
+}
+
+MemoryStats MemoryAllocator::stats() const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+
+    MemoryStats stats;
+    for (uint32_t memoryType = 0; memoryType < mMemoryProperties.memoryTypeCount; ++memoryType)
+    {
+        addStats(memoryType, stats);
+    }
+    return stats;
+}
+
+MemoryStats MemoryAllocator::stats(uint32_t memoryType) const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+
+    MemoryStats stats;
+    addStats(memoryType, stats);
+    return stats;
+}
+
+size_t MemoryAllocator::beginDefragmentation(std::span<DefragmentationMove> moves)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+
+    size_t count = 0;
+    for (uint32_t memoryType = 0; memoryType < mMemoryProperties.memoryTypeCount; ++memoryType)
+    {
+        MemoryType& type = mMemoryTypes[memoryType];
+        if (type.liveBlocks < 2)
+        {
+            continue;
+        }
+
+        // Empty the least used block into the others
+        uint32_t source = ~0u;
+        for (uint32_t i = 0; i < type.blocks.size(); ++i)
+        {
+            const Block& block = type.blocks[i];
+            if (block.memory
+                && (source == ~0u || block.ranges.used() < type.blocks[source].ranges.used()))
+            {
+                source = i;
+            }
+        }
+
+        const RangeAllocator& sourceRanges = type.blocks[source].ranges;
+        for (uint32_t node = sourceRanges.nextAllocated(RangeAllocator::kInvalidNode);
+             node != RangeAllocator::kInvalidNode && count < moves.size();
+             node = sourceRanges.nextAllocated(node))
+        {
+            for (uint32_t i = 0; i < type.blocks.size(); ++i)
+            {
+                Block& block = type.blocks[i];
+                if (i == source || !block.memory)
+                {
+                    continue;
+                }
+
+                vk::DeviceSize offset = 0;
+                const uint32_t dst
+                    = block.ranges.allocate(sourceRanges.size(node), sourceRanges.alignment(node),
+                                            sourceRanges.userData(node), offset);
+                if (dst != RangeAllocator::kInvalidNode)
+                {
+                    moves[count++] = {
+                        .src = makeAllocation(memoryType, source, node),
+                        .dst = makeAllocation(memoryType, i, dst),
+                    };
+                    break;
+                }
+            }
+        }
+    }
+
+    return count;
+}
+
+void MemoryAllocator::endDefragmentation(std::span<const DefragmentationMove> moves)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+
+    for (const DefragmentationMove& move : moves)
+    {
+        freeLocked(move.src);
+    }
+}
+
+}  // namespace pyroc::backend::vulkan
@@ -0,0 +1,384 @@
+#include "backend/vulkan/offscreen.h"
+
+#include "backend/vulkan/context.h"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+namespace pyroc::backend::vulkan
+{
+
+namespace
+{
+constexpr vk::DeviceSize kTexelSize = 4;
+
+vk::Result createImage(Context* ctx, RenderTarget& target)
+{
+    vk::Device device = ctx->device();
+
+    {
+        const vk::ImageCreateInfo imageInfo = {
+            .imageType = vk::ImageType::e2D,
+            .format = target.format,
+            .extent = {
+                .width = target.extent.width,
+                .height = target.extent.height,
+                .depth = 1,
+            },
+            .mipLevels = 1,
+            .arrayLayers = 1,
+            .samples = vk::SampleCountFlagBits::e1,
+            .tiling = vk::ImageTiling::eOptimal,
+            .usage = vk::ImageUsageFlagBits::eColorAttachment
+                     | vk::ImageUsageFlagBits::eTransferSrc,
+            .sharingMode = vk::SharingMode::eExclusive,
+            .initialLayout = vk::ImageLayout::eUndefined,
+        };
+
+        const auto [res, handle] = device.createImage(imageInfo);
+        if (res != vk::Result::eSuccess)
+        {
+            return res;
+        }
+
+        target.image = handle;
+    }
+
+    {
+        vk::MemoryRequirements requirements = device.getImageMemoryRequirements(target.image);
+
+        // Blocks are shared with buffers, keep the image on pages of its own
+        const vk::DeviceSize granularity
+            = ctx->physicalDevice().getProperties().limits.bufferImageGranularity;
+        requirements.alignment = std::max(requirements.alignment, granularity);
+        requirements.size = (requirements.size + granularity - 1) & ~(granularity - 1);
+
+        const auto res = ctx->allocator().allocate(
+            requirements, vk::MemoryPropertyFlagBits::eDeviceLocal, nullptr, target.allocation);
+        if (res != vk::Result::eSuccess)
+        {
+            return res;
+        }
+    }
+
+    {
+        const auto res = device.bindImageMemory(target.image, target.allocation.memory,
+                                                target.allocation.offset);
+        if (res != vk::Result::eSuccess)
+        {
+            return res;
+        }
+    }
+
+    {
+        const vk::ImageViewCreateInfo viewInfo = {
+            .image = target.image,
+            .viewType = vk::ImageViewType::e2D,
+            .format = target.format,
+            .subresourceRange = {
+                .aspectMask = vk::ImageAspectFlagBits::eColor,
+                .baseMipLevel = 0,
+                .levelCount = 1,
+                .baseArrayLayer = 0,
+                .layerCount = 1,
+            },
+        };
+
+        const auto [res, handle] = device.createImageView(viewInfo);
+        if (res != vk::Result::eSuccess)
+        {
+            return res;
+        }
+
+        target.imageView = handle;
+    }
+
+    return vk::Result::eSuccess;
+}
+
+vk::Result createRenderPass(Context* ctx, RenderTarget& target)
+{
+    const vk::AttachmentDescription colorAttachment = {
+        .format = target.format,
+        .samples = vk::SampleCountFlagBits::e1,
+        .loadOp = vk::AttachmentLoadOp::eClear,
+        .storeOp = vk::AttachmentStoreOp::eStore,
+        .stencilLoadOp = vk::AttachmentLoadOp::eDontCare,
+        .stencilStoreOp = vk::AttachmentStoreOp::eDontCare,
+        .initialLayout = vk::ImageLayout::eUndefined,
+        .finalLayout = vk::ImageLayout::eTransferSrcOptimal,
+    };
+
+    const vk::AttachmentReference colorAttachmentRef = {
+        .attachment = 0,
+        .layout = vk::ImageLayout::eColorAttachmentOptimal,
+    };
+
+    const vk::SubpassDescription subpass = {
+        .pipelineBindPoint = vk::PipelineBindPoint::eGraphics,
+        .colorAttachmentCount = 1,
+        .pColorAttachments = &colorAttachmentRef,
+    };
+
+    // Order against the previous frame's readback, and make the result visible to the next one
+    const vk::SubpassDependency dependencies[] = {
+        {
+            .srcSubpass = vk::SubpassExternal,
+            .dstSubpass = 0,
+            .srcStageMask = vk::PipelineStageFlagBits::eTransfer,
+            .dstStageMask = vk::PipelineStageFlagBits::eColorAttachmentOutput,
+            .srcAccessMask = {},
+            .dstAccessMask = vk::AccessFlagBits::eColorAttachmentWrite,
+        },
+        {
+            .srcSubpass = 0,
+            .dstSubpass = vk::SubpassExternal,
+            .srcStageMask = vk::PipelineStageFlagBits::eColorAttachmentOutput,
+            .dstStageMask = vk::PipelineStageFlagBits::eTransfer,
+            .srcAccessMask = vk::AccessFlagBits::eColorAttachmentWrite,
+            .dstAccessMask = vk::AccessFlagBits::eTransferRead,
+        },
+    };
+
+    const vk::RenderPassCreateInfo renderPassInfo = {
+        .attachmentCount = 1,
+        .pAttachments = &colorAttachment,
+        .subpassCount = 1,
+        .pSubpasses = &subpass,
+        .dependencyCount = static_cast<uint32_t>(std::size(dependencies)),
+        .pDependencies = dependencies,
+    };
+
+    vk::Device device = ctx->device();
+
+    {
+        const auto [res, handle] = device.createRenderPass(renderPassInfo);
+        if (res != vk::Result::eSuccess)
+        {
+            return res;
+        }
+
+        target.renderPass = handle;
+    }
+
+    {
+        const vk::FramebufferCreateInfo framebufferInfo = {
+            .renderPass = target.renderPass,
+            .attachmentCount = 1,
+            .pAttachments = &target.imageView,
+            .width = target.extent.width,
+            .height = target.extent.height,
+            .layers = 1,
+        };
+
+        const auto [res, handle] = device.createFramebuffer(framebufferInfo);
+        if (res != vk::Result::eSuccess)
+        {
+            return res;
+        }
+
+        target.framebuffer = handle;
+    }
+
+    return vk::Result::eSuccess;
+}
+
+}  // namespace
+
+vk::Result createRenderTarget(Context* ctx, const RenderTargetCreateInfo* createInfo,
+                              RenderTarget& target)
+{
+    target = {};
+
+    // The readback buffer and readRenderTarget's callers assume tightly packed 4 byte texels
+    if (vk::blockSize(createInfo->format) != kTexelSize)
+    {
+        return vk::Result::eErrorFormatNotSupported;
+    }
+
+    target.format = createInfo->format;
+    target.extent = createInfo->extent;
+
+    vk::Result res;
+
+    res = createImage(ctx, target);
+    if (res != vk::Result::eSuccess)
+    {
+        destroyRenderTarget(ctx, target);
+        return res;
+    }
+
+    res = createRenderPass(ctx, target);
+    if (res != vk::Result::eSuccess)
+    {
+        destroyRenderTarget(ctx, target);
+        return res;
+    }
+
+    // Cached memory keeps the host reads fast, where the device has it
+    const vk::DeviceSize readbackSize
+        = kTexelSize * target.extent.width * target.extent.height;
+
+    res = createBuffer(ctx, readbackSize, vk::BufferUsageFlagBits::eTransferDst,
+                       vk::MemoryPropertyFlagBits::eHostVisible
+                           | vk::MemoryPropertyFlagBits::eHostCached,
+                       target.readback);
+    if (res != vk::Result::eSuccess)
+    {
+        res = createBuffer(ctx, readbackSize, vk::BufferUsageFlagBits::eTransferDst,
+                           vk::MemoryPropertyFlagBits::eHostVisible, target.readback);
+    }
+
+    if (res != vk::Result::eSuccess)
+    {
+        destroyRenderTarget(ctx, target);
+        return res;
+    }
+
+    return vk::Result::eSuccess;
+}
+
+void destroyRenderTarget(Context* ctx, RenderTarget& target)
+{
+    vk::Device device = ctx->device();
+
+    if (target.readback.buffer)
+    {
+        destroyBuffer(ctx, target.readback);
+    }
+
+    device.destroyFramebuffer(target.framebuffer);
+    device.destroyRenderPass(target.renderPass);
+    device.destroyImageView(target.imageView);
+    device.destroyImage(target.image);
+    ctx->allocator().free(target.allocation);
+
+    target = {};
+}
+
+vk::Result readRenderTarget(Context* ctx, vk::CommandBuffer cmdBuf, RenderTarget& target,
+                            void* pDst)
+{
+    vk::Result res;
+
+    res = cmdBuf.reset();
+
+    if (res != vk::Result::eSuccess)
+    {
+        return res;
+    }
+
+    {
+        const vk::CommandBufferBeginInfo beginInfo = {
+            .flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit,
+        };
+
+        res = cmdBuf.begin(beginInfo);
+
+        if (res != vk::Result::eSuccess)
+        {
+            return res;
+        }
+    }
+
+    {
+        // The render pass' outgoing dependency already orders this after the color writes
+        const vk::BufferImageCopy region = {
+            .bufferOffset = 0,
+            .bufferRowLength = 0,
+            .bufferImageHeight = 0,
+            .imageSubresource = {
+                .aspectMask = vk::ImageAspectFlagBits::eColor,
+                .mipLevel = 0,
+                .baseArrayLayer = 0,
+                .layerCount = 1,
+            },
+            .imageOffset = {0, 0, 0},
+            .imageExtent = {
+                .width = target.extent.width,
+                .height = target.extent.height,
+                .depth = 1,
+            },
+        };
+
+        cmdBuf.copyImageToBuffer(target.image, vk::ImageLayout::eTransferSrcOptimal,
+                                 target.readback.buffer, 1, &region);
+    }
+
+    {
+        const vk::BufferMemoryBarrier barrier = {
+            .srcAccessMask = vk::AccessFlagBits::eTransferWrite,
+            .dstAccessMask = vk::AccessFlagBits::eHostRead,
+            .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .buffer = target.readback.buffer,
+            .offset = 0,
+            .size = VK_WHOLE_SIZE,
+        };
+
+        cmdBuf.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer,
+                               vk::PipelineStageFlagBits::eHost, {}, 0, nullptr, 1, &barrier, 0,
+                               nullptr);
+    }
+
+    {
+        res = cmdBuf.end();
+
+        if (res != vk::Result::eSuccess)
+        {
+            return res;
+        }
+    }
+
+    // Waits on a fence of its own rather than for the whole queue to drain. The fence signal
+    // still covers the rendering submitted before the copy.
+    vk::Fence fence;
+    {
+        const vk::FenceCreateInfo fenceInfo = {};
+
+        const auto [fenceRes, handle] = ctx->device().createFence(fenceInfo);
+
+        if (fenceRes != vk::Result::eSuccess)
+        {
+            return fenceRes;
+        }
+
+        fence = handle;
+    }
+
+    {
+        const vk::SubmitInfo submitInfo = {
+            .commandBufferCount = 1,
+            .pCommandBuffers = &cmdBuf,
+        };
+
+        res = ctx->graphicsQueue().submit(submitInfo, fence);
+
+        if (res == vk::Result::eSuccess)
+        {
+            res = ctx->device().waitForFences(fence, vk::True,
+                                              std::numeric_limits<uint64_t>::max());
+        }
+    }
+
+    ctx->device().destroyFence(fence);
+
+    if (res != vk::Result::eSuccess)
+    {
+        return res;
+    }
+
+    res = invalidateRange(ctx, target.readback, 0, VK_WHOLE_SIZE);
+
+    if (res != vk::Result::eSuccess)
+    {
+        return res;
+    }
+
+    std::memcpy(pDst, target.readback.pMapped, target.readback.size);
+
+    return vk::Result::eSuccess;
+}
+
+}  // namespace pyroc::backend::vulkan
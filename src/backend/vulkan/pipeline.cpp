@@ -0,0 +1,407 @@
+#include "backend/vulkan/pipeline.h"
+
+#include "backend/vulkan/context.h"
+#include "util/hash.h"
+
+#include <functional>
+
+namespace pyroc::backend::vulkan
+{
+
+namespace
+{
+class Hasher
+{
+  public:
+    template <typename T>
+    void add(const T& value)
+    {
+        mHash = util::hashBytes(&value, sizeof(value), mHash);
+    }
+
+    template <typename T>
+    void addHandle(const T& handle)
+    {
+        add(std::hash<T>{}(handle));
+    }
+
+    uint64_t result() const { return mHash; }
+
+  private:
+    uint64_t mHash = util::kFnvOffsetBasis;
+};
+
+// Feeds scalars through integers of fixed width, so the hash does not depend on enum sizes
+template <typename T>
+uint32_t toU32(T value)
+{
+    return static_cast<uint32_t>(value);
+}
+
+}  // namespace
+
+uint64_t hashPipelineDesc(const GraphicsPipelineDesc& desc)
+{
+    Hasher hasher;
+
+    hasher.addHandle(desc.vertexShader);
+    hasher.addHandle(desc.fragmentShader);
+
+    hasher.add(desc.vertexBindingCount);
+    for (uint32_t i = 0; i < desc.vertexBindingCount; ++i)
+    {
+        const VertexBinding& binding = desc.vertexBindings[i];
+        hasher.add(binding.binding);
+        hasher.add(binding.stride);
+        hasher.add(toU32(binding.inputRate));
+    }
+
+    hasher.add(desc.vertexAttributeCount);
+    for (uint32_t i = 0; i < desc.vertexAttributeCount; ++i)
+    {
+        const VertexAttribute& attribute = desc.vertexAttributes[i];
+        hasher.add(attribute.location);
+        hasher.add(attribute.binding);
+        hasher.add(toU32(attribute.format));
+        hasher.add(attribute.offset);
+    }
+
+    hasher.add(toU32(desc.topology));
+    hasher.add(toU32(desc.polygonMode));
+    hasher.add(toU32(static_cast<vk::CullModeFlags::MaskType>(desc.cullMode)));
+    hasher.add(toU32(desc.frontFace));
+    hasher.add(toU32(desc.samples));
+
+    hasher.add(toU32(desc.depthTest));
+    hasher.add(toU32(desc.depthWrite));
+    hasher.add(toU32(desc.depthCompareOp));
+
+    hasher.add(desc.colorAttachmentCount);
+    for (uint32_t i = 0; i < desc.colorAttachmentCount; ++i)
+    {
+        const BlendState& blend = desc.blend[i];
+        hasher.add(toU32(desc.colorFormats[i]));
+        hasher.add(toU32(blend.enable));
+        hasher.add(toU32(blend.srcColor));
+        hasher.add(toU32(blend.dstColor));
+        hasher.add(toU32(blend.colorOp));
+        hasher.add(toU32(blend.srcAlpha));
+        hasher.add(toU32(blend.dstAlpha));
+        hasher.add(toU32(blend.alphaOp));
+        hasher.add(toU32(static_cast<vk::ColorComponentFlags::MaskType>(blend.writeMask)));
+    }
+    hasher.add(toU32(desc.depthFormat));
+
+    hasher.addHandle(desc.layout);
+    hasher.addHandle(desc.renderPass);
+    hasher.add(desc.subpass);
+
+    return hasher.result();
+}
+
+vk::Result createGraphicsPipeline(Context* ctx, const GraphicsPipelineDesc& desc,
+                                  vk::Pipeline& pipeline)
+{
+    if (desc.vertexBindingCount > kMaxVertexBindings
+        || desc.vertexAttributeCount > kMaxVertexAttributes
+        || desc.colorAttachmentCount > kMaxColorAttachments)
+    {
+        return vk::Result::eErrorInitializationFailed;
+    }
+
+    if (!desc.renderPass && !ctx->capabilities().dynamicRendering)
+    {
+        return vk::Result::eErrorFeatureNotPresent;
+    }
+
+    const vk::PipelineShaderStageCreateInfo shaderStages[] = {
+        {
+            .stage = vk::ShaderStageFlagBits::eVertex,
+            .module = desc.vertexShader,
+            .pName = "main",
+        },
+        {
+            .stage = vk::ShaderStageFlagBits::eFragment,
+            .module = desc.fragmentShader,
+            .pName = "main",
+        },
+    };
+
+    const vk::DynamicState dynamicStates[] = {
+        vk::DynamicState::eViewport,
+        vk::DynamicState::eScissor,
+    };
+
+    const vk::PipelineDynamicStateCreateInfo dynamicStateInfo = {
+        .dynamicStateCount = static_cast<uint32_t>(std::size(dynamicStates)),
+        .pDynamicStates = dynamicStates,
+    };
+
+    vk::VertexInputBindingDescription bindings[kMaxVertexBindings];
+    for (uint32_t i = 0; i < desc.vertexBindingCount; ++i)
+    {
+        bindings[i] = {
+            .binding = desc.vertexBindings[i].binding,
+            .stride = desc.vertexBindings[i].stride,
+            .inputRate = desc.vertexBindings[i].inputRate,
+        };
+    }
+
+    vk::VertexInputAttributeDescription attributes[kMaxVertexAttributes];
+    for (uint32_t i = 0; i < desc.vertexAttributeCount; ++i)
+    {
+        attributes[i] = {
+            .location = desc.vertexAttributes[i].location,
+            .binding = desc.vertexAttributes[i].binding,
+            .format = desc.vertexAttributes[i].format,
+            .offset = desc.vertexAttributes[i].offset,
+        };
+    }
+
+    const vk::PipelineVertexInputStateCreateInfo vertexInputInfo = {
+        .vertexBindingDescriptionCount = desc.vertexBindingCount,
+        .pVertexBindingDescriptions = bindings,
+        .vertexAttributeDescriptionCount = desc.vertexAttributeCount,
+        .pVertexAttributeDescriptions = attributes,
+    };
+
+    const vk::PipelineInputAssemblyStateCreateInfo inputAssemblyInfo = {
+        .topology = desc.topology,
+        .primitiveRestartEnable = vk::False,
+    };
+
+    const vk::PipelineViewportStateCreateInfo viewportInfo = {
+        .viewportCount = 1,
+        .scissorCount = 1,
+    };
+
+    const vk::PipelineRasterizationStateCreateInfo rasterInfo = {
+        .depthClampEnable = vk::False,
+        .rasterizerDiscardEnable = vk::False,
+        .polygonMode = desc.polygonMode,
+        .cullMode = desc.cullMode,
+        .frontFace = desc.frontFace,
+        .depthBiasEnable = vk::False,
+        .lineWidth = 1.0f,
+    };
+
+    const vk::PipelineMultisampleStateCreateInfo msaaInfo = {
+        .rasterizationSamples = desc.samples,
+        .sampleShadingEnable = vk::False,
+    };
+
+    const vk::PipelineDepthStencilStateCreateInfo depthStencilInfo = {
+        .depthTestEnable = desc.depthTest ? vk::True : vk::False,
+        .depthWriteEnable = desc.depthWrite ? vk::True : vk::False,
+        .depthCompareOp = desc.depthCompareOp,
+        .depthBoundsTestEnable = vk::False,
+        .stencilTestEnable = vk::False,
+    };
+
+    vk::PipelineColorBlendAttachmentState blendAttachments[kMaxColorAttachments];
+    for (uint32_t i = 0; i < desc.colorAttachmentCount; ++i)
+    {
+        const BlendState& blend = desc.blend[i];
+        blendAttachments[i] = {
+            .blendEnable = blend.enable ? vk::True : vk::False,
+            .srcColorBlendFactor = blend.srcColor,
+            .dstColorBlendFactor = blend.dstColor,
+            .colorBlendOp = blend.colorOp,
+            .srcAlphaBlendFactor = blend.srcAlpha,
+            .dstAlphaBlendFactor = blend.dstAlpha,
+            .alphaBlendOp = blend.alphaOp,
+            .colorWriteMask = blend.writeMask,
+        };
+    }
+
+    const vk::PipelineColorBlendStateCreateInfo colorBlendInfo = {
+        .logicOpEnable = vk::False,
+        .attachmentCount = desc.colorAttachmentCount,
+        .pAttachments = blendAttachments,
+    };
+
+    const vk::PipelineRenderingCreateInfo renderingInfo = {
+        .colorAttachmentCount = desc.colorAttachmentCount,
+        .pColorAttachmentFormats = desc.colorFormats,
+        .depthAttachmentFormat = desc.depthFormat,
+    };
+
+    const vk::GraphicsPipelineCreateInfo pipelineInfo = {
+        .pNext = desc.renderPass ? nullptr : &renderingInfo,
+        .stageCount = static_cast<uint32_t>(std::size(shaderStages)),
+        .pStages = shaderStages,
+        .pVertexInputState = &vertexInputInfo,
+        .pInputAssemblyState = &inputAssemblyInfo,
+        .pViewportState = &viewportInfo,
+        .pRasterizationState = &rasterInfo,
+        .pMultisampleState = &msaaInfo,
+        .pDepthStencilState = &depthStencilInfo,
+        .pColorBlendState = &colorBlendInfo,
+        .pDynamicState = &dynamicStateInfo,
+        .layout = desc.layout,
+        .renderPass = desc.renderPass,
+        .subpass = desc.subpass,
+    };
+
+    const auto [res, handle] = ctx->device().createGraphicsPipeline(
+        ctx->pipelineCache().handle(), pipelineInfo);
+    if (res != vk::Result::eSuccess)
+    {
+        return res;
+    }
+
+    pipeline = handle;
+
+    return vk::Result::eSuccess;
+}
+
+vk::Result PipelineMap::init(Context* ctx, const PipelineMapCreateInfo* pCreateInfo)
+{
+    mCtx = ctx;
+    mStopping = false;
+
+    mWorkers.reserve(pCreateInfo->workerCount);
+    for (uint32_t i = 0; i < pCreateInfo->workerCount; ++i)
+    {
+        mWorkers.emplace_back(&PipelineMap::workerLoop, this);
+    }
+
+    return vk::Result::eSuccess;
+}
+
+void PipelineMap::destroy()
+{
+    {
+        std::lock_guard lock(mMutex);
+        mStopping = true;
+        mQueue.clear();
+    }
+    mQueueCondition.notify_all();
+
+    for (auto& worker : mWorkers)
+    {
+        worker.join();
+    }
+    mWorkers.clear();
+
+    for (auto& [desc, entry] : mPipelines)
+    {
+        mCtx->device().destroyPipeline(entry.pipeline);
+    }
+    mPipelines.clear();
+}
+
+vk::Result PipelineMap::get(const GraphicsPipelineDesc& desc, vk::Pipeline& pipeline)
+{
+    std::unique_lock lock(mMutex);
+
+    auto [it, inserted] = mPipelines.try_emplace(desc);
+    Entry& entry = it->second;
+
+    // A queued desc is compiled here rather than behind the rest of the queue
+    if (inserted || entry.state == State::eQueued)
+    {
+        compile(lock, it->first, entry);
+    }
+
+    mCompiledCondition.wait(lock, [&entry] { return entry.state != State::eCompiling; });
+
+    pipeline = entry.pipeline;
+
+    return entry.result;
+}
+
+vk::Result PipelineMap::request(const GraphicsPipelineDesc& desc, vk::Pipeline& pipeline)
+{
+    if (mWorkers.empty())
+    {
+        return get(desc, pipeline);
+    }
+
+    std::unique_lock lock(mMutex);
+
+    auto [it, inserted] = mPipelines.try_emplace(desc);
+
+    if (inserted)
+    {
+        mQueue.push_back(desc);
+        lock.unlock();
+        mQueueCondition.notify_one();
+        pipeline = nullptr;
+        return vk::Result::eNotReady;
+    }
+
+    const Entry& entry = it->second;
+    if (entry.state == State::eQueued || entry.state == State::eCompiling)
+    {
+        pipeline = nullptr;
+        return vk::Result::eNotReady;
+    }
+
+    pipeline = entry.pipeline;
+    return entry.result;
+}
+
+void PipelineMap::remove(const GraphicsPipelineDesc& desc)
+{
+    std::unique_lock lock(mMutex);
+
+    auto it = mPipelines.find(desc);
+    if (it == mPipelines.end())
+    {
+        return;
+    }
+
+    Entry& entry = it->second;
+    mCompiledCondition.wait(lock, [&entry] { return entry.state != State::eCompiling; });
+
+    // Workers skip queue items without an entry in the queued state
+    mCtx->device().destroyPipeline(entry.pipeline);
+    mPipelines.erase(it);
+}
+
+void PipelineMap::compile(std::unique_lock<std::mutex>& lock, const GraphicsPipelineDesc& desc,
+                          Entry& entry)
+{
+    entry.state = State::eCompiling;
+    lock.unlock();
+
+    vk::Pipeline pipeline;
+    const auto res = createGraphicsPipeline(mCtx, desc, pipeline);
+
+    lock.lock();
+    entry.pipeline = pipeline;
+    entry.result = res;
+    entry.state = res == vk::Result::eSuccess ? State::eReady : State::eFailed;
+
+    mCompiledCondition.notify_all();
+}
+
+void PipelineMap::workerLoop()
+{
+    std::unique_lock lock(mMutex);
+
+    for (;;)
+    {
+        mQueueCondition.wait(lock, [this] { return mStopping || !mQueue.empty(); });
+
+        if (mStopping)
+        {
+            return;
+        }
+
+        const GraphicsPipelineDesc desc = mQueue.front();
+        mQueue.pop_front();
+
+        // Taken over by get(), or removed while queued
+        auto it = mPipelines.find(desc);
+        if (it == mPipelines.end() || it->second.state != State::eQueued)
+        {
+            continue;
+        }
+
+        compile(lock, it->first, it->second);
+    }
+}
+
+}  // namespace pyroc::backend::vulkan
@@ -0,0 +1,256 @@
+#include "backend/vulkan/pipeline_cache.h"
+
+#include "backend/vulkan/context.h"
+#include "util/hash.h"
+#include "util/log.h"
+
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <vector>
+
+namespace pyroc::backend::vulkan
+{
+
+namespace
+{
+constexpr uint32_t kFileMagic = 0x43504350;  // "PCPC"
+constexpr uint32_t kFileVersion = 1;
+
+// Precedes the driver's data. The driver header does not carry the driver version.
+struct FileHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t vendorID;
+    uint32_t deviceID;
+    uint32_t driverVersion;
+    uint32_t reserved;
+    uint8_t pipelineCacheUUID[VK_UUID_SIZE];
+    uint64_t dataSize;
+    uint64_t dataHash;
+};
+
+// Layout of VkPipelineCacheHeaderVersionOne, at the start of the driver's data
+constexpr size_t kDriverHeaderSize = 16 + VK_UUID_SIZE;
+
+FileHeader makeHeader(const vk::PhysicalDeviceProperties& properties)
+{
+    FileHeader header = {
+        .magic = kFileMagic,
+        .version = kFileVersion,
+        .vendorID = properties.vendorID,
+        .deviceID = properties.deviceID,
+        .driverVersion = properties.driverVersion,
+        .reserved = 0,
+        .pipelineCacheUUID = {},
+        .dataSize = 0,
+        .dataHash = 0,
+    };
+    std::memcpy(header.pipelineCacheUUID, properties.pipelineCacheUUID.data(), VK_UUID_SIZE);
+    return header;
+}
+
+// Returns the driver data of the file at path, empty when missing or written for another device
+std::vector<uint8_t> readCacheFile(const std::string& path,
+                                   const vk::PhysicalDeviceProperties& properties)
+{
+    std::vector<uint8_t> data;
+    std::ifstream file(path, std::ios::ate | std::ios::binary);
+
+    if (!file.is_open())
+    {
+        return data;
+    }
+
+    const auto fileSize = static_cast<size_t>(file.tellg());
+    if (fileSize < sizeof(FileHeader) + kDriverHeaderSize)
+    {
+        LOG_DEBUG("Pipeline cache %s is truncated, discarding it", path.c_str());
+        return data;
+    }
+
+    const FileHeader expected = makeHeader(properties);
+
+    FileHeader header;
+    file.seekg(0);
+    file.read(reinterpret_cast<char*>(&header), sizeof(header));
+
+    if (header.magic != expected.magic || header.version != expected.version
+        || header.dataSize != fileSize - sizeof(FileHeader))
+    {
+        LOG_DEBUG("Pipeline cache %s is not a valid cache file, discarding it", path.c_str());
+        return data;
+    }
+
+    if (header.vendorID != expected.vendorID || header.deviceID != expected.deviceID
+        || header.driverVersion != expected.driverVersion
+        || std::memcmp(header.pipelineCacheUUID, expected.pipelineCacheUUID, VK_UUID_SIZE) != 0)
+    {
+        LOG_DEBUG("Pipeline cache %s was written by another device or driver, discarding it",
+                  path.c_str());
+        return data;
+    }
+
+    data.resize(header.dataSize);
+    file.read(reinterpret_cast<char*>(data.data()), static_cast<std::streamsize>(data.size()));
+
+    if (!file || util::hashBytes(data.data(), data.size()) != header.dataHash)
+    {
+        LOG_DEBUG("Pipeline cache %s is corrupt, discarding it", path.c_str());
+        data.clear();
+        return data;
+    }
+
+    // The driver validates its own header too, but some drivers have been known not to
+    uint32_t driverHeader[4];
+    std::memcpy(driverHeader, data.data(), sizeof(driverHeader));
+
+    if (driverHeader[0] < kDriverHeaderSize
+        || driverHeader[1] != static_cast<uint32_t>(vk::PipelineCacheHeaderVersion::eOne)
+        || driverHeader[2] != expected.vendorID || driverHeader[3] != expected.deviceID
+        || std::memcmp(data.data() + 16, expected.pipelineCacheUUID, VK_UUID_SIZE) != 0)
+    {
+        LOG_DEBUG("Pipeline cache %s has a mismatched driver header, discarding it",
+                  path.c_str());
+        data.clear();
+    }
+
+    return data;
+}
+
+bool writeCacheFile(const std::string& path, const FileHeader& header,
+                    const std::vector<uint8_t>& data)
+{
+    const std::string tmpPath = path + ".tmp";
+
+    {
+        std::ofstream file(tmpPath, std::ios::binary | std::ios::trunc);
+
+        if (!file.is_open())
+        {
+            return false;
+        }
+
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(reinterpret_cast<const char*>(data.data()),
+                   static_cast<std::streamsize>(data.size()));
+        file.flush();
+
+        if (!file)
+        {
+            file.close();
+            std::remove(tmpPath.c_str());
+            return false;
+        }
+    }
+
+    // Replaces the old file in one step, readers see either the old cache or the new one
+    std::error_code ec;
+    std::filesystem::rename(tmpPath, path, ec);
+
+    if (ec)
+    {
+        std::remove(tmpPath.c_str());
+        return false;
+    }
+
+    return true;
+}
+}  // namespace
+
+vk::Result PipelineCache::init(Context* ctx, const PipelineCacheCreateInfo* pCreateInfo)
+{
+    mCtx = ctx;
+    mPath = pCreateInfo->pPath ? pCreateInfo->pPath : "";
+
+    std::vector<uint8_t> initialData;
+    if (!mPath.empty())
+    {
+        initialData = readCacheFile(mPath, ctx->physicalDevice().getProperties());
+        LOG_DEBUG("Loaded %zu bytes of pipeline cache from %s", initialData.size(), mPath.c_str());
+    }
+
+    vk::PipelineCacheCreateInfo createInfo = {
+        .initialDataSize = initialData.size(),
+        .pInitialData = initialData.data(),
+    };
+
+    auto result = ctx->device().createPipelineCache(createInfo);
+
+    if (result.result != vk::Result::eSuccess && !initialData.empty())
+    {
+        // Start over empty rather than fail on data the driver rejected
+        createInfo.initialDataSize = 0;
+        createInfo.pInitialData = nullptr;
+        initialData.clear();
+
+        result = ctx->device().createPipelineCache(createInfo);
+    }
+
+    if (result.result != vk::Result::eSuccess)
+    {
+        return result.result;
+    }
+
+    mCache = result.value;
+    mSavedSize = initialData.size();
+    mSavedHash = util::hashBytes(initialData.data(), initialData.size());
+
+    return vk::Result::eSuccess;
+}
+
+void PipelineCache::destroy()
+{
+    if (!mCache)
+    {
+        return;
+    }
+
+    save();
+
+    mCtx->device().destroyPipelineCache(mCache);
+    mCache = nullptr;
+}
+
+vk::Result PipelineCache::save()
+{
+    if (mPath.empty())
+    {
+        return vk::Result::eSuccess;
+    }
+
+    const auto [res, data] = mCtx->device().getPipelineCacheData(mCache);
+
+    if (res != vk::Result::eSuccess)
+    {
+        return res;
+    }
+
+    const uint64_t hash = util::hashBytes(data.data(), data.size());
+
+    if (data.size() == mSavedSize && hash == mSavedHash)
+    {
+        return vk::Result::eSuccess;
+    }
+
+    FileHeader header = makeHeader(mCtx->physicalDevice().getProperties());
+    header.dataSize = data.size();
+    header.dataHash = hash;
+
+    if (!writeCacheFile(mPath, header, data))
+    {
+        LOG_DEBUG("Failed to write pipeline cache %s", mPath.c_str());
+        return vk::Result::eErrorInitializationFailed;
+    }
+
+    LOG_DEBUG("Saved %zu bytes of pipeline cache to %s", data.size(), mPath.c_str());
+
+    mSavedSize = data.size();
+    mSavedHash = hash;
+
+    return vk::Result::eSuccess;
+}
+
+}  // namespace pyroc::backend::vulkan
@@ -1,54 +1,352 @@
 #include "backend/vulkan/shader.h"
+#include "backend/vulkan/shader_reflection.h"
 
-#include <fstream>
+#include "util/hash.h"
+#include "util/log.h"
+#include "util/mapped_file.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
 
 namespace pyroc::backend::vulkan
 {
 namespace
 {
-std::vector<char> readFile(const std::string& filename)
+constexpr uint32_t kSpirvMagic = 0x07230203;
+
+// Magic, version, generator, bound and schema words
+constexpr size_t kSpirvHeaderSize = 5 * sizeof(uint32_t);
+
+uint64_t nanosecondsSince(std::chrono::steady_clock::time_point start)
 {
-    std::vector<char> data;
-    std::ifstream file(filename, std::ios::ate | std::ios::binary);
+    const auto elapsed = std::chrono::steady_clock::now() - start;
+    return static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+}
 
-    if (!file.is_open())
+vk::Result createModule(vk::Device device, const void* pCode, size_t size,
+                        vk::ShaderModule& module)
+{
+    if (!isValidSpirv(pCode, size))
     {
-        // Failed oops
-        return data;
+        return vk::Result::eErrorInitializationFailed;
     }
 
-    std::streamsize fileSize = static_cast<std::streamsize>(file.tellg());
-    data.resize(static_cast<uint32_t>(fileSize));
-    file.seekg(0);
-    file.read(data.data(), fileSize);
+    const vk::ShaderModuleCreateInfo createInfo = {
+        .codeSize = size,
+        .pCode = static_cast<const uint32_t*>(pCode),
+    };
 
-    file.close();
+    const auto [res, handle] = device.createShaderModule(createInfo);
+    if (res != vk::Result::eSuccess)
+    {
+        return res;
+    }
+
+    module = handle;
 
-    return data;
+    return vk::Result::eSuccess;
 }
 }  // namespace
 
 vk::ShaderModule createShaderFromFile(vk::Device device, const std::string& filename)
 {
-    const auto data = readFile(filename);
+    util::MappedFile file;
+    if (!file.open(filename.c_str()))
+    {
+        LOG_DEBUG("Failed to open shader %s", filename.c_str());
+        return nullptr;
+    }
 
-    return createShaderFromBytes(device, data);
+    vk::ShaderModule module;
+    if (createModule(device, file.data(), file.size(), module) != vk::Result::eSuccess)
+    {
+        LOG_DEBUG("Failed to create shader module from %s", filename.c_str());
+        return nullptr;
+    }
+
+    return module;
 }
 
 vk::ShaderModule createShaderFromBytes(vk::Device device, const std::vector<char>& data)
 {
-    const vk::ShaderModuleCreateInfo createInfo = {
-        .codeSize = data.size(),
-        .pCode = reinterpret_cast<const uint32_t*>(data.data()),
+    vk::ShaderModule module;
+    if (createModule(device, data.data(), data.size(), module) != vk::Result::eSuccess)
+    {
+        return nullptr;
+    }
+
+    return module;
+}
+
+bool isValidSpirv(const void* pCode, size_t size)
+{
+    if (!pCode || size < kSpirvHeaderSize || size % sizeof(uint32_t) != 0
+        || reinterpret_cast<uintptr_t>(pCode) % alignof(uint32_t) != 0)
+    {
+        return false;
+    }
+
+    uint32_t magic;
+    std::memcpy(&magic, pCode, sizeof(magic));
+
+    return magic == kSpirvMagic;
+}
+
+vk::Result ShaderArchive::open(const char* path)
+{
+    close();
+
+    if (!mFile.open(path))
+    {
+        LOG_DEBUG("Failed to open shader archive %s", path);
+        return vk::Result::eErrorInitializationFailed;
+    }
+
+    const auto* pBase = static_cast<const char*>(mFile.data());
+    const size_t size = mFile.size();
+
+    ShaderArchiveHeader header = {};
+    if (size >= sizeof(header))
+    {
+        std::memcpy(&header, pBase, sizeof(header));
+    }
+
+    const size_t entriesEnd
+        = sizeof(ShaderArchiveHeader) + size_t{header.entryCount} * sizeof(ShaderArchiveEntry);
+    const size_t stringsEnd = size_t{header.stringTableOffset} + header.stringTableSize;
+
+    if (header.magic != kShaderArchiveMagic || header.version != kShaderArchiveVersion
+        || entriesEnd > header.stringTableOffset || stringsEnd > size
+        || header.stringTableSize == 0 || pBase[stringsEnd - 1] != '\0')
+    {
+        LOG_DEBUG("%s is not a valid shader archive", path);
+        close();
+        return vk::Result::eErrorInitializationFailed;
+    }
+
+    mEntries = reinterpret_cast<const ShaderArchiveEntry*>(pBase + sizeof(ShaderArchiveHeader));
+    mEntryCount = header.entryCount;
+    mStrings = pBase + header.stringTableOffset;
+
+    for (uint32_t i = 0; i < mEntryCount; ++i)
+    {
+        const ShaderArchiveEntry& entry = mEntries[i];
+
+        const bool valid = entry.nameOffset < header.stringTableSize
+                           && entry.entryPointOffset < header.stringTableSize
+                           && size_t{entry.dataOffset} + entry.dataSize <= size
+                           && (i == 0 || mEntries[i - 1].nameHash <= entry.nameHash)
+                           && isValidSpirv(code(entry), entry.dataSize);
+
+        if (!valid)
+        {
+            LOG_DEBUG("Shader archive %s has a corrupt entry %u", path, i);
+            close();
+            return vk::Result::eErrorInitializationFailed;
+        }
+    }
+
+    LOG_DEBUG("Opened shader archive %s, %u shaders", path, mEntryCount);
+
+    return vk::Result::eSuccess;
+}
+
+void ShaderArchive::close()
+{
+    mFile.close();
+    mEntries = nullptr;
+    mEntryCount = 0;
+    mStrings = nullptr;
+}
+
+const ShaderArchiveEntry* ShaderArchive::find(std::string_view name) const
+{
+    const uint64_t hash = util::hashBytes(name.data(), name.size());
+
+    const ShaderArchiveEntry* pEnd = mEntries + mEntryCount;
+    const ShaderArchiveEntry* pEntry
+        = std::lower_bound(mEntries, pEnd, hash, [](const ShaderArchiveEntry& entry, uint64_t h)
+                           { return entry.nameHash < h; });
+
+    for (; pEntry != pEnd && pEntry->nameHash == hash; ++pEntry)
+    {
+        if (name == this->name(*pEntry))
+        {
+            return pEntry;
+        }
+    }
+
+    return nullptr;
+}
+
+void ShaderCache::init(vk::Device device)
+{
+    mDevice = device;
+    mStats = {};
+}
+
+void ShaderCache::destroy()
+{
+    for (auto& [key, cached] : mModules)
+    {
+        mDevice.destroyShaderModule(cached.module);
+    }
+
+    mModules.clear();
+    mPaths.clear();
+}
+
+void ShaderCache::release(vk::ShaderModule module)
+{
+    if (!module)
+    {
+        return;
+    }
+
+    const size_t erased = std::erase_if(mModules, [module](const auto& pair)
+                                        { return pair.second.module == module; });
+    std::erase_if(mPaths, [module](const auto& pair) { return pair.second == module; });
+
+    if (erased > 0)
+    {
+        mDevice.destroyShaderModule(module);
+    }
+}
+
+vk::Result ShaderCache::load(const char* path, vk::ShaderModule& module)
+{
+    {
+        const auto it = mPaths.find(path);
+        if (it != mPaths.end())
+        {
+            ++mStats.cacheHits;
+            module = it->second;
+            return vk::Result::eSuccess;
+        }
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+
+    util::MappedFile file;
+    if (!file.open(path))
+    {
+        LOG_DEBUG("Failed to open shader %s", path);
+        return vk::Result::eErrorInitializationFailed;
+    }
+
+    const uint64_t createNanoseconds = mStats.createNanoseconds;
+
+    const auto res = create(file.data(), file.size(), module);
+    if (res != vk::Result::eSuccess)
+    {
+        LOG_DEBUG("Failed to load shader %s: %s", path, vk::to_string(res).c_str());
+        return res;
+    }
+
+    mPaths.emplace(path, module);
+
+    const uint64_t elapsed = nanosecondsSince(start);
+    ++mStats.filesLoaded;
+    mStats.bytesLoaded += file.size();
+    mStats.loadNanoseconds += elapsed - (mStats.createNanoseconds - createNanoseconds);
+
+    LOG_DEBUG("Loaded shader %s (%zu bytes) in %.3f ms", path, file.size(),
+              static_cast<double>(elapsed) / 1e6);
+
+    return vk::Result::eSuccess;
+}
+
+vk::Result ShaderCache::load(const ShaderArchive& archive, std::string_view name,
+                             vk::ShaderModule& module, ShaderReflection* pReflection)
+{
+    const ShaderArchiveEntry* pEntry = archive.find(name);
+    if (!pEntry)
+    {
+        LOG_DEBUG("Shader archive has no shader %.*s", static_cast<int>(name.size()),
+                  name.data());
+        return vk::Result::eErrorInitializationFailed;
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+    const uint64_t createNanoseconds = mStats.createNanoseconds;
+
+    // Validated when the archive was opened
+    const auto res = create(archive.code(*pEntry), pEntry->dataSize, pEntry->contentHash, module);
+    if (res != vk::Result::eSuccess)
+    {
+        LOG_DEBUG("Failed to load shader %s: %s", archive.name(*pEntry),
+                  vk::to_string(res).c_str());
+        return res;
+    }
+
+    const uint64_t elapsed = nanosecondsSince(start);
+    ++mStats.filesLoaded;
+    mStats.bytesLoaded += pEntry->dataSize;
+    mStats.loadNanoseconds += elapsed - (mStats.createNanoseconds - createNanoseconds);
+
+    LOG_DEBUG("Loaded shader %s (%u bytes) from archive in %.3f ms", archive.name(*pEntry),
+              pEntry->dataSize, static_cast<double>(elapsed) / 1e6);
+
+    if (pReflection)
+    {
+        return reflectShader(archive.code(*pEntry), pEntry->dataSize, *pReflection);
+    }
+
+    return vk::Result::eSuccess;
+}
+
+vk::Result ShaderCache::create(const void* pCode, size_t size, vk::ShaderModule& module)
+{
+    if (!isValidSpirv(pCode, size))
+    {
+        return vk::Result::eErrorInitializationFailed;
+    }
+
+    return create(pCode, size, util::hashBytes(pCode, size), module);
+}
+
+vk::Result ShaderCache::create(const void* pCode, size_t size, uint64_t hash,
+                               vk::ShaderModule& module)
+{
+    const ContentKey key = {
+        .hash = hash,
+        .size = size,
     };
 
-    const auto [res, shaderModule] = device.createShaderModule(createInfo);
+    // The hash only narrows the search, a module is shared only by byte identical code
+    {
+        const auto [begin, end] = mModules.equal_range(key);
+        for (auto it = begin; it != end; ++it)
+        {
+            if (std::memcmp(it->second.code.data(), pCode, size) == 0)
+            {
+                ++mStats.cacheHits;
+                module = it->second.module;
+                return vk::Result::eSuccess;
+            }
+        }
+    }
+
+    const auto start = std::chrono::steady_clock::now();
 
+    const auto res = createModule(mDevice, pCode, size, module);
     if (res != vk::Result::eSuccess)
     {
-        return nullptr;
+        return res;
     }
 
-    return shaderModule;
+    mStats.createNanoseconds += nanosecondsSince(start);
+    ++mStats.modulesCreated;
+
+    const auto* pWords = static_cast<const uint32_t*>(pCode);
+    mModules.emplace(key, CachedModule{
+                              .module = module,
+                              .code = std::vector<uint32_t>(pWords, pWords + size / 4),
+                          });
+
+    return vk::Result::eSuccess;
 }
-}  // namespace pyroc::backend::vulkan
\ No newline at end of file
+
+}  // namespace pyroc::backend::vulkan
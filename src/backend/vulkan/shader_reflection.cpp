@@ -0,0 +1,852 @@
+#include "backend/vulkan/shader_reflection.h"
+
+#include "backend/vulkan/context.h"
+#include "backend/vulkan/pipeline.h"
+#include "backend/vulkan/shader.h"
+#include "util/hash.h"
+#include "util/log.h"
+
+#include <algorithm>
+#include <functional>
+
+namespace pyroc::backend::vulkan
+{
+
+namespace
+{
+// The subset of the SPIR-V grammar reflection needs
+namespace spv
+{
+constexpr uint32_t kOpEntryPoint = 15;
+constexpr uint32_t kOpTypeBool = 20;
+constexpr uint32_t kOpTypeInt = 21;
+constexpr uint32_t kOpTypeFloat = 22;
+constexpr uint32_t kOpTypeVector = 23;
+constexpr uint32_t kOpTypeMatrix = 24;
+constexpr uint32_t kOpTypeImage = 25;
+constexpr uint32_t kOpTypeSampler = 26;
+constexpr uint32_t kOpTypeSampledImage = 27;
+constexpr uint32_t kOpTypeArray = 28;
+constexpr uint32_t kOpTypeRuntimeArray = 29;
+constexpr uint32_t kOpTypeStruct = 30;
+constexpr uint32_t kOpTypePointer = 32;
+constexpr uint32_t kOpConstant = 43;
+constexpr uint32_t kOpVariable = 59;
+constexpr uint32_t kOpDecorate = 71;
+constexpr uint32_t kOpMemberDecorate = 72;
+constexpr uint32_t kOpTypeAccelerationStructure = 5341;
+
+constexpr uint32_t kDecorationBlock = 2;
+constexpr uint32_t kDecorationArrayStride = 6;
+constexpr uint32_t kDecorationMatrixStride = 7;
+constexpr uint32_t kDecorationBuiltIn = 11;
+constexpr uint32_t kDecorationLocation = 30;
+constexpr uint32_t kDecorationBinding = 33;
+constexpr uint32_t kDecorationDescriptorSet = 34;
+constexpr uint32_t kDecorationOffset = 35;
+
+constexpr uint32_t kStorageUniformConstant = 0;
+constexpr uint32_t kStorageInput = 1;
+constexpr uint32_t kStorageUniform = 2;
+constexpr uint32_t kStoragePushConstant = 9;
+constexpr uint32_t kStorageStorageBuffer = 12;
+
+constexpr uint32_t kDimBuffer = 5;
+constexpr uint32_t kDimSubpassData = 6;
+}  // namespace spv
+
+constexpr uint32_t kNone = ~0u;
+
+// Guards recursive type walks against malformed binaries
+constexpr uint32_t kMaxTypeDepth = 32;
+
+struct IdInfo
+{
+    // Defining instruction
+    uint32_t opcode = 0;
+    uint32_t offset = 0;
+    uint32_t wordCount = 0;
+
+    uint32_t set = kNone;
+    uint32_t binding = kNone;
+    uint32_t location = kNone;
+    uint32_t arrayStride = 0;
+    bool builtIn = false;
+    bool block = false;
+};
+
+struct MemberInfo
+{
+    uint32_t offset = 0;
+    uint32_t matrixStride = 0;
+};
+
+class Parser
+{
+  public:
+    Parser(const uint32_t* pWords, size_t wordCount) : mWords(pWords), mWordCount(wordCount) {}
+
+    vk::Result parse(ShaderReflection& reflection);
+
+  private:
+    uint32_t word(const IdInfo& info, uint32_t index) const
+    {
+        return index < info.wordCount ? mWords[info.offset + index] : 0;
+    }
+
+    const IdInfo& id(uint32_t index) const
+    {
+        static const IdInfo kUndefined;
+        return index < mIds.size() ? mIds[index] : kUndefined;
+    }
+
+    MemberInfo member(uint32_t structId, uint32_t index) const
+    {
+        const auto it = mMembers.find(structId);
+        if (it == mMembers.end() || index >= it->second.size())
+        {
+            return {};
+        }
+        return it->second[index];
+    }
+
+    uint32_t typeSize(uint32_t typeId, uint32_t matrixStride, uint32_t depth) const;
+    vk::Format vertexFormat(uint32_t typeId, uint32_t& size) const;
+    vk::Result addDescriptor(const IdInfo& variable, uint32_t typeId, uint32_t storage,
+                             ShaderReflection& reflection) const;
+
+    const uint32_t* mWords;
+    size_t mWordCount;
+
+    std::vector<IdInfo> mIds;
+    std::unordered_map<uint32_t, std::vector<MemberInfo>> mMembers;
+};
+
+vk::Result Parser::parse(ShaderReflection& reflection)
+{
+    constexpr size_t kHeaderWords = 5;
+
+    // Ids are dense, a bound far beyond the word count is corrupt
+    const uint32_t bound = mWords[3];
+    if (bound > mWordCount)
+    {
+        return vk::Result::eErrorInitializationFailed;
+    }
+
+    mIds.resize(bound);
+
+    uint32_t executionModel = kNone;
+    std::vector<uint32_t> variables;
+
+    for (size_t i = kHeaderWords; i < mWordCount;)
+    {
+        const uint32_t wordCount = mWords[i] >> 16;
+        const uint32_t opcode = mWords[i] & 0xffff;
+
+        if (wordCount == 0 || i + wordCount > mWordCount)
+        {
+            return vk::Result::eErrorInitializationFailed;
+        }
+
+        const uint32_t* pOperands = mWords + i + 1;
+
+        // Result id position of the instructions recorded, zero for those that are not
+        uint32_t resultIndex = 0;
+
+        switch (opcode)
+        {
+            case spv::kOpEntryPoint:
+                if (executionModel == kNone && wordCount > 2)
+                {
+                    executionModel = pOperands[0];
+                }
+                break;
+
+            case spv::kOpTypeBool:
+            case spv::kOpTypeInt:
+            case spv::kOpTypeFloat:
+            case spv::kOpTypeVector:
+            case spv::kOpTypeMatrix:
+            case spv::kOpTypeImage:
+            case spv::kOpTypeSampler:
+            case spv::kOpTypeSampledImage:
+            case spv::kOpTypeArray:
+            case spv::kOpTypeRuntimeArray:
+            case spv::kOpTypeStruct:
+            case spv::kOpTypePointer:
+            case spv::kOpTypeAccelerationStructure:
+                resultIndex = 1;
+                break;
+
+            case spv::kOpConstant:
+                resultIndex = 2;
+                break;
+
+            case spv::kOpVariable:
+                resultIndex = 2;
+                if (wordCount > 3)
+                {
+                    variables.push_back(pOperands[1]);
+                }
+                break;
+
+            case spv::kOpDecorate:
+                if (wordCount > 2 && pOperands[0] < bound)
+                {
+                    IdInfo& target = mIds[pOperands[0]];
+                    const uint32_t literal = wordCount > 3 ? pOperands[2] : 0;
+
+                    switch (pOperands[1])
+                    {
+                        case spv::kDecorationBlock: target.block = true; break;
+                        case spv::kDecorationArrayStride: target.arrayStride = literal; break;
+                        case spv::kDecorationBuiltIn: target.builtIn = true; break;
+                        case spv::kDecorationLocation: target.location = literal; break;
+                        case spv::kDecorationBinding: target.binding = literal; break;
+                        case spv::kDecorationDescriptorSet: target.set = literal; break;
+                        default: break;
+                    }
+                }
+                break;
+
+            case spv::kOpMemberDecorate:
+                if (wordCount > 4)
+                {
+                    std::vector<MemberInfo>& members = mMembers[pOperands[0]];
+                    const uint32_t index = pOperands[1];
+
+                    // Member indices are bounded by the instruction size of OpTypeStruct
+                    if (index >= mWordCount)
+                    {
+                        return vk::Result::eErrorInitializationFailed;
+                    }
+                    if (index >= members.size())
+                    {
+                        members.resize(index + 1);
+                    }
+
+                    if (pOperands[2] == spv::kDecorationOffset)
+                    {
+                        members[index].offset = pOperands[3];
+                    }
+                    else if (pOperands[2] == spv::kDecorationMatrixStride)
+                    {
+                        members[index].matrixStride = pOperands[3];
+                    }
+                }
+                break;
+
+            default:
+                break;
+        }
+
+        if (resultIndex != 0 && wordCount > resultIndex)
+        {
+            const uint32_t resultId = mWords[i + resultIndex];
+            if (resultId >= bound)
+            {
+                return vk::Result::eErrorInitializationFailed;
+            }
+
+            IdInfo& info = mIds[resultId];
+            info.opcode = opcode;
+            info.offset = static_cast<uint32_t>(i);
+            info.wordCount = wordCount;
+        }
+
+        i += wordCount;
+    }
+
+    switch (executionModel)
+    {
+        case 0: reflection.stage = vk::ShaderStageFlagBits::eVertex; break;
+        case 1: reflection.stage = vk::ShaderStageFlagBits::eTessellationControl; break;
+        case 2: reflection.stage = vk::ShaderStageFlagBits::eTessellationEvaluation; break;
+        case 3: reflection.stage = vk::ShaderStageFlagBits::eGeometry; break;
+        case 4: reflection.stage = vk::ShaderStageFlagBits::eFragment; break;
+        case 5: reflection.stage = vk::ShaderStageFlagBits::eCompute; break;
+        default: return vk::Result::eErrorFeatureNotPresent;
+    }
+
+    for (const uint32_t variableId : variables)
+    {
+        const IdInfo& variable = id(variableId);
+        const IdInfo& pointer = id(word(variable, 1));
+        const uint32_t storage = word(variable, 3);
+
+        if (pointer.opcode != spv::kOpTypePointer)
+        {
+            return vk::Result::eErrorInitializationFailed;
+        }
+
+        const uint32_t typeId = word(pointer, 3);
+
+        switch (storage)
+        {
+            case spv::kStorageInput:
+            {
+                if (reflection.stage != vk::ShaderStageFlagBits::eVertex || variable.builtIn
+                    || variable.location == kNone)
+                {
+                    break;
+                }
+
+                // Matrices take one location per column
+                const IdInfo& type = id(typeId);
+                const bool matrix = type.opcode == spv::kOpTypeMatrix;
+                const uint32_t columns = matrix ? word(type, 3) : 1;
+                uint32_t size = 0;
+                const vk::Format format = vertexFormat(matrix ? word(type, 2) : typeId, size);
+
+                for (uint32_t column = 0; column < columns && column < kMaxVertexAttributes;
+                     ++column)
+                {
+                    reflection.vertexInputs.push_back({
+                        .location = variable.location + column,
+                        .format = format,
+                        .size = size,
+                    });
+                }
+                break;
+            }
+
+            case spv::kStoragePushConstant:
+            {
+                const IdInfo& type = id(typeId);
+                if (type.opcode != spv::kOpTypeStruct)
+                {
+                    return vk::Result::eErrorInitializationFailed;
+                }
+
+                uint32_t begin = kNone;
+                for (uint32_t m = 0; m + 2 < type.wordCount; ++m)
+                {
+                    begin = std::min(begin, member(typeId, m).offset);
+                }
+
+                const uint32_t end = typeSize(typeId, 0, 0);
+                if (begin == kNone || end < begin)
+                {
+                    begin = 0;
+                }
+
+                reflection.pushConstantOffset = begin;
+                reflection.pushConstantSize = end - begin;
+                break;
+            }
+
+            case spv::kStorageUniformConstant:
+            case spv::kStorageUniform:
+            case spv::kStorageStorageBuffer:
+            {
+                const auto res = addDescriptor(variable, typeId, storage, reflection);
+                if (res != vk::Result::eSuccess)
+                {
+                    return res;
+                }
+                break;
+            }
+
+            default:
+                break;
+        }
+    }
+
+    std::sort(reflection.bindings.begin(), reflection.bindings.end(),
+              [](const DescriptorBinding& a, const DescriptorBinding& b)
+              { return a.set != b.set ? a.set < b.set : a.binding < b.binding; });
+
+    std::sort(reflection.vertexInputs.begin(), reflection.vertexInputs.end(),
+              [](const VertexInput& a, const VertexInput& b) { return a.location < b.location; });
+
+    return vk::Result::eSuccess;
+}
+
+uint32_t Parser::typeSize(uint32_t typeId, uint32_t matrixStride, uint32_t depth) const
+{
+    if (depth > kMaxTypeDepth)
+    {
+        return 0;
+    }
+
+    const IdInfo& type = id(typeId);
+
+    switch (type.opcode)
+    {
+        case spv::kOpTypeBool:
+            return 4;
+
+        case spv::kOpTypeInt:
+        case spv::kOpTypeFloat:
+            return word(type, 2) / 8;
+
+        case spv::kOpTypeVector:
+            return word(type, 3) * typeSize(word(type, 2), 0, depth + 1);
+
+        case spv::kOpTypeMatrix:
+        {
+            const uint32_t columnSize
+                = matrixStride != 0 ? matrixStride : typeSize(word(type, 2), 0, depth + 1);
+            return word(type, 3) * columnSize;
+        }
+
+        case spv::kOpTypeArray:
+        {
+            const IdInfo& length = id(word(type, 3));
+            const uint32_t stride = type.arrayStride != 0
+                                        ? type.arrayStride
+                                        : typeSize(word(type, 2), matrixStride, depth + 1);
+            return length.opcode == spv::kOpConstant ? word(length, 3) * stride : 0;
+        }
+
+        case spv::kOpTypeStruct:
+        {
+            uint32_t size = 0;
+            for (uint32_t m = 0; m + 2 < type.wordCount; ++m)
+            {
+                const MemberInfo info = member(typeId, m);
+                size = std::max(size, info.offset
+                                          + typeSize(word(type, m + 2), info.matrixStride,
+                                                     depth + 1));
+            }
+            return size;
+        }
+
+        // Physical storage buffer addresses
+        case spv::kOpTypePointer:
+            return 8;
+
+        default:
+            return 0;
+    }
+}
+
+vk::Format Parser::vertexFormat(uint32_t typeId, uint32_t& size) const
+{
+    size = 0;
+
+    const IdInfo* pType = &id(typeId);
+
+    uint32_t components = 1;
+    if (pType->opcode == spv::kOpTypeVector)
+    {
+        components = word(*pType, 3);
+        pType = &id(word(*pType, 2));
+    }
+
+    if (word(*pType, 2) != 32 || components < 1 || components > 4)
+    {
+        return vk::Format::eUndefined;
+    }
+
+    size = components * sizeof(uint32_t);
+
+    constexpr vk::Format kFloatFormats[] = {
+        vk::Format::eR32Sfloat,
+        vk::Format::eR32G32Sfloat,
+        vk::Format::eR32G32B32Sfloat,
+        vk::Format::eR32G32B32A32Sfloat,
+    };
+    constexpr vk::Format kSintFormats[] = {
+        vk::Format::eR32Sint,
+        vk::Format::eR32G32Sint,
+        vk::Format::eR32G32B32Sint,
+        vk::Format::eR32G32B32A32Sint,
+    };
+    constexpr vk::Format kUintFormats[] = {
+        vk::Format::eR32Uint,
+        vk::Format::eR32G32Uint,
+        vk::Format::eR32G32B32Uint,
+        vk::Format::eR32G32B32A32Uint,
+    };
+
+    switch (pType->opcode)
+    {
+        case spv::kOpTypeFloat: return kFloatFormats[components - 1];
+        case spv::kOpTypeInt:
+            return word(*pType, 3) != 0 ? kSintFormats[components - 1]
+                                        : kUintFormats[components - 1];
+        default: return vk::Format::eUndefined;
+    }
+}
+
+vk::Result Parser::addDescriptor(const IdInfo& variable, uint32_t typeId, uint32_t storage,
+                                 ShaderReflection& reflection) const
+{
+    if (variable.binding == kNone)
+    {
+        return vk::Result::eSuccess;
+    }
+
+    DescriptorBinding binding = {
+        .set = variable.set == kNone ? 0 : variable.set,
+        .binding = variable.binding,
+        .type = vk::DescriptorType::eUniformBuffer,
+        .count = 1,
+        .stages = reflection.stage,
+    };
+
+    const IdInfo* pType = &id(typeId);
+
+    for (uint32_t depth = 0; depth < kMaxTypeDepth; ++depth)
+    {
+        if (pType->opcode == spv::kOpTypeArray)
+        {
+            const IdInfo& length = id(word(*pType, 3));
+            binding.count *= length.opcode == spv::kOpConstant ? word(length, 3) : 1;
+        }
+        else if (pType->opcode == spv::kOpTypeRuntimeArray)
+        {
+            binding.count = 0;
+        }
+        else
+        {
+            break;
+        }
+
+        pType = &id(word(*pType, 2));
+    }
+
+    switch (pType->opcode)
+    {
+        // Uniform storage blocks decorated BufferBlock are pre 1.3 storage buffers
+        case spv::kOpTypeStruct:
+            binding.type = storage == spv::kStorageUniform && pType->block
+                               ? vk::DescriptorType::eUniformBuffer
+                               : vk::DescriptorType::eStorageBuffer;
+            break;
+
+        case spv::kOpTypeSampler:
+            binding.type = vk::DescriptorType::eSampler;
+            break;
+
+        case spv::kOpTypeSampledImage:
+            binding.type = vk::DescriptorType::eCombinedImageSampler;
+            break;
+
+        case spv::kOpTypeImage:
+        {
+            const uint32_t dim = word(*pType, 3);
+            const bool storageImage = word(*pType, 7) == 2;
+
+            if (dim == spv::kDimBuffer)
+            {
+                binding.type = storageImage ? vk::DescriptorType::eStorageTexelBuffer
+                                            : vk::DescriptorType::eUniformTexelBuffer;
+            }
+            else if (dim == spv::kDimSubpassData)
+            {
+                binding.type = vk::DescriptorType::eInputAttachment;
+            }
+            else
+            {
+                binding.type = storageImage ? vk::DescriptorType::eStorageImage
+                                            : vk::DescriptorType::eSampledImage;
+            }
+            break;
+        }
+
+        case spv::kOpTypeAccelerationStructure:
+            binding.type = vk::DescriptorType::eAccelerationStructureKHR;
+            break;
+
+        default:
+            return vk::Result::eErrorInitializationFailed;
+    }
+
+    reflection.bindings.push_back(binding);
+
+    return vk::Result::eSuccess;
+}
+}  // namespace
+
+vk::Result reflectShader(const void* pCode, size_t size, ShaderReflection& reflection)
+{
+    reflection = {};
+
+    if (!isValidSpirv(pCode, size))
+    {
+        return vk::Result::eErrorInitializationFailed;
+    }
+
+    Parser parser(static_cast<const uint32_t*>(pCode), size / sizeof(uint32_t));
+
+    return parser.parse(reflection);
+}
+
+vk::Result setVertexInputs(const ShaderReflection& vertexShader, uint32_t binding,
+                           GraphicsPipelineDesc& desc)
+{
+    desc.vertexAttributeCount = 0;
+
+    uint32_t offset = 0;
+    for (const VertexInput& input : vertexShader.vertexInputs)
+    {
+        if (input.format == vk::Format::eUndefined)
+        {
+            LOG_DEBUG("Vertex input at location %u has no vertex format", input.location);
+            return vk::Result::eErrorFormatNotSupported;
+        }
+
+        if (desc.vertexAttributeCount == kMaxVertexAttributes)
+        {
+            LOG_DEBUG("More than %u vertex inputs", kMaxVertexAttributes);
+            return vk::Result::eErrorInitializationFailed;
+        }
+
+        desc.vertexAttributes[desc.vertexAttributeCount++] = {
+            .location = input.location,
+            .binding = binding,
+            .format = input.format,
+            .offset = offset,
+        };
+
+        offset += input.size;
+    }
+
+    desc.vertexBindingCount = desc.vertexAttributeCount > 0 ? 1 : 0;
+    desc.vertexBindings[0] = {
+        .binding = binding,
+        .stride = offset,
+        .inputRate = vk::VertexInputRate::eVertex,
+    };
+
+    return vk::Result::eSuccess;
+}
+
+size_t PipelineLayoutCache::KeyHash::operator()(const SetKey& key) const
+{
+    uint64_t hash = util::kFnvOffsetBasis;
+    for (const DescriptorBinding& binding : key.bindings)
+    {
+        const uint32_t fields[] = {
+            binding.set,
+            binding.binding,
+            static_cast<uint32_t>(binding.type),
+            binding.count,
+            static_cast<uint32_t>(binding.stages),
+        };
+        hash = util::hashBytes(fields, sizeof(fields), hash);
+    }
+    return hash;
+}
+
+size_t PipelineLayoutCache::KeyHash::operator()(const LayoutKey& key) const
+{
+    uint64_t hash = util::kFnvOffsetBasis;
+    for (uint32_t i = 0; i < key.setCount; ++i)
+    {
+        const size_t setLayout = std::hash<vk::DescriptorSetLayout>{}(key.setLayouts[i]);
+        hash = util::hashBytes(&setLayout, sizeof(setLayout), hash);
+    }
+
+    const uint32_t fields[] = {
+        key.setCount,
+        static_cast<uint32_t>(key.pushConstantStages),
+        key.pushConstantSize,
+    };
+    return util::hashBytes(fields, sizeof(fields), hash);
+}
+
+void PipelineLayoutCache::init(Context* ctx) { mCtx = ctx; }
+
+void PipelineLayoutCache::destroy()
+{
+    vk::Device device = mCtx->device();
+
+    for (auto& [key, layout] : mLayouts)
+    {
+        device.destroyPipelineLayout(layout.layout);
+    }
+
+    for (auto& [key, setLayout] : mSetLayouts)
+    {
+        device.destroyDescriptorSetLayout(setLayout);
+    }
+
+    mLayouts.clear();
+    mSetLayouts.clear();
+}
+
+vk::Result PipelineLayoutCache::get(std::span<const ShaderReflection* const> stages,
+                                    ReflectedLayout& layout)
+{
+    LayoutKey key;
+    std::vector<DescriptorBinding> bindings;
+
+    for (const ShaderReflection* pStage : stages)
+    {
+        for (const DescriptorBinding& binding : pStage->bindings)
+        {
+            if (binding.set >= kMaxDescriptorSets)
+            {
+                return vk::Result::eErrorInitializationFailed;
+            }
+
+            auto it = std::find_if(bindings.begin(), bindings.end(),
+                                   [&binding](const DescriptorBinding& other) {
+                                       return other.set == binding.set
+                                              && other.binding == binding.binding;
+                                   });
+
+            if (it == bindings.end())
+            {
+                bindings.push_back(binding);
+                continue;
+            }
+
+            // Stages sharing a binding must agree on what it is
+            if (it->type != binding.type || it->count != binding.count)
+            {
+                return vk::Result::eErrorInitializationFailed;
+            }
+
+            it->stages |= binding.stages;
+        }
+
+        if (pStage->pushConstantSize > 0)
+        {
+            key.pushConstantStages |= pStage->stage;
+            key.pushConstantSize = std::max(key.pushConstantSize,
+                                            pStage->pushConstantOffset + pStage->pushConstantSize);
+        }
+    }
+
+    std::sort(bindings.begin(), bindings.end(),
+              [](const DescriptorBinding& a, const DescriptorBinding& b)
+              { return a.set != b.set ? a.set < b.set : a.binding < b.binding; });
+
+    key.setCount = bindings.empty() ? 0 : bindings.back().set + 1;
+
+    // Sets below the highest one used get a layout too, empty when the shaders skip them
+    auto first = bindings.begin();
+    for (uint32_t set = 0; set < key.setCount; ++set)
+    {
+        const auto last = std::find_if(first, bindings.end(), [set](const DescriptorBinding& b)
+                                       { return b.set != set; });
+
+        const auto res = getSetLayout({first, last}, key.setLayouts[set]);
+        if (res != vk::Result::eSuccess)
+        {
+            return res;
+        }
+
+        first = last;
+    }
+
+    {
+        const auto it = mLayouts.find(key);
+        if (it != mLayouts.end())
+        {
+            layout = it->second;
+            return vk::Result::eSuccess;
+        }
+    }
+
+    // One range covering every stage, so pushes from any of them use the same stage flags
+    const vk::PushConstantRange pushConstantRange = {
+        .stageFlags = key.pushConstantStages,
+        .offset = 0,
+        .size = key.pushConstantSize,
+    };
+
+    const vk::PipelineLayoutCreateInfo layoutInfo = {
+        .setLayoutCount = key.setCount,
+        .pSetLayouts = key.setLayouts,
+        .pushConstantRangeCount = key.pushConstantSize > 0 ? 1u : 0u,
+        .pPushConstantRanges = &pushConstantRange,
+    };
+
+    const auto [res, handle] = mCtx->device().createPipelineLayout(layoutInfo);
+    if (res != vk::Result::eSuccess)
+    {
+        return res;
+    }
+
+    layout = {
+        .layout = handle,
+        .setCount = key.setCount,
+        .setLayouts = {},
+        .pushConstantStages = key.pushConstantStages,
+    };
+    std::copy_n(key.setLayouts, key.setCount, layout.setLayouts);
+
+    mLayouts.emplace(key, layout);
+
+    return vk::Result::eSuccess;
+}
+
+vk::Result PipelineLayoutCache::getSetLayout(std::span<const DescriptorBinding> bindings,
+                                             vk::DescriptorSetLayout& setLayout)
+{
+    SetKey key = {
+        .bindings = {bindings.begin(), bindings.end()},
+    };
+
+    {
+        const auto it = mSetLayouts.find(key);
+        if (it != mSetLayouts.end())
+        {
+            setLayout = it->second;
+            return vk::Result::eSuccess;
+        }
+    }
+
+    std::vector<vk::DescriptorSetLayoutBinding> layoutBindings;
+    std::vector<vk::DescriptorBindingFlags> bindingFlags;
+    layoutBindings.reserve(bindings.size());
+    bindingFlags.reserve(bindings.size());
+
+    bool variableCount = false;
+
+    for (const DescriptorBinding& binding : bindings)
+    {
+        vk::DescriptorBindingFlags flags;
+
+        if (binding.count == 0)
+        {
+            // Only the last binding of a set may have a variable count
+            if (!mCtx->capabilities().descriptorIndexing || &binding != &bindings.back())
+            {
+                return vk::Result::eErrorFeatureNotPresent;
+            }
+
+            flags = vk::DescriptorBindingFlagBits::ePartiallyBound
+                    | vk::DescriptorBindingFlagBits::eVariableDescriptorCount;
+            variableCount = true;
+        }
+
+        layoutBindings.push_back({
+            .binding = binding.binding,
+            .descriptorType = binding.type,
+            .descriptorCount = binding.count == 0 ? kMaxRuntimeArrayDescriptors : binding.count,
+            .stageFlags = binding.stages,
+            .pImmutableSamplers = nullptr,
+        });
+        bindingFlags.push_back(flags);
+    }
+
+    const vk::DescriptorSetLayoutBindingFlagsCreateInfo bindingFlagsInfo = {
+        .bindingCount = static_cast<uint32_t>(bindingFlags.size()),
+        .pBindingFlags = bindingFlags.data(),
+    };
+
+    const vk::DescriptorSetLayoutCreateInfo setLayoutInfo = {
+        .pNext = variableCount ? &bindingFlagsInfo : nullptr,
+        .bindingCount = static_cast<uint32_t>(layoutBindings.size()),
+        .pBindings = layoutBindings.data(),
+    };
+
+    const auto [res, handle] = mCtx->device().createDescriptorSetLayout(setLayoutInfo);
+    if (res != vk::Result::eSuccess)
+    {
+        return res;
+    }
+
+    setLayout = handle;
+    mSetLayouts.emplace(std::move(key), handle);
+
+    return vk::Result::eSuccess;
+}
+
+}  // namespace pyroc::backend::vulkan
@@ -0,0 +1,448 @@
+#include "backend/vulkan/shader_reload.h"
+
+#include "backend/vulkan/context.h"
+#include "backend/vulkan/shader.h"
+#include "util/log.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+
+#ifdef __linux__
+#include <poll.h>
+#include <spawn.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+extern char** environ;
+#endif
+
+namespace pyroc::backend::vulkan
+{
+
+#ifdef __linux__
+
+namespace
+{
+// Editors save in several writes and renames, compiling is held off until they are done
+constexpr auto kSettleTime = std::chrono::milliseconds(50);
+
+std::string normalPath(const std::filesystem::path& path)
+{
+    std::error_code error;
+    const std::filesystem::path absolute = std::filesystem::absolute(path, error);
+    return (error ? path : absolute).lexically_normal().string();
+}
+
+// Prerequisites of a make rule as written by glslc's -M and -MD
+std::vector<std::string> readDependencies(const std::string& path)
+{
+    std::ifstream file(path);
+    std::string rule{std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>()};
+
+    const size_t colon = rule.find(": ");
+    if (colon == std::string::npos)
+    {
+        return {};
+    }
+
+    std::replace(rule.begin(), rule.end(), '\\', ' ');
+
+    std::vector<std::string> dependencies;
+    std::istringstream stream(rule.substr(colon + 1));
+    for (std::string dependency; stream >> dependency;)
+    {
+        dependencies.push_back(normalPath(dependency));
+    }
+
+    return dependencies;
+}
+
+bool readCode(const std::string& path, std::vector<uint32_t>& code)
+{
+    std::ifstream file(path, std::ios::ate | std::ios::binary);
+    if (!file.is_open())
+    {
+        return false;
+    }
+
+    const auto size = static_cast<size_t>(file.tellg());
+    if (size % sizeof(uint32_t) != 0)
+    {
+        return false;
+    }
+
+    code.resize(size / sizeof(uint32_t));
+    file.seekg(0);
+    file.read(reinterpret_cast<char*>(code.data()), static_cast<std::streamsize>(size));
+
+    return static_cast<bool>(file) && isValidSpirv(code.data(), size);
+}
+
+bool run(std::vector<std::string>& args)
+{
+    std::vector<char*> argv;
+    argv.reserve(args.size() + 1);
+    for (std::string& arg : args)
+    {
+        argv.push_back(arg.data());
+    }
+    argv.push_back(nullptr);
+
+    pid_t pid = 0;
+    if (posix_spawnp(&pid, argv[0], nullptr, nullptr, argv.data(), environ) != 0)
+    {
+        LOG_DEBUG("Failed to run %s", argv[0]);
+        return false;
+    }
+
+    int status = 0;
+    while (waitpid(pid, &status, 0) < 0)
+    {
+        if (errno != EINTR)
+        {
+            return false;
+        }
+    }
+
+    return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+}  // namespace
+
+vk::Result ShaderReloader::init(Context* ctx, const ShaderReloaderCreateInfo* pCreateInfo)
+{
+    mCtx = ctx;
+    mCompilerPath = pCreateInfo->pCompilerPath;
+    mTargetEnv = pCreateInfo->pTargetEnv;
+
+    std::error_code error;
+    const std::filesystem::path tempDirectory = std::filesystem::temp_directory_path(error);
+    mTempPrefix = (error ? std::filesystem::path("/tmp") : tempDirectory).string()
+                  + "/pyroc_shader_" + std::to_string(getpid()) + "_";
+
+    mInotify = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (mInotify < 0)
+    {
+        LOG_DEBUG("Failed to create an inotify instance");
+        return vk::Result::eErrorInitializationFailed;
+    }
+
+    mWakeEvent = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (mWakeEvent < 0)
+    {
+        close(mInotify);
+        mInotify = -1;
+        return vk::Result::eErrorInitializationFailed;
+    }
+
+    mWorker = std::thread(&ShaderReloader::workerLoop, this);
+
+    return vk::Result::eSuccess;
+}
+
+void ShaderReloader::destroy()
+{
+    if (mWorker.joinable())
+    {
+        {
+            std::lock_guard lock(mMutex);
+            mStopping = true;
+        }
+
+        const uint64_t value = 1;
+        [[maybe_unused]] const auto written = write(mWakeEvent, &value, sizeof(value));
+
+        mWorker.join();
+    }
+
+    if (mWakeEvent >= 0)
+    {
+        close(mWakeEvent);
+        mWakeEvent = -1;
+    }
+
+    if (mInotify >= 0)
+    {
+        close(mInotify);
+        mInotify = -1;
+    }
+
+    mSources.clear();
+    mDirectories.clear();
+    mAdded.clear();
+    mCompiled.clear();
+}
+
+vk::Result ShaderReloader::watch(const char* sourcePath, uint32_t& id)
+{
+    if (!mWorker.joinable())
+    {
+        return vk::Result::eErrorInitializationFailed;
+    }
+
+    {
+        std::lock_guard lock(mMutex);
+
+        Source source;
+        source.id = mNextId++;
+        source.path = normalPath(sourcePath);
+        source.dependencies.push_back(source.path);
+
+        id = source.id;
+        mAdded.push_back(std::move(source));
+    }
+
+    const uint64_t value = 1;
+    [[maybe_unused]] const auto written = write(mWakeEvent, &value, sizeof(value));
+
+    return vk::Result::eSuccess;
+}
+
+vk::Result ShaderReloader::poll(std::vector<ShaderReload>& reloads)
+{
+    std::vector<Compiled> compiled;
+    {
+        std::lock_guard lock(mMutex);
+        compiled.swap(mCompiled);
+    }
+
+    // One bad binary does not hold back the others, it is skipped until its next edit
+    for (const Compiled& shader : compiled)
+    {
+        const size_t size = shader.code.size() * sizeof(uint32_t);
+
+        ShaderReload reload;
+        reload.id = shader.id;
+
+        // Reflected first, a module may be shared and is not released on failure
+        auto res = reflectShader(shader.code.data(), size, reload.reflection);
+        if (res != vk::Result::eSuccess)
+        {
+            LOG_DEBUG("Failed to reflect reloaded shader %u: %s", shader.id,
+                      vk::to_string(res).c_str());
+            continue;
+        }
+
+        res = mCtx->shaders().create(shader.code.data(), size, reload.module);
+        if (res != vk::Result::eSuccess)
+        {
+            LOG_DEBUG("Failed to create reloaded shader %u: %s", shader.id,
+                      vk::to_string(res).c_str());
+            continue;
+        }
+
+        reloads.push_back(std::move(reload));
+    }
+
+    return vk::Result::eSuccess;
+}
+
+void ShaderReloader::workerLoop()
+{
+    alignas(inotify_event) char events[4096];
+
+    for (;;)
+    {
+        pollfd fds[] = {
+            {.fd = mInotify, .events = POLLIN, .revents = 0},
+            {.fd = mWakeEvent, .events = POLLIN, .revents = 0},
+        };
+
+        if (::poll(fds, 2, -1) < 0 && errno != EINTR)
+        {
+            LOG_DEBUG("Shader reload stopped, poll failed");
+            return;
+        }
+
+        if (fds[1].revents & POLLIN)
+        {
+            uint64_t value = 0;
+            [[maybe_unused]] const auto bytesRead = read(mWakeEvent, &value, sizeof(value));
+        }
+
+        std::vector<Source> added;
+        {
+            std::lock_guard lock(mMutex);
+            if (mStopping)
+            {
+                return;
+            }
+            added.swap(mAdded);
+        }
+
+        // Dependencies are scanned up front, so editing an include rebuilds before the source is
+        for (Source& source : added)
+        {
+            std::vector<uint32_t> code;
+            compile(source, true, code);
+            watchDirectories(source);
+            mSources.push_back(std::move(source));
+        }
+
+        if (!(fds[0].revents & POLLIN))
+        {
+            continue;
+        }
+
+        std::this_thread::sleep_for(kSettleTime);
+
+        for (;;)
+        {
+            const ssize_t length = read(mInotify, events, sizeof(events));
+            if (length <= 0)
+            {
+                break;
+            }
+
+            for (ssize_t offset = 0; offset < length;)
+            {
+                const auto* pEvent = reinterpret_cast<const inotify_event*>(events + offset);
+                offset += static_cast<ssize_t>(sizeof(inotify_event) + pEvent->len);
+
+                const auto it = mDirectories.find(pEvent->wd);
+                if (it == mDirectories.end() || pEvent->len == 0)
+                {
+                    continue;
+                }
+
+                const std::string path = it->second + "/" + pEvent->name;
+                for (Source& source : mSources)
+                {
+                    const auto& dependencies = source.dependencies;
+                    if (std::find(dependencies.begin(), dependencies.end(), path)
+                        != dependencies.end())
+                    {
+                        source.dirty = true;
+                    }
+                }
+            }
+        }
+
+        for (Source& source : mSources)
+        {
+            if (!source.dirty)
+            {
+                continue;
+            }
+            source.dirty = false;
+
+            std::vector<uint32_t> code;
+            if (!compile(source, false, code))
+            {
+                continue;
+            }
+
+            // Includes added by the edit
+            watchDirectories(source);
+
+            LOG_DEBUG("Recompiled %s", source.path.c_str());
+
+            std::lock_guard lock(mMutex);
+
+            // A binary not yet polled is superseded rather than handed out twice
+            auto it = std::find_if(mCompiled.begin(), mCompiled.end(),
+                                   [&source](const Compiled& compiled)
+                                   { return compiled.id == source.id; });
+            if (it == mCompiled.end())
+            {
+                it = mCompiled.insert(mCompiled.end(), {.id = source.id, .code = {}});
+            }
+            it->code = std::move(code);
+        }
+    }
+}
+
+bool ShaderReloader::compile(Source& source, bool dependenciesOnly, std::vector<uint32_t>& code)
+{
+    const std::string prefix = mTempPrefix + std::to_string(source.id);
+    const std::string outputPath = prefix + ".spv";
+    const std::string dependencyPath = prefix + ".d";
+
+    std::vector<std::string> args = {
+        mCompilerPath,
+        "--target-env=" + mTargetEnv,
+        "-I",
+        std::filesystem::path(source.path).parent_path().string(),
+        dependenciesOnly ? "-M" : "-MD",
+        "-MF",
+        dependencyPath,
+    };
+
+    if (!dependenciesOnly)
+    {
+        args.push_back("-o");
+        args.push_back(outputPath);
+    }
+
+    args.push_back(source.path);
+
+    bool success = run(args);
+
+    std::vector<std::string> dependencies = readDependencies(dependencyPath);
+    if (success && !dependencies.empty())
+    {
+        source.dependencies = std::move(dependencies);
+    }
+
+    if (success && !dependenciesOnly)
+    {
+        success = readCode(outputPath, code);
+    }
+
+    std::error_code error;
+    std::filesystem::remove(outputPath, error);
+    std::filesystem::remove(dependencyPath, error);
+
+    return success;
+}
+
+void ShaderReloader::watchDirectories(const Source& source)
+{
+    for (const std::string& dependency : source.dependencies)
+    {
+        const std::string directory = std::filesystem::path(dependency).parent_path().string();
+
+        // Replacing a file by rename is a move into the directory, not a write to the file
+        const int wd = inotify_add_watch(mInotify, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+        if (wd < 0)
+        {
+            LOG_DEBUG("Failed to watch %s", directory.c_str());
+            continue;
+        }
+
+        mDirectories[wd] = directory;
+    }
+}
+
+#else
+
+vk::Result ShaderReloader::init(Context* ctx, const ShaderReloaderCreateInfo*)
+{
+    mCtx = ctx;
+    return vk::Result::eErrorFeatureNotPresent;
+}
+
+void ShaderReloader::destroy() {}
+
+vk::Result ShaderReloader::watch(const char*, uint32_t&)
+{
+    return vk::Result::eErrorFeatureNotPresent;
+}
+
+vk::Result ShaderReloader::poll(std::vector<ShaderReload>&) { return vk::Result::eSuccess; }
+
+void ShaderReloader::workerLoop() {}
+
+bool ShaderReloader::compile(Source&, bool, std::vector<uint32_t>&) { return false; }
+
+void ShaderReloader::watchDirectories(const Source&) {}
+
+#endif
+
+}  // namespace pyroc::backend::vulkan
@@ -0,0 +1,451 @@
+#include "backend/vulkan/staging.h"
+
+#include "backend/vulkan/context.h"
+
+#include <cstddef>
+#include <cstring>
+#include <limits>
+
+namespace pyroc::backend::vulkan
+{
+namespace
+{
+constexpr vk::DeviceSize kInvalidOffset = ~vk::DeviceSize{0};
+
+// Keeps staged data aligned for vector loads and any struct the caller writes in place
+constexpr vk::DeviceSize kStagingAlignment = 16;
+
+vk::DeviceSize alignUp(vk::DeviceSize value, vk::DeviceSize alignment)
+{
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+}  // namespace
+
+vk::Result StagingRing::init(Context* ctx, const StagingRingCreateInfo* pCreateInfo)
+{
+    mCtx = ctx;
+    mCapacity = pCreateInfo->size;
+    mHead = 0;
+    mTail = 0;
+    mUsed = 0;
+    mFrameConsumed = 0;
+    mFrameIndex = 0;
+    mSubmissionCount = 0;
+
+    vk::Device device = ctx->device();
+
+    {
+        const auto res = createBuffer(
+            ctx, mCapacity, vk::BufferUsageFlagBits::eTransferSrc,
+            vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent,
+            mBuffer);
+        if (res != vk::Result::eSuccess)
+        {
+            return res;
+        }
+    }
+
+    {
+        const vk::CommandPoolCreateInfo poolInfo = {
+            .flags = vk::CommandPoolCreateFlagBits::eResetCommandBuffer,
+            .queueFamilyIndex = ctx->graphicsQueueIdx(),
+        };
+
+        const auto [res, handle] = device.createCommandPool(poolInfo);
+        if (res != vk::Result::eSuccess)
+        {
+            return res;
+        }
+
+        mCommandPool = handle;
+    }
+
+    mFrames.resize(pCreateInfo->framesInFlight);
+    for (Frame& frame : mFrames)
+    {
+        const auto res = addSubmission(frame);
+        if (res != vk::Result::eSuccess)
+        {
+            return res;
+        }
+    }
+
+    mCopyTargets.reserve(pCreateInfo->maxCopiesPerFrame);
+    mCopyRegions.reserve(pCreateInfo->maxCopiesPerFrame);
+
+    return vk::Result::eSuccess;
+}
+
+void StagingRing::destroy()
+{
+    vk::Device device = mCtx->device();
+
+    // Retiring the newest submission waits for all of them
+    if (const Submission* pNewest = newestPending(mFrames))
+    {
+        retire(*pNewest);
+    }
+
+    for (Frame& frame : mFrames)
+    {
+        for (Submission& submission : frame.submissions)
+        {
+            device.destroyFence(submission.fence);
+        }
+    }
+    mFrames.clear();
+
+    device.destroyCommandPool(mCommandPool);
+    destroyBuffer(mCtx, mBuffer);
+
+    mCopyTargets.clear();
+    mCopyRegions.clear();
+}
+
+vk::Result StagingRing::addSubmission(Frame& frame)
+{
+    vk::Device device = mCtx->device();
+
+    Submission submission;
+    {
+        const vk::CommandBufferAllocateInfo allocInfo = {
+            .commandPool = mCommandPool,
+            .level = vk::CommandBufferLevel::ePrimary,
+            .commandBufferCount = 1,
+        };
+
+        const auto res = device.allocateCommandBuffers(&allocInfo, &submission.commandBuffer);
+        if (res != vk::Result::eSuccess)
+        {
+            return res;
+        }
+    }
+
+    {
+        const vk::FenceCreateInfo fenceInfo = {};
+
+        const auto [res, handle] = device.createFence(fenceInfo);
+        if (res != vk::Result::eSuccess)
+        {
+            device.freeCommandBuffers(mCommandPool, submission.commandBuffer);
+            return res;
+        }
+
+        submission.fence = handle;
+    }
+
+    frame.submissions.push_back(submission);
+    return vk::Result::eSuccess;
+}
+
+vk::DeviceSize StagingRing::allocate(vk::DeviceSize size, vk::DeviceSize alignment)
+{
+    if (size > mCapacity)
+    {
+        return kInvalidOffset;
+    }
+
+    if (mUsed == 0)
+    {
+        mHead = 0;
+        mTail = 0;
+    }
+
+    vk::DeviceSize offset = alignUp(mHead, alignment);
+    vk::DeviceSize consumed = 0;
+    if (mHead > mTail || mUsed == 0)
+    {
+        // Free space is [head, capacity) followed by [0, tail)
+        if (offset + size <= mCapacity)
+        {
+            consumed = offset + size - mHead;
+        }
+        else if (size <= mTail)
+        {
+            // Skip the end of the ring, the skipped bytes retire along with this allocation
+            consumed = mCapacity - mHead + size;
+            offset = 0;
+        }
+        else
+        {
+            return kInvalidOffset;
+        }
+    }
+    else
+    {
+        // Wrapped, free space is [head, tail)
+        if (offset + size > mTail)
+        {
+            return kInvalidOffset;
+        }
+
+        consumed = offset + size - mHead;
+    }
+
+    mHead = offset + size;
+    mUsed += consumed;
+    mFrameConsumed += consumed;
+    return offset;
+}
+
+void StagingRing::release(Submission& submission)
+{
+    // Submissions retire in order, so the tail simply moves to the end of each
+    if (submission.consumed > 0)
+    {
+        mTail = submission.end;
+        mUsed -= submission.consumed;
+    }
+
+    submission.consumed = 0;
+    submission.pending = false;
+}
+
+StagingRing::Submission* StagingRing::newestPending(std::span<Frame> frames)
+{
+    Submission* pNewest = nullptr;
+    for (Frame& frame : frames)
+    {
+        for (Submission& submission : frame.submissions)
+        {
+            if (submission.pending && (pNewest == nullptr || submission.index > pNewest->index))
+            {
+                pNewest = &submission;
+            }
+        }
+    }
+    return pNewest;
+}
+
+vk::Result StagingRing::retire(const Submission& submission)
+{
+    if (!submission.pending)
+    {
+        return vk::Result::eSuccess;
+    }
+
+    vk::Device device = mCtx->device();
+    {
+        const auto res = device.waitForFences(submission.fence, vk::True,
+                                              std::numeric_limits<uint64_t>::max());
+        if (res != vk::Result::eSuccess)
+        {
+            return res;
+        }
+    }
+
+    // Signal operations follow submission order, every earlier submission is complete as well
+    const uint64_t index = submission.index;
+    while (true)
+    {
+        Submission* pOldest = nullptr;
+        for (Frame& frame : mFrames)
+        {
+            for (Submission& other : frame.submissions)
+            {
+                if (other.pending && other.index <= index
+                    && (pOldest == nullptr || other.index < pOldest->index))
+                {
+                    pOldest = &other;
+                }
+            }
+        }
+
+        if (pOldest == nullptr)
+        {
+            break;
+        }
+
+        const auto res = device.resetFences(pOldest->fence);
+        if (res != vk::Result::eSuccess)
+        {
+            return res;
+        }
+
+        release(*pOldest);
+    }
+
+    return vk::Result::eSuccess;
+}
+
+vk::Result StagingRing::beginFrame()
+{
+    mFrameIndex = (mFrameIndex + 1) % static_cast<uint32_t>(mFrames.size());
+
+    Frame& frame = mFrames[mFrameIndex];
+    frame.submissionCount = 0;
+
+    if (const Submission* pNewest = newestPending({&frame, 1}))
+    {
+        return retire(*pNewest);
+    }
+
+    return vk::Result::eSuccess;
+}
+
+void* StagingRing::reserve(vk::DeviceSize size, Buffer& dst, vk::DeviceSize dstOffset)
+{
+    const vk::DeviceSize offset = allocate(size, kStagingAlignment);
+    if (offset == kInvalidOffset)
+    {
+        return nullptr;
+    }
+
+    mCopyTargets.push_back(dst.buffer);
+    mCopyRegions.push_back({
+        .srcOffset = offset,
+        .dstOffset = dstOffset,
+        .size = size,
+    });
+
+    return static_cast<std::byte*>(mBuffer.pMapped) + offset;
+}
+
+vk::Result StagingRing::stage(const void* pData, vk::DeviceSize size, Buffer& dst,
+                              vk::DeviceSize dstOffset)
+{
+    void* pDst = reserve(size, dst, dstOffset);
+    if (pDst == nullptr)
+    {
+        return vk::Result::eErrorOutOfDeviceMemory;
+    }
+
+    std::memcpy(pDst, pData, size);
+    return vk::Result::eSuccess;
+}
+
+vk::Result StagingRing::copyBlocking(vk::CommandBuffer cmdBuf, const void* pData,
+                                     vk::DeviceSize size, Buffer& dst, vk::DeviceSize dstOffset)
+{
+    // The copy completes before returning, so the allocation is undone rather than retired
+    const vk::DeviceSize head = mHead;
+    const vk::DeviceSize tail = mTail;
+    const vk::DeviceSize used = mUsed;
+    const vk::DeviceSize frameConsumed = mFrameConsumed;
+
+    const vk::DeviceSize offset = allocate(size, kStagingAlignment);
+    if (offset == kInvalidOffset)
+    {
+        return vk::Result::eErrorOutOfDeviceMemory;
+    }
+
+    std::memcpy(static_cast<std::byte*>(mBuffer.pMapped) + offset, pData, size);
+
+    const auto res = copyBufferBlocking(mCtx, cmdBuf, offset, mBuffer, dstOffset, dst, size);
+
+    mHead = head;
+    mTail = tail;
+    mUsed = used;
+    mFrameConsumed = frameConsumed;
+
+    return res;
+}
+
+vk::Result StagingRing::flush(bool wait)
+{
+    Frame& frame = mFrames[mFrameIndex];
+    if (mCopyRegions.empty())
+    {
+        const Submission* pNewest = newestPending({&frame, 1});
+        return wait && pNewest != nullptr ? retire(*pNewest) : vk::Result::eSuccess;
+    }
+
+    // A second flush in the same frame records into another command buffer of the slot
+    if (frame.submissionCount == frame.submissions.size())
+    {
+        const auto res = addSubmission(frame);
+        if (res != vk::Result::eSuccess)
+        {
+            return res;
+        }
+    }
+
+    Submission& submission = frame.submissions[frame.submissionCount];
+    vk::CommandBuffer cmdBuf = submission.commandBuffer;
+    {
+        const auto res = cmdBuf.reset();
+        if (res != vk::Result::eSuccess)
+        {
+            return res;
+        }
+    }
+
+    {
+        const vk::CommandBufferBeginInfo beginInfo = {
+            .flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit,
+        };
+
+        const auto res = cmdBuf.begin(beginInfo);
+        if (res != vk::Result::eSuccess)
+        {
+            return res;
+        }
+    }
+
+    // One copy command per run of regions targeting the same buffer
+    for (size_t begin = 0; begin < mCopyRegions.size();)
+    {
+        size_t end = begin + 1;
+        while (end < mCopyRegions.size() && mCopyTargets[end] == mCopyTargets[begin])
+        {
+            ++end;
+        }
+
+        cmdBuf.copyBuffer(mBuffer.buffer, mCopyTargets[begin], static_cast<uint32_t>(end - begin),
+                          &mCopyRegions[begin]);
+        begin = end;
+    }
+
+    {
+        // Make the copies visible to everything submitted after them on the queue
+        const vk::MemoryBarrier barrier = {
+            .srcAccessMask = vk::AccessFlagBits::eTransferWrite,
+            .dstAccessMask = vk::AccessFlagBits::eVertexAttributeRead
+                             | vk::AccessFlagBits::eIndexRead | vk::AccessFlagBits::eUniformRead
+                             | vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eTransferRead,
+        };
+
+        cmdBuf.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer,
+                               vk::PipelineStageFlagBits::eVertexInput
+                                   | vk::PipelineStageFlagBits::eVertexShader
+                                   | vk::PipelineStageFlagBits::eFragmentShader
+                                   | vk::PipelineStageFlagBits::eComputeShader
+                                   | vk::PipelineStageFlagBits::eTransfer,
+                               {}, 1, &barrier, 0, nullptr, 0, nullptr);
+    }
+
+    {
+        const auto res = cmdBuf.end();
+        if (res != vk::Result::eSuccess)
+        {
+            return res;
+        }
+    }
+
+    {
+        const vk::SubmitInfo submitInfo = {
+            .commandBufferCount = 1,
+            .pCommandBuffers = &cmdBuf,
+        };
+
+        const auto res = mCtx->graphicsQueue().submit(submitInfo, submission.fence);
+        if (res != vk::Result::eSuccess)
+        {
+            return res;
+        }
+    }
+
+    submission.end = mHead;
+    submission.consumed = mFrameConsumed;
+    submission.index = ++mSubmissionCount;
+    submission.pending = true;
+    ++frame.submissionCount;
+
+    mFrameConsumed = 0;
+    mCopyTargets.clear();
+    mCopyRegions.clear();
+
+    return wait ? retire(submission) : vk::Result::eSuccess;
+}
+
+}  // namespace pyroc::backend::vulkan
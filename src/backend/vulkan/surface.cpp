@@ -89,7 +89,7 @@ vk::Extent2D chooseSwapchainExtent(const vk::Extent2D& extent, const SwapchainIn
     return actualExtent;
 }
 
-vk::Result createSwapchain(Context* ctx, Surface& surface)
+vk::Result createSwapchain(Context* ctx, Surface& surface, vk::SwapchainKHR oldSwapchain)
 {
     vk::PhysicalDevice physicalDevice = ctx->physicalDevice();
     vk::Device device = ctx->device();
@@ -137,7 +137,7 @@ vk::Result createSwapchain(Context* ctx, Surface& surface)
             .compositeAlpha = vk::CompositeAlphaFlagBitsKHR::eOpaque,
             .presentMode = presentMode,
             .clipped = VK_TRUE,
-            .oldSwapchain = nullptr,
+            .oldSwapchain = oldSwapchain,
         };
 
         const auto [res, swapchain] = device.createSwapchainKHR(createInfo);
@@ -196,17 +196,15 @@ vk::Result createSwapchain(Context* ctx, Surface& surface)
     return vk::Result::eSuccess;
 }
 
-void destroySwapchain(Context* ctx, Surface& surface)
+void destroySwapchain(vk::Device device, vk::SwapchainKHR swapchain,
+                      std::vector<vk::ImageView>& imageViews)
 {
-    vk::Device device = ctx->device();
-
-    for (auto& imageView : surface.swapchainImageViews)
+    for (auto& imageView : imageViews)
     {
         device.destroyImageView(imageView);
         imageView = nullptr;
     }
-    device.destroySwapchainKHR(surface.swapchain);
-    surface.swapchain = nullptr;
+    device.destroySwapchainKHR(swapchain);
 }
 
 }  // namespace
@@ -221,32 +219,69 @@ vk::Result createSurface(Context* ctx, const SurfaceCreateInfo* createInfo, Surf
         return vk::Result::eSuccess;
     }
 
-    return createSwapchain(ctx, surface);
+    return createSwapchain(ctx, surface, nullptr);
 }
 
 vk::Result recreateSurface(Context* ctx, const SurfaceCreateInfo* createInfo, Surface& surface)
 {
-    vk::Device device = ctx->device();
-    const auto res = device.waitIdle();
-    if (res != vk::Result::eSuccess)
-    {
-        return res;
-    }
-
     surface.extent = createInfo->extent;
 
-    destroySwapchain(ctx, surface);
+    // Images still acquired or queued for present stay valid, the old swapchain just retires
+    const vk::SwapchainKHR oldSwapchain = surface.swapchain;
+    if (oldSwapchain)
+    {
+        surface.retiredSwapchains.push_back({
+            .swapchain = oldSwapchain,
+            .imageViews = std::move(surface.swapchainImageViews),
+            .fence = createInfo->retireFence,
+        });
+
+        surface.swapchain = nullptr;
+        surface.swapchainImages.clear();
+        surface.swapchainImageViews.clear();
+    }
 
-    if (surface.extent.width == 0 || surface.extent.height == 0)
+    vk::Result res = vk::Result::eSuccess;
+    if (surface.extent.width != 0 && surface.extent.height != 0)
     {
-        return vk::Result::eSuccess;
+        res = createSwapchain(ctx, surface, oldSwapchain);
     }
-    return createSwapchain(ctx, surface);
+
+    // Only after creation, the old swapchain must outlive its use as oldSwapchain
+    releaseRetiredSwapchains(ctx, surface);
+
+    return res;
+}
+
+void releaseRetiredSwapchains(Context* ctx, Surface& surface)
+{
+    vk::Device device = ctx->device();
+
+    std::erase_if(surface.retiredSwapchains,
+                  [device](RetiredSwapchain& retired)
+                  {
+                      if (retired.fence
+                          && device.getFenceStatus(retired.fence) != vk::Result::eSuccess)
+                      {
+                          return false;
+                      }
+
+                      destroySwapchain(device, retired.swapchain, retired.imageViews);
+                      return true;
+                  });
 }
 
 void destroySurface(Context* ctx, Surface& surface)
 {
-    destroySwapchain(ctx, surface);
+    vk::Device device = ctx->device();
+
+    for (RetiredSwapchain& retired : surface.retiredSwapchains)
+    {
+        destroySwapchain(device, retired.swapchain, retired.imageViews);
+    }
+    surface.retiredSwapchains.clear();
+
+    destroySwapchain(device, surface.swapchain, surface.swapchainImageViews);
     surface.surface = nullptr;
     surface.swapchain = nullptr;
     surface.format = vk::Format::eUndefined;
@@ -0,0 +1,403 @@
+#include "backend/vulkan/upload.h"
+
+#include "backend/vulkan/context.h"
+#include "util/log.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <limits>
+
+namespace pyroc::backend::vulkan
+{
+namespace
+{
+constexpr vk::DeviceSize kStagingAlignment = 16;
+}  // namespace
+
+vk::Result UploadQueue::init(Context* ctx, const UploadQueueCreateInfo* pCreateInfo)
+{
+    mCtx = ctx;
+    mTransferFamily = ctx->transferQueueIdx();
+    mGraphicsFamily = ctx->graphicsQueueIdx();
+    mStagingSize = pCreateInfo->stagingSize;
+    mNextValue = 1;
+
+    vk::Device device = ctx->device();
+
+    {
+        const auto res = createBuffer(
+            ctx, mStagingSize, vk::BufferUsageFlagBits::eTransferSrc,
+            vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent,
+            mStaging);
+        if (res != vk::Result::eSuccess)
+        {
+            return res;
+        }
+    }
+
+    mStagingRanges.init(mStagingSize);
+
+    {
+        const vk::CommandPoolCreateInfo poolInfo = {
+            .flags = vk::CommandPoolCreateFlagBits::eResetCommandBuffer
+                     | vk::CommandPoolCreateFlagBits::eTransient,
+            .queueFamilyIndex = mTransferFamily,
+        };
+
+        const auto [res, handle] = device.createCommandPool(poolInfo);
+        if (res != vk::Result::eSuccess)
+        {
+            return res;
+        }
+
+        mCommandPool = handle;
+    }
+
+    {
+        const vk::SemaphoreTypeCreateInfo timelineInfo = {
+            .semaphoreType = vk::SemaphoreType::eTimeline,
+            .initialValue = 0,
+        };
+
+        const vk::SemaphoreCreateInfo semaphoreInfo = {
+            .pNext = &timelineInfo,
+        };
+
+        const auto [res, handle] = device.createSemaphore(semaphoreInfo);
+        if (res != vk::Result::eSuccess)
+        {
+            return res;
+        }
+
+        mSemaphore = handle;
+    }
+
+    return vk::Result::eSuccess;
+}
+
+void UploadQueue::destroy()
+{
+    vk::Device device = mCtx->device();
+
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        submitLocked();
+    }
+
+    wait({.value = mNextValue - 1}, std::numeric_limits<uint64_t>::max());
+
+    for (const Batch& batch : mBatches)
+    {
+        device.freeCommandBuffers(mCommandPool, 1, &batch.commandBuffer);
+    }
+    mBatches.clear();
+    mInFlight.clear();
+    mFreeBatches.clear();
+    mRecording = ~0u;
+
+    device.destroySemaphore(mSemaphore);
+    device.destroyCommandPool(mCommandPool);
+    destroyBuffer(mCtx, mStaging);
+}
+
+uint64_t UploadQueue::completedValue()
+{
+    const auto [res, value] = mCtx->device().getSemaphoreCounterValue(mSemaphore);
+    return res == vk::Result::eSuccess ? value : 0;
+}
+
+void UploadQueue::collectLocked()
+{
+    const uint64_t completed = completedValue();
+
+    for (size_t i = 0; i < mInFlight.size();)
+    {
+        Batch& batch = mBatches[mInFlight[i]];
+        if (batch.value > completed)
+        {
+            ++i;
+            continue;
+        }
+
+        for (const uint32_t node : batch.stagingNodes)
+        {
+            mStagingRanges.free(node);
+        }
+        batch.stagingNodes.clear();
+        batch.targets.clear();
+
+        mFreeBatches.push_back(mInFlight[i]);
+        mInFlight[i] = mInFlight.back();
+        mInFlight.pop_back();
+    }
+}
+
+vk::Result UploadQueue::beginBatch()
+{
+    collectLocked();
+
+    if (mFreeBatches.empty())
+    {
+        const vk::CommandBufferAllocateInfo allocInfo = {
+            .commandPool = mCommandPool,
+            .level = vk::CommandBufferLevel::ePrimary,
+            .commandBufferCount = 1,
+        };
+
+        vk::CommandBuffer commandBuffer;
+        const auto res = mCtx->device().allocateCommandBuffers(&allocInfo, &commandBuffer);
+        if (res != vk::Result::eSuccess)
+        {
+            return res;
+        }
+
+        mFreeBatches.push_back(static_cast<uint32_t>(mBatches.size()));
+        mBatches.emplace_back().commandBuffer = commandBuffer;
+    }
+
+    mRecording = mFreeBatches.back();
+    mFreeBatches.pop_back();
+
+    Batch& batch = mBatches[mRecording];
+    batch.value = mNextValue;
+
+    {
+        const auto res = batch.commandBuffer.reset();
+        if (res != vk::Result::eSuccess)
+        {
+            return res;
+        }
+    }
+
+    {
+        const vk::CommandBufferBeginInfo beginInfo = {
+            .flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit,
+        };
+
+        const auto res = batch.commandBuffer.begin(beginInfo);
+        if (res != vk::Result::eSuccess)
+        {
+            return res;
+        }
+    }
+
+    {
+        // Submissions to one queue are not ordered, copies of earlier batches to the same
+        // destinations have to finish before this batch overwrites them
+        const vk::MemoryBarrier barrier = {
+            .srcAccessMask = vk::AccessFlagBits::eTransferWrite,
+            .dstAccessMask = vk::AccessFlagBits::eTransferWrite,
+        };
+
+        batch.commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer,
+                                            vk::PipelineStageFlagBits::eTransfer, {}, 1, &barrier,
+                                            0, nullptr, 0, nullptr);
+    }
+
+    return vk::Result::eSuccess;
+}
+
+vk::Result UploadQueue::createTarget(vk::DeviceSize size, vk::BufferUsageFlags usage,
+                                     Buffer& buffer)
+{
+    const uint32_t families[] = {mTransferFamily, mGraphicsFamily};
+    return createBuffer(mCtx, size, usage | vk::BufferUsageFlagBits::eTransferDst,
+                        vk::MemoryPropertyFlagBits::eDeviceLocal, families, buffer);
+}
+
+vk::Result UploadQueue::upload(const void* pData, vk::DeviceSize size, Buffer& dst,
+                               vk::DeviceSize dstOffset, UploadToken& token)
+{
+    if (size == 0)
+    {
+        token.value = 0;
+        return vk::Result::eSuccess;
+    }
+
+    if (mTransferFamily != mGraphicsFamily && dst.sharingMode != vk::SharingMode::eConcurrent)
+    {
+        LOG_DEBUG("Upload target not created with UploadQueue::createTarget");
+        return vk::Result::eErrorInitializationFailed;
+    }
+
+    std::lock_guard<std::mutex> lock(mMutex);
+
+    const auto* pBytes = static_cast<const std::byte*>(pData);
+    for (vk::DeviceSize offset = 0; offset < size;)
+    {
+        const vk::DeviceSize chunkSize = std::min(size - offset, mStagingSize);
+
+        const auto res = uploadChunkLocked(pBytes + offset, chunkSize, dst, dstOffset + offset);
+        if (res != vk::Result::eSuccess)
+        {
+            return res;
+        }
+
+        offset += chunkSize;
+    }
+
+    // Later batches signal higher values, the last chunk's batch covers the earlier ones
+    token.value = mBatches[mRecording].value;
+    return vk::Result::eSuccess;
+}
+
+vk::Result UploadQueue::uploadChunkLocked(const void* pData, vk::DeviceSize size, Buffer& dst,
+                                          vk::DeviceSize dstOffset)
+{
+    vk::DeviceSize stagingOffset = 0;
+    uint32_t node = mStagingRanges.allocate(size, kStagingAlignment, nullptr, stagingOffset);
+    if (node == RangeAllocator::kInvalidNode)
+    {
+        // Out of staging space, flush what is recorded and wait for everything in flight
+        {
+            const auto res = submitLocked();
+            if (res != vk::Result::eSuccess)
+            {
+                return res;
+            }
+        }
+
+        const vk::Semaphore semaphores[] = {mSemaphore};
+        const uint64_t values[] = {mNextValue - 1};
+        const vk::SemaphoreWaitInfo waitInfo = {
+            .semaphoreCount = 1,
+            .pSemaphores = semaphores,
+            .pValues = values,
+        };
+
+        {
+            const auto res
+                = mCtx->device().waitSemaphores(waitInfo, std::numeric_limits<uint64_t>::max());
+            if (res != vk::Result::eSuccess)
+            {
+                return res;
+            }
+        }
+
+        // The staging buffer is empty now, a chunk no larger than it always fits
+        collectLocked();
+        node = mStagingRanges.allocate(size, kStagingAlignment, nullptr, stagingOffset);
+        if (node == RangeAllocator::kInvalidNode)
+        {
+            return vk::Result::eErrorOutOfDeviceMemory;
+        }
+    }
+
+    if (mRecording == ~0u)
+    {
+        const auto res = beginBatch();
+        if (res != vk::Result::eSuccess)
+        {
+            mStagingRanges.free(node);
+            return res;
+        }
+    }
+
+    Batch& batch = mBatches[mRecording];
+    batch.stagingNodes.push_back(node);
+
+    std::memcpy(static_cast<std::byte*>(mStaging.pMapped) + stagingOffset, pData, size);
+
+    if (std::find(batch.targets.begin(), batch.targets.end(), dst.buffer) != batch.targets.end())
+    {
+        const vk::MemoryBarrier barrier = {
+            .srcAccessMask = vk::AccessFlagBits::eTransferWrite,
+            .dstAccessMask = vk::AccessFlagBits::eTransferWrite,
+        };
+
+        batch.commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer,
+                                            vk::PipelineStageFlagBits::eTransfer, {}, 1, &barrier,
+                                            0, nullptr, 0, nullptr);
+        batch.targets.clear();
+    }
+    batch.targets.push_back(dst.buffer);
+
+    const vk::BufferCopy region = {
+        .srcOffset = stagingOffset,
+        .dstOffset = dstOffset,
+        .size = size,
+    };
+    batch.commandBuffer.copyBuffer(mStaging.buffer, dst.buffer, 1, &region);
+
+    return vk::Result::eSuccess;
+}
+
+vk::Result UploadQueue::submitLocked()
+{
+    if (mRecording == ~0u)
+    {
+        return vk::Result::eSuccess;
+    }
+
+    Batch& batch = mBatches[mRecording];
+    vk::CommandBuffer cmdBuf = batch.commandBuffer;
+
+    {
+        const auto res = cmdBuf.end();
+        if (res != vk::Result::eSuccess)
+        {
+            return res;
+        }
+    }
+
+    {
+        const vk::TimelineSemaphoreSubmitInfo timelineInfo = {
+            .signalSemaphoreValueCount = 1,
+            .pSignalSemaphoreValues = &batch.value,
+        };
+
+        const vk::SubmitInfo submitInfo = {
+            .pNext = &timelineInfo,
+            .commandBufferCount = 1,
+            .pCommandBuffers = &cmdBuf,
+            .signalSemaphoreCount = 1,
+            .pSignalSemaphores = &mSemaphore,
+        };
+
+        const auto res = mCtx->transferQueue().submit(submitInfo);
+        if (res != vk::Result::eSuccess)
+        {
+            return res;
+        }
+    }
+
+    mInFlight.push_back(mRecording);
+    mRecording = ~0u;
+    ++mNextValue;
+
+    return vk::Result::eSuccess;
+}
+
+vk::Result UploadQueue::submit()
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    return submitLocked();
+}
+
+bool UploadQueue::isComplete(UploadToken token) { return completedValue() >= token.value; }
+
+vk::Result UploadQueue::wait(UploadToken token, uint64_t timeout)
+{
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        if (token.value >= mNextValue)
+        {
+            const auto res = submitLocked();
+            if (res != vk::Result::eSuccess)
+            {
+                return res;
+            }
+        }
+    }
+
+    const vk::SemaphoreWaitInfo waitInfo = {
+        .semaphoreCount = 1,
+        .pSemaphores = &mSemaphore,
+        .pValues = &token.value,
+    };
+
+    return mCtx->device().waitSemaphores(waitInfo, timeout);
+}
+
+}  // namespace pyroc::backend::vulkan
@@ -2,26 +2,142 @@
 
 namespace pyroc::core
 {
-math::mat4 Camera::viewMatrix() const
+void Camera::init(const CameraCreateInfo* createInfo)
 {
-    const math::vec3 f = math::normalize(center - eye);
-    const math::vec3 s = math::normalize(math::cross(f, up));
+    mEye = createInfo->eye;
+    mCenter = createInfo->center;
+    mUp = createInfo->up;
+    mFovY = createInfo->fovY;
+    mAspect = createInfo->aspect;
+    mNearPlane = createInfo->nearPlane;
+    mFarPlane = createInfo->farPlane;
+    mProjectionType = createInfo->projectionType;
+    mDepthMode = createInfo->depthMode;
+    mInfiniteFarPlane = createInfo->infiniteFarPlane;
+    mOrthographicHeight = createInfo->orthographicHeight;
+
+    markDirty(eAll);
+}
+
+void Camera::setLookAt(const math::vec3& eye, const math::vec3& center, const math::vec3& up)
+{
+    if (eye == mEye && center == mCenter && up == mUp)
+    {
+        return;
+    }
+
+    mEye = eye;
+    mCenter = center;
+    mUp = up;
+    markDirty(eViewDependents);
+}
+
+void Camera::setEye(const math::vec3& eye) { setLookAt(eye, mCenter, mUp); }
+
+void Camera::setCenter(const math::vec3& center) { setLookAt(mEye, center, mUp); }
+
+void Camera::setUp(const math::vec3& up) { setLookAt(mEye, mCenter, up); }
+
+void Camera::setPerspective(float fovY, float aspect, float nearPlane, float farPlane)
+{
+    if (fovY == mFovY && aspect == mAspect && nearPlane == mNearPlane && farPlane == mFarPlane)
+    {
+        return;
+    }
+
+    mFovY = fovY;
+    mAspect = aspect;
+    mNearPlane = nearPlane;
+    mFarPlane = farPlane;
+    markDirty(eProjectionDependents);
+}
+
+void Camera::setFovY(float fovY) { setPerspective(fovY, mAspect, mNearPlane, mFarPlane); }
+
+void Camera::setAspect(float aspect) { setPerspective(mFovY, aspect, mNearPlane, mFarPlane); }
+
+void Camera::setPlanes(float nearPlane, float farPlane)
+{
+    setPerspective(mFovY, mAspect, nearPlane, farPlane);
+}
+
+void Camera::setProjectionType(ProjectionType projectionType)
+{
+    if (projectionType == mProjectionType)
+    {
+        return;
+    }
+
+    mProjectionType = projectionType;
+    markDirty(eProjectionDependents);
+}
+
+void Camera::setDepthMode(DepthMode depthMode)
+{
+    if (depthMode == mDepthMode)
+    {
+        return;
+    }
+
+    mDepthMode = depthMode;
+    markDirty(eProjectionDependents);
+}
+
+void Camera::setInfiniteFarPlane(bool infiniteFarPlane)
+{
+    if (infiniteFarPlane == mInfiniteFarPlane)
+    {
+        return;
+    }
+
+    mInfiniteFarPlane = infiniteFarPlane;
+    markDirty(eProjectionDependents);
+}
+
+void Camera::setOrthographicHeight(float orthographicHeight)
+{
+    if (orthographicHeight == mOrthographicHeight)
+    {
+        return;
+    }
+
+    mOrthographicHeight = orthographicHeight;
+    markDirty(eProjectionDependents);
+}
+
+void Camera::markDirty(uint32_t flags)
+{
+    mDirty |= flags;
+    ++mVersion;
+}
+
+const math::mat4& Camera::viewMatrix() const
+{
+    if (!(mDirty & eView))
+    {
+        return mView;
+    }
+
+    const math::vec3 f = math::normalize(mCenter - mEye);
+    const math::vec3 s = math::normalize(math::cross(f, mUp));
     const math::vec3 u = math::normalize(math::cross(s, f));
 
-    math::mat4 result = math::mat4::identity();
-    result[0][0] = s.x;
-    result[0][1] = s.y;
-    result[0][2] = s.z;
-    result[1][0] = u.x;
-    result[1][1] = u.y;
-    result[1][2] = u.z;
-    result[2][0] = f.x;
-    result[2][1] = f.y;
-    result[2][2] = f.z;
-    result[3][0] = -math::dot(s, eye);
-    result[3][1] = -math::dot(u, eye);
-    result[3][2] = -math::dot(f, eye);
-    return result;
+    mView = math::mat4::identity();
+    mView[0][0] = s.x;
+    mView[0][1] = s.y;
+    mView[0][2] = s.z;
+    mView[1][0] = u.x;
+    mView[1][1] = u.y;
+    mView[1][2] = u.z;
+    mView[2][0] = f.x;
+    mView[2][1] = f.y;
+    mView[2][2] = f.z;
+    mView[3][0] = -math::dot(s, mEye);
+    mView[3][1] = -math::dot(u, mEye);
+    mView[3][2] = -math::dot(f, mEye);
+
+    mDirty &= ~eView;
+    return mView;
 }
 
 /*
@@ -31,8 +147,78 @@ math::mat4 Camera::viewMatrix() const
  * RHS coordinate system
  *Origin top left
  */
-math::mat4 Camera::projectionMatrix() const
+const math::mat4& Camera::projectionMatrix() const
 {
-    return math::perspective(math::radians(fovY), aspect, nearPlane, farPlane);
+    if (!(mDirty & eProjection))
+    {
+        return mProjection;
+    }
+
+    const bool reverseZ = mDepthMode == DepthMode::eReverseZ;
+
+    switch (mProjectionType)
+    {
+        case ProjectionType::ePerspective:
+        {
+            const float fovY = math::radians(mFovY);
+            if (mInfiniteFarPlane)
+            {
+                mProjection = reverseZ
+                                  ? math::perspectiveInfiniteReverseZ(fovY, mAspect, mNearPlane)
+                                  : math::perspectiveInfinite(fovY, mAspect, mNearPlane);
+            }
+            else
+            {
+                mProjection
+                    = reverseZ ? math::perspectiveReverseZ(fovY, mAspect, mNearPlane, mFarPlane)
+                               : math::perspective(fovY, mAspect, mNearPlane, mFarPlane);
+            }
+
+            break;
+        }
+        case ProjectionType::eOrthographic:
+        {
+            const float halfHeight = 0.5f * mOrthographicHeight;
+            const float halfWidth = halfHeight * mAspect;
+            mProjection = reverseZ ? math::orthographicReverseZ(-halfWidth, halfWidth, -halfHeight,
+                                                                halfHeight, mNearPlane, mFarPlane)
+                                   : math::orthographic(-halfWidth, halfWidth, -halfHeight,
+                                                        halfHeight, mNearPlane, mFarPlane);
+
+            break;
+        }
+    }
+
+    mDirty &= ~eProjection;
+    return mProjection;
+}
+
+/*
+ * operator* composes in the opposite order to the shaders, this is projection * view on the GPU
+ */
+const math::mat4& Camera::viewProjectionMatrix() const
+{
+    if (!(mDirty & eViewProjection))
+    {
+        return mViewProjection;
+    }
+
+    mViewProjection = viewMatrix() * projectionMatrix();
+
+    mDirty &= ~eViewProjection;
+    return mViewProjection;
+}
+
+const math::mat4& Camera::inverseViewProjectionMatrix() const
+{
+    if (!(mDirty & eInverseViewProjection))
+    {
+        return mInverseViewProjection;
+    }
+
+    mInverseViewProjection = math::inverse(viewProjectionMatrix());
+
+    mDirty &= ~eInverseViewProjection;
+    return mInverseViewProjection;
 }
 }  // namespace pyroc::core
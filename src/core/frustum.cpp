@@ -0,0 +1,240 @@
+#include "core/frustum.h"
+
+#include "core/camera.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace pyroc::core
+{
+namespace
+{
+constexpr size_t kBitsPerWord = 64;
+
+math::vec4 normalizePlane(const math::vec4& plane)
+{
+    const float length = std::sqrt(plane.x * plane.x + plane.y * plane.y + plane.z * plane.z);
+
+    if (length <= 1e-6f)
+    {
+        // Degenerate plane, accept everything
+        return math::vec4{.x = 0.0f, .y = 0.0f, .z = 0.0f, .w = 1.0f};
+    }
+
+    return (1.0f / length) * plane;
+}
+
+float planeDistance(const math::vec4& plane, float x, float y, float z)
+{
+    return plane.x * x + plane.y * y + plane.z * z + plane.w;
+}
+
+void setBit(std::span<uint64_t> visibility, size_t i)
+{
+    visibility[i / kBitsPerWord] |= uint64_t{1} << (i % kBitsPerWord);
+}
+
+#ifdef PYROC_MATH_SIMD_AVX2
+using math::detail::float8;
+
+struct Planes8
+{
+    float8 x[Frustum::eCount];
+    float8 y[Frustum::eCount];
+    float8 z[Frustum::eCount];
+    float8 w[Frustum::eCount];
+
+    explicit Planes8(const Frustum& frustum, bool absNormals)
+    {
+        for (size_t p = 0; p < Frustum::eCount; ++p)
+        {
+            const math::vec4& plane = frustum.planes[p];
+            x[p] = math::detail::splat8(absNormals ? std::fabs(plane.x) : plane.x);
+            y[p] = math::detail::splat8(absNormals ? std::fabs(plane.y) : plane.y);
+            z[p] = math::detail::splat8(absNormals ? std::fabs(plane.z) : plane.z);
+            w[p] = math::detail::splat8(plane.w);
+        }
+    }
+
+    float8 distance(size_t p, float8 px, float8 py, float8 pz) const
+    {
+        float8 d = math::detail::madd8(x[p], px, w[p]);
+        d = math::detail::madd8(y[p], py, d);
+        return math::detail::madd8(z[p], pz, d);
+    }
+};
+#endif
+
+template <typename RadiusFn>
+void cullScalar(const Frustum& frustum, math::soa3<const float> centers, size_t begin, size_t end,
+                RadiusFn radius, std::span<uint64_t> visibility)
+{
+    for (size_t i = begin; i < end; ++i)
+    {
+        bool visible = true;
+        for (size_t p = 0; p < Frustum::eCount && visible; ++p)
+        {
+            const math::vec4& plane = frustum.planes[p];
+            visible = planeDistance(plane, centers.x[i], centers.y[i], centers.z[i])
+                      >= -radius(plane, i);
+        }
+
+        if (visible)
+        {
+            setBit(visibility, i);
+        }
+    }
+}
+
+size_t prepareVisibility(size_t count, std::span<uint64_t> visibility)
+{
+    count = std::min(count, visibility.size() * kBitsPerWord);
+    std::fill(visibility.begin(), visibility.end(), uint64_t{0});
+    return count;
+}
+}  // namespace
+
+Frustum makeFrustum(const math::mat4& viewProjection, bool reverseZ)
+{
+    const auto row = [&viewProjection](size_t r)
+    {
+        return math::vec4{
+            .x = viewProjection[0][r],
+            .y = viewProjection[1][r],
+            .z = viewProjection[2][r],
+            .w = viewProjection[3][r],
+        };
+    };
+
+    const math::vec4 r0 = row(0);
+    const math::vec4 r1 = row(1);
+    const math::vec4 r2 = row(2);
+    const math::vec4 r3 = row(3);
+
+    Frustum frustum;
+    frustum.planes[Frustum::eLeft] = normalizePlane(r3 + r0);
+    frustum.planes[Frustum::eRight] = normalizePlane(r3 - r0);
+    frustum.planes[Frustum::eBottom] = normalizePlane(r3 + r1);
+    frustum.planes[Frustum::eTop] = normalizePlane(r3 - r1);
+
+    // Depth 0 is the near plane, or the far plane with reverse-Z
+    frustum.planes[reverseZ ? Frustum::eFar : Frustum::eNear] = normalizePlane(r2);
+    frustum.planes[reverseZ ? Frustum::eNear : Frustum::eFar] = normalizePlane(r3 - r2);
+    return frustum;
+}
+
+Frustum makeFrustum(const Camera& camera)
+{
+    return makeFrustum(camera.viewProjectionMatrix(), camera.depthMode() == DepthMode::eReverseZ);
+}
+
+bool isSphereVisible(const Frustum& frustum, const math::vec3& center, float radius)
+{
+    for (const math::vec4& plane : frustum.planes)
+    {
+        if (planeDistance(plane, center.x, center.y, center.z) < -radius)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool isAabbVisible(const Frustum& frustum, const math::vec3& center, const math::vec3& extents)
+{
+    for (const math::vec4& plane : frustum.planes)
+    {
+        const float radius = std::fabs(plane.x) * extents.x + std::fabs(plane.y) * extents.y
+                             + std::fabs(plane.z) * extents.z;
+        if (planeDistance(plane, center.x, center.y, center.z) < -radius)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+void cullSpheres(const Frustum& frustum, math::soa3<const float> centers,
+                 std::span<const float> radii, std::span<uint64_t> visibility)
+{
+    const size_t count = prepareVisibility(std::min(centers.size(), radii.size()), visibility);
+    size_t i = 0;
+
+#ifdef PYROC_MATH_SIMD_AVX2
+    {
+        const Planes8 planes(frustum, false);
+        const float8 zero = _mm256_setzero_ps();
+
+        for (; i + 8 <= count; i += 8)
+        {
+            const float8 x = math::detail::loadu8(&centers.x[i]);
+            const float8 y = math::detail::loadu8(&centers.y[i]);
+            const float8 z = math::detail::loadu8(&centers.z[i]);
+            const float8 negRadius = _mm256_sub_ps(zero, math::detail::loadu8(&radii[i]));
+
+            float8 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+            for (size_t p = 0; p < Frustum::eCount; ++p)
+            {
+                const float8 d = planes.distance(p, x, y, z);
+                inside = _mm256_and_ps(inside, _mm256_cmp_ps(d, negRadius, _CMP_GE_OQ));
+            }
+
+            const auto mask = static_cast<uint64_t>(_mm256_movemask_ps(inside));
+            visibility[i / kBitsPerWord] |= mask << (i % kBitsPerWord);
+        }
+    }
+#endif
+
+    cullScalar(
+        frustum, centers, i, count, [&radii](const math::vec4&, size_t idx) { return radii[idx]; },
+        visibility);
+}
+
+void cullAabbs(const Frustum& frustum, math::soa3<const float> centers,
+               math::soa3<const float> extents, std::span<uint64_t> visibility)
+{
+    const size_t count = prepareVisibility(std::min(centers.size(), extents.size()), visibility);
+    size_t i = 0;
+
+#ifdef PYROC_MATH_SIMD_AVX2
+    {
+        const Planes8 planes(frustum, false);
+        const Planes8 absPlanes(frustum, true);
+
+        for (; i + 8 <= count; i += 8)
+        {
+            const float8 x = math::detail::loadu8(&centers.x[i]);
+            const float8 y = math::detail::loadu8(&centers.y[i]);
+            const float8 z = math::detail::loadu8(&centers.z[i]);
+            const float8 ex = math::detail::loadu8(&extents.x[i]);
+            const float8 ey = math::detail::loadu8(&extents.y[i]);
+            const float8 ez = math::detail::loadu8(&extents.z[i]);
+
+            float8 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+            for (size_t p = 0; p < Frustum::eCount; ++p)
+            {
+                // distance + projected radius >= 0
+                float8 radius = _mm256_mul_ps(absPlanes.x[p], ex);
+                radius = math::detail::madd8(absPlanes.y[p], ey, radius);
+                radius = math::detail::madd8(absPlanes.z[p], ez, radius);
+
+                const float8 d = _mm256_add_ps(planes.distance(p, x, y, z), radius);
+                inside = _mm256_and_ps(inside, _mm256_cmp_ps(d, _mm256_setzero_ps(), _CMP_GE_OQ));
+            }
+
+            const auto mask = static_cast<uint64_t>(_mm256_movemask_ps(inside));
+            visibility[i / kBitsPerWord] |= mask << (i % kBitsPerWord);
+        }
+    }
+#endif
+
+    cullScalar(
+        frustum, centers, i, count,
+        [&extents](const math::vec4& plane, size_t idx)
+        {
+            return std::fabs(plane.x) * extents.x[idx] + std::fabs(plane.y) * extents.y[idx]
+                   + std::fabs(plane.z) * extents.z[idx];
+        },
+        visibility);
+}
+}  // namespace pyroc::core
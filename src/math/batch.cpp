@@ -0,0 +1,342 @@
+#include "math/batch.h"
+
+#include <algorithm>
+
+namespace pyroc::math
+{
+namespace
+{
+template <bool kTranslate>
+void transformScalar(const mat4& m, float x, float y, float z, float& outX, float& outY,
+                     float& outZ)
+{
+    float rx = m[0][0] * x + m[1][0] * y + m[2][0] * z;
+    float ry = m[0][1] * x + m[1][1] * y + m[2][1] * z;
+    float rz = m[0][2] * x + m[1][2] * y + m[2][2] * z;
+
+    if constexpr (kTranslate)
+    {
+        rx += m[3][0];
+        ry += m[3][1];
+        rz += m[3][2];
+    }
+
+    outX = rx;
+    outY = ry;
+    outZ = rz;
+}
+
+#ifdef PYROC_MATH_SIMD_AVX2
+struct Transform8
+{
+    detail::float8 m[4][3];
+
+    explicit Transform8(const mat4& mat)
+    {
+        for (size_t i = 0; i < 4; ++i)
+        {
+            for (size_t j = 0; j < 3; ++j)
+            {
+                m[i][j] = detail::splat8(mat[i][j]);
+            }
+        }
+    }
+
+    template <bool kTranslate>
+    void apply(detail::float8& x, detail::float8& y, detail::float8& z) const
+    {
+        detail::float8 rx = _mm256_mul_ps(m[0][0], x);
+        detail::float8 ry = _mm256_mul_ps(m[0][1], x);
+        detail::float8 rz = _mm256_mul_ps(m[0][2], x);
+
+        rx = detail::madd8(m[1][0], y, rx);
+        ry = detail::madd8(m[1][1], y, ry);
+        rz = detail::madd8(m[1][2], y, rz);
+
+        rx = detail::madd8(m[2][0], z, rx);
+        ry = detail::madd8(m[2][1], z, ry);
+        rz = detail::madd8(m[2][2], z, rz);
+
+        if constexpr (kTranslate)
+        {
+            rx = _mm256_add_ps(rx, m[3][0]);
+            ry = _mm256_add_ps(ry, m[3][1]);
+            rz = _mm256_add_ps(rz, m[3][2]);
+        }
+
+        x = rx;
+        y = ry;
+        z = rz;
+    }
+};
+#endif
+
+template <bool kTranslate>
+void transformAos(const mat4& m, std::span<const vec3> in, std::span<vec3> out)
+{
+    const size_t count = std::min(in.size(), out.size());
+    size_t i = 0;
+
+#ifdef PYROC_MATH_SIMD_AVX2
+    {
+        const Transform8 transform(m);
+        const float* pIn = reinterpret_cast<const float*>(in.data());
+        float* pOut = reinterpret_cast<float*>(out.data());
+
+        for (; i + 8 <= count; i += 8)
+        {
+            detail::float8 x, y, z;
+            detail::loadXyz8(pIn + i * 3, x, y, z);
+            transform.apply<kTranslate>(x, y, z);
+            detail::storeXyz8(pOut + i * 3, x, y, z);
+        }
+    }
+#endif
+
+    for (; i < count; ++i)
+    {
+        transformScalar<kTranslate>(m, in[i].x, in[i].y, in[i].z, out[i].x, out[i].y, out[i].z);
+    }
+}
+
+template <bool kTranslate>
+void transformSoa(const mat4& m, soa3<const float> in, soa3<float> out)
+{
+    const size_t count = std::min(in.size(), out.size());
+    size_t i = 0;
+
+#ifdef PYROC_MATH_SIMD_AVX2
+    {
+        const Transform8 transform(m);
+
+        for (; i + 8 <= count; i += 8)
+        {
+            detail::float8 x = detail::loadu8(&in.x[i]);
+            detail::float8 y = detail::loadu8(&in.y[i]);
+            detail::float8 z = detail::loadu8(&in.z[i]);
+            transform.apply<kTranslate>(x, y, z);
+            detail::storeu8(&out.x[i], x);
+            detail::storeu8(&out.y[i], y);
+            detail::storeu8(&out.z[i], z);
+        }
+    }
+#endif
+
+    for (; i < count; ++i)
+    {
+        transformScalar<kTranslate>(m, in.x[i], in.y[i], in.z[i], out.x[i], out.y[i], out.z[i]);
+    }
+}
+
+#ifdef PYROC_MATH_SIMD_AVX2
+// Computes two rows of lhs * rhs at once, one per 128 bit half
+inline detail::float8 mulRows2(detail::float8 l, const detail::float8 r[4])
+{
+    detail::float8 v = _mm256_mul_ps(_mm256_shuffle_ps(l, l, _MM_SHUFFLE(0, 0, 0, 0)), r[0]);
+    v = detail::madd8(_mm256_shuffle_ps(l, l, _MM_SHUFFLE(1, 1, 1, 1)), r[1], v);
+    v = detail::madd8(_mm256_shuffle_ps(l, l, _MM_SHUFFLE(2, 2, 2, 2)), r[2], v);
+    v = detail::madd8(_mm256_shuffle_ps(l, l, _MM_SHUFFLE(3, 3, 3, 3)), r[3], v);
+    return v;
+}
+
+inline void loadRows(const mat4& m, detail::float8 r[4])
+{
+    for (size_t k = 0; k < 4; ++k)
+    {
+        const __m128 row = detail::load4(m[k].data.data);
+        r[k] = _mm256_insertf128_ps(_mm256_castps128_ps256(row), row, 1);
+    }
+}
+
+inline void multiply(const mat4& lhs, const detail::float8 r[4], mat4& out)
+{
+    const detail::float8 l01 = detail::loadu8(lhs[0].data.data);
+    const detail::float8 l23 = detail::loadu8(lhs[2].data.data);
+    detail::storeu8(out[0].data.data, mulRows2(l01, r));
+    detail::storeu8(out[2].data.data, mulRows2(l23, r));
+}
+
+// Loads 8 quaternions and transposes them so each register holds one component, lanes in order
+inline void loadQuat8(const fquat* q, detail::float8& x, detail::float8& y, detail::float8& z,
+                      detail::float8& w)
+{
+    const auto load2 = [q](size_t lo)
+    {
+        return _mm256_insertf128_ps(_mm256_castps128_ps256(detail::load4(q[lo].data.data.data)),
+                                    detail::load4(q[lo + 4].data.data.data), 1);
+    };
+
+    const detail::float8 q04 = load2(0);
+    const detail::float8 q15 = load2(1);
+    const detail::float8 q26 = load2(2);
+    const detail::float8 q37 = load2(3);
+
+    const detail::float8 t0 = _mm256_unpacklo_ps(q04, q15);
+    const detail::float8 t1 = _mm256_unpackhi_ps(q04, q15);
+    const detail::float8 t2 = _mm256_unpacklo_ps(q26, q37);
+    const detail::float8 t3 = _mm256_unpackhi_ps(q26, q37);
+
+    x = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(1, 0, 1, 0));
+    y = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(3, 2, 3, 2));
+    z = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(1, 0, 1, 0));
+    w = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(3, 2, 3, 2));
+}
+
+// Transposes one SoA column (4 registers of 8 lanes) back into column col of 8 matrices
+inline void storeColumn8(mat4* out, size_t col, detail::float8 x, detail::float8 y,
+                         detail::float8 z, detail::float8 w)
+{
+    const detail::float8 t0 = _mm256_unpacklo_ps(x, y);
+    const detail::float8 t1 = _mm256_unpackhi_ps(x, y);
+    const detail::float8 t2 = _mm256_unpacklo_ps(z, w);
+    const detail::float8 t3 = _mm256_unpackhi_ps(z, w);
+
+    const detail::float8 c04 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(1, 0, 1, 0));
+    const detail::float8 c15 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(3, 2, 3, 2));
+    const detail::float8 c26 = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(1, 0, 1, 0));
+    const detail::float8 c37 = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(3, 2, 3, 2));
+
+    detail::store4(out[0][col].data.data, _mm256_castps256_ps128(c04));
+    detail::store4(out[1][col].data.data, _mm256_castps256_ps128(c15));
+    detail::store4(out[2][col].data.data, _mm256_castps256_ps128(c26));
+    detail::store4(out[3][col].data.data, _mm256_castps256_ps128(c37));
+    detail::store4(out[4][col].data.data, _mm256_extractf128_ps(c04, 1));
+    detail::store4(out[5][col].data.data, _mm256_extractf128_ps(c15, 1));
+    detail::store4(out[6][col].data.data, _mm256_extractf128_ps(c26, 1));
+    detail::store4(out[7][col].data.data, _mm256_extractf128_ps(c37, 1));
+}
+#endif
+
+void composeScalar(const fquat& q, const vec3& t, const vec3& s, mat4& out)
+{
+    out = toMat4(q);
+    for (size_t j = 0; j < 3; ++j)
+    {
+        out[0][j] *= s.x;
+        out[1][j] *= s.y;
+        out[2][j] *= s.z;
+    }
+    out[3][0] = t.x;
+    out[3][1] = t.y;
+    out[3][2] = t.z;
+}
+}  // namespace
+
+void transformPoints(const mat4& m, std::span<const vec3> in, std::span<vec3> out)
+{
+    transformAos<true>(m, in, out);
+}
+
+void transformPoints(const mat4& m, soa3<const float> in, soa3<float> out)
+{
+    transformSoa<true>(m, in, out);
+}
+
+void transformDirections(const mat4& m, std::span<const vec3> in, std::span<vec3> out)
+{
+    transformAos<false>(m, in, out);
+}
+
+void transformDirections(const mat4& m, soa3<const float> in, soa3<float> out)
+{
+    transformSoa<false>(m, in, out);
+}
+
+void multiplyMatrices(std::span<const mat4> lhs, std::span<const mat4> rhs, std::span<mat4> out)
+{
+    const size_t count = std::min({lhs.size(), rhs.size(), out.size()});
+
+    for (size_t i = 0; i < count; ++i)
+    {
+#ifdef PYROC_MATH_SIMD_AVX2
+        detail::float8 r[4];
+        loadRows(rhs[i], r);
+        multiply(lhs[i], r, out[i]);
+#else
+        out[i] = lhs[i] * rhs[i];
+#endif
+    }
+}
+
+void multiplyMatrices(std::span<const mat4> lhs, const mat4& rhs, std::span<mat4> out)
+{
+    const size_t count = std::min(lhs.size(), out.size());
+
+#ifdef PYROC_MATH_SIMD_AVX2
+    detail::float8 r[4];
+    loadRows(rhs, r);
+#endif
+
+    for (size_t i = 0; i < count; ++i)
+    {
+#ifdef PYROC_MATH_SIMD_AVX2
+        multiply(lhs[i], r, out[i]);
+#else
+        out[i] = lhs[i] * rhs;
+#endif
+    }
+}
+
+void composeTransforms(std::span<const fquat> rotations, std::span<const vec3> translations,
+                       std::span<const vec3> scales, std::span<mat4> out)
+{
+    const size_t count
+        = std::min({rotations.size(), translations.size(), scales.size(), out.size()});
+    size_t i = 0;
+
+#ifdef PYROC_MATH_SIMD_AVX2
+    {
+        const detail::float8 one = detail::splat8(1.0f);
+        const detail::float8 two = detail::splat8(2.0f);
+        const detail::float8 zero = _mm256_setzero_ps();
+        const float* pTranslations = reinterpret_cast<const float*>(translations.data());
+        const float* pScales = reinterpret_cast<const float*>(scales.data());
+
+        for (; i + 8 <= count; i += 8)
+        {
+            detail::float8 qx, qy, qz, qw;
+            loadQuat8(&rotations[i], qx, qy, qz, qw);
+
+            detail::float8 tx, ty, tz;
+            detail::loadXyz8(pTranslations + i * 3, tx, ty, tz);
+
+            detail::float8 sx, sy, sz;
+            detail::loadXyz8(pScales + i * 3, sx, sy, sz);
+
+            const detail::float8 x2 = _mm256_mul_ps(qx, two);
+            const detail::float8 y2 = _mm256_mul_ps(qy, two);
+            const detail::float8 z2 = _mm256_mul_ps(qz, two);
+
+            const detail::float8 xx = _mm256_mul_ps(qx, x2);
+            const detail::float8 yy = _mm256_mul_ps(qy, y2);
+            const detail::float8 zz = _mm256_mul_ps(qz, z2);
+            const detail::float8 xy = _mm256_mul_ps(qx, y2);
+            const detail::float8 xz = _mm256_mul_ps(qx, z2);
+            const detail::float8 yz = _mm256_mul_ps(qy, z2);
+            const detail::float8 wx = _mm256_mul_ps(qw, x2);
+            const detail::float8 wy = _mm256_mul_ps(qw, y2);
+            const detail::float8 wz = _mm256_mul_ps(qw, z2);
+
+            const auto scaled
+                = [](detail::float8 v, detail::float8 s) { return _mm256_mul_ps(v, s); };
+
+            storeColumn8(&out[i], 0, scaled(_mm256_sub_ps(one, _mm256_add_ps(yy, zz)), sx),
+                         scaled(_mm256_add_ps(xy, wz), sx), scaled(_mm256_sub_ps(xz, wy), sx),
+                         zero);
+            storeColumn8(&out[i], 1, scaled(_mm256_sub_ps(xy, wz), sy),
+                         scaled(_mm256_sub_ps(one, _mm256_add_ps(xx, zz)), sy),
+                         scaled(_mm256_add_ps(yz, wx), sy), zero);
+            storeColumn8(&out[i], 2, scaled(_mm256_add_ps(xz, wy), sz),
+                         scaled(_mm256_sub_ps(yz, wx), sz),
+                         scaled(_mm256_sub_ps(one, _mm256_add_ps(xx, yy)), sz), zero);
+            storeColumn8(&out[i], 3, tx, ty, tz, one);
+        }
+    }
+#endif
+
+    for (; i < count; ++i)
+    {
+        composeScalar(rotations[i], translations[i], scales[i], out[i]);
+    }
+}
+}  // namespace pyroc::math
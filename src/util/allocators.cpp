@@ -1,43 +1,1124 @@
+#include "util/allocators.h"
+
+#include "util/allocation_tracking.h"
+#include "util/log.h"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cassert>
 #include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <mutex>
 #include <new>
 
-void* operator new(size_t size) noexcept { return malloc(size); }
+namespace
+{
+/*
+ * Small allocations are served from thread local free lists per size class so the common case
+ * takes no lock. Lists that grow past kMaxCachedBlocks hand a batch back to a central list per
+ * class, and empty lists refill from it (or from a fresh span) a batch at a time. Spans are never
+ * returned to the system.
+ *
+ * Every block starts with a header holding its size class so the unsized operator delete can
+ * find the right list. Requests too large for a size class go straight to malloc.
+ */
+struct alignas(16) BlockHeader
+{
+    uint32_t sizeClass;
+};
+
+struct FreeBlock
+{
+    FreeBlock* next;
+};
+
+constexpr uint32_t kLargeSizeClass = ~0u;
+constexpr size_t kSizeClassGranularity = 16;
+constexpr size_t kMaxSmallBlockSize = 4096;
+constexpr size_t kSpanSize = 64 * 1024;
+constexpr uint32_t kTransferBatchSize = 32;
+constexpr uint32_t kMaxCachedBlocks = 2 * kTransferBatchSize;
+
+// Block sizes including the header, spaced at most 25% apart past 128 bytes
+constexpr uint32_t kSizeClasses[] = {
+    16,  32,  48,  64,  80,   96,   112,  128,  160,  192,  224,  256,  320,  384,
+    448, 512, 640, 768, 896,  1024, 1280, 1536, 1792, 2048, 2560, 3072, 3584, 4096,
+};
+constexpr size_t kSizeClassCount = std::size(kSizeClasses);
+
+constexpr auto kSizeClassLookup = []
+{
+    std::array<uint8_t, kMaxSmallBlockSize / kSizeClassGranularity + 1> lookup = {};
+    size_t sizeClass = 0;
+    for (size_t i = 0; i < lookup.size(); ++i)
+    {
+        while (kSizeClasses[sizeClass] < i * kSizeClassGranularity)
+        {
+            ++sizeClass;
+        }
+        lookup[i] = static_cast<uint8_t>(sizeClass);
+    }
+    return lookup;
+}();
+
+struct CentralFreeList
+{
+    std::mutex mutex;
+    FreeBlock* head = nullptr;
+};
+
+constinit CentralFreeList gCentralFreeLists[kSizeClassCount];
+
+struct ThreadCache
+{
+    FreeBlock* lists[kSizeClassCount] = {};
+    uint32_t counts[kSizeClassCount] = {};
+
+    // Set once the thread starts tearing down, later frees go to the central lists directly
+    bool destroyed = false;
+
+    ~ThreadCache();
+};
+
+constinit thread_local ThreadCache tThreadCache;
 
-void operator delete(void* p) noexcept { free(p); }
+// Links the chain first..last in front of the central list of sizeClass
+void releaseToCentral(uint32_t sizeClass, FreeBlock* first, FreeBlock* last)
+{
+    CentralFreeList& central = gCentralFreeLists[sizeClass];
+    std::lock_guard<std::mutex> lock(central.mutex);
+    last->next = central.head;
+    central.head = first;
+}
+
+ThreadCache::~ThreadCache()
+{
+    destroyed = true;
+    for (uint32_t sizeClass = 0; sizeClass < kSizeClassCount; ++sizeClass)
+    {
+        FreeBlock* first = lists[sizeClass];
+        if (first == nullptr)
+        {
+            continue;
+        }
+
+        FreeBlock* last = first;
+        while (last->next != nullptr)
+        {
+            last = last->next;
+        }
+
+        releaseToCentral(sizeClass, first, last);
+        lists[sizeClass] = nullptr;
+        counts[sizeClass] = 0;
+    }
+}
+
+bool refillThreadCache(ThreadCache& cache, uint32_t sizeClass)
+{
+    {
+        CentralFreeList& central = gCentralFreeLists[sizeClass];
+        std::lock_guard<std::mutex> lock(central.mutex);
+        if (central.head != nullptr)
+        {
+            FreeBlock* first = central.head;
+            FreeBlock* last = first;
+            uint32_t count = 1;
+            while (count < kTransferBatchSize && last->next != nullptr)
+            {
+                last = last->next;
+                ++count;
+            }
+
+            central.head = last->next;
+            last->next = nullptr;
+            cache.lists[sizeClass] = first;
+            cache.counts[sizeClass] = count;
+            return true;
+        }
+    }
+
+    // Central list is empty, carve a new span into blocks for this thread
+    auto* span = static_cast<std::byte*>(malloc(kSpanSize));
+    if (span == nullptr)
+    {
+        return false;
+    }
+
+    const size_t blockSize = kSizeClasses[sizeClass];
+    const auto count = static_cast<uint32_t>(kSpanSize / blockSize);
+    FreeBlock* head = nullptr;
+    for (uint32_t i = count; i-- > 0;)
+    {
+        auto* block = reinterpret_cast<FreeBlock*>(span + i * blockSize);
+        block->next = head;
+        head = block;
+    }
+
+    cache.lists[sizeClass] = head;
+    cache.counts[sizeClass] = count;
+    return true;
+}
+
+// Hands the first kTransferBatchSize cached blocks back to the central list
+void flushThreadCache(ThreadCache& cache, uint32_t sizeClass)
+{
+    FreeBlock* first = cache.lists[sizeClass];
+    FreeBlock* last = first;
+    for (uint32_t i = 1; i < kTransferBatchSize; ++i)
+    {
+        last = last->next;
+    }
+
+    cache.lists[sizeClass] = last->next;
+    cache.counts[sizeClass] -= kTransferBatchSize;
+    releaseToCentral(sizeClass, first, last);
+}
 
-void operator delete(void* p, size_t) noexcept { operator delete(p); }
+void* cachedAllocate(size_t size)
+{
+    ThreadCache& cache = tThreadCache;
+    if (size > kMaxSmallBlockSize - sizeof(BlockHeader) || cache.destroyed)
+    {
+        auto* header = static_cast<BlockHeader*>(malloc(sizeof(BlockHeader) + size));
+        if (header == nullptr)
+        {
+            return nullptr;
+        }
+
+        header->sizeClass = kLargeSizeClass;
+        return header + 1;
+    }
+
+    const size_t blockSize = sizeof(BlockHeader) + size;
+    const uint32_t sizeClass
+        = kSizeClassLookup[(blockSize + kSizeClassGranularity - 1) / kSizeClassGranularity];
+
+    if (cache.lists[sizeClass] == nullptr && !refillThreadCache(cache, sizeClass))
+    {
+        return nullptr;
+    }
+
+    FreeBlock* block = cache.lists[sizeClass];
+    cache.lists[sizeClass] = block->next;
+    --cache.counts[sizeClass];
+
+    auto* header = reinterpret_cast<BlockHeader*>(block);
+    header->sizeClass = sizeClass;
+    return header + 1;
+}
+
+void cachedFree(void* p)
+{
+    if (p == nullptr)
+    {
+        return;
+    }
+
+    BlockHeader* header = static_cast<BlockHeader*>(p) - 1;
+    const uint32_t sizeClass = header->sizeClass;
+    if (sizeClass == kLargeSizeClass)
+    {
+        free(header);
+        return;
+    }
+
+    auto* block = reinterpret_cast<FreeBlock*>(header);
+    ThreadCache& cache = tThreadCache;
+    if (cache.destroyed)
+    {
+        releaseToCentral(sizeClass, block, block);
+        return;
+    }
+
+    block->next = cache.lists[sizeClass];
+    cache.lists[sizeClass] = block;
+    if (++cache.counts[sizeClass] > kMaxCachedBlocks)
+    {
+        flushThreadCache(cache, sizeClass);
+    }
+}
+
+#ifdef PYROC_TRACK_ALLOCATIONS
+using pyroc::util::AllocationCallSite;
+using pyroc::util::AllocationStats;
+
+/*
+ * Tracked allocations carry a header recording their size and tag so frees can be attributed
+ * without a lookup. It keeps the 16 byte alignment of the blocks underneath.
+ */
+struct alignas(16) AllocationHeader
+{
+    size_t size;
+    uint32_t tag;
+};
+
+constexpr size_t kMaxAllocationTags = 64;
+constexpr size_t kMaxAllocationCallSites = 1024;
+constexpr uint32_t kUntagged = 0;
+
+struct AllocationTag
+{
+    const char* name = nullptr;
+    AllocationStats stats;
+};
+
+/*
+ * Fixed size so recording never allocates itself, constant initialized so it is usable by
+ * allocations made before main
+ */
+struct AllocationTracker
+{
+    std::mutex mutex;
+
+    AllocationStats total;
+    AllocationStats currentFrame;
+    AllocationStats lastFrame;
+
+    AllocationTag tags[kMaxAllocationTags] = {{.name = "untagged", .stats = {}}};
+    size_t tagCount = 1;
+
+    AllocationCallSite callSites[kMaxAllocationCallSites];
+    uint64_t violations = 0;
+};
+
+constinit AllocationTracker gTracker;
+
+thread_local const char* tAllocationTag = nullptr;
+thread_local uint32_t tNoAllocationDepth = 0;
+
+#define PYROC_STRINGIFY_IMPL(x) #x
+#define PYROC_STRINGIFY(x) PYROC_STRINGIFY_IMPL(x)
+
+void addAllocation(AllocationStats& stats, size_t size)
+{
+    ++stats.allocations;
+    stats.bytesAllocated += size;
+    stats.currentBytes += size;
+    stats.peakBytes = std::max(stats.peakBytes, stats.currentBytes);
+}
+
+void addFree(AllocationStats& stats, size_t size)
+{
+    ++stats.frees;
+    stats.bytesFreed += size;
+    stats.currentBytes -= std::min<uint64_t>(stats.currentBytes, size);
+}
+
+// Must be called with the tracker locked
+uint32_t findAllocationTag(const char* name)
+{
+    if (name == nullptr)
+    {
+        return kUntagged;
+    }
+
+    for (size_t i = 1; i < gTracker.tagCount; ++i)
+    {
+        if (gTracker.tags[i].name == name || std::strcmp(gTracker.tags[i].name, name) == 0)
+        {
+            return static_cast<uint32_t>(i);
+        }
+    }
+
+    if (gTracker.tagCount == kMaxAllocationTags)
+    {
+        return kUntagged;
+    }
+
+    gTracker.tags[gTracker.tagCount].name = name;
+    return static_cast<uint32_t>(gTracker.tagCount++);
+}
+
+// Must be called with the tracker locked, open addressing on the return address
+void recordCallSite(const void* caller, size_t size)
+{
+    size_t index = std::hash<const void*>{}(caller) % kMaxAllocationCallSites;
+    for (size_t probe = 0; probe < kMaxAllocationCallSites; ++probe)
+    {
+        AllocationCallSite& site = gTracker.callSites[index];
+        if (site.address == caller || site.address == nullptr)
+        {
+            site.address = caller;
+            ++site.allocations;
+            site.bytes += size;
+            return;
+        }
+        index = (index + 1) % kMaxAllocationCallSites;
+    }
+}
+
+uint32_t trackAllocation(size_t size, const void* caller)
+{
+    uint32_t tag = kUntagged;
+    {
+        std::lock_guard<std::mutex> lock(gTracker.mutex);
+        tag = findAllocationTag(tAllocationTag);
+
+        addAllocation(gTracker.total, size);
+        addAllocation(gTracker.currentFrame, size);
+        addAllocation(gTracker.tags[tag].stats, size);
+        recordCallSite(caller, size);
+
+        if (tNoAllocationDepth > 0)
+        {
+            ++gTracker.violations;
+        }
+    }
+
+    if (tNoAllocationDepth > 0)
+    {
+        pyroc::util::logCategory(pyroc::util::LogLevel::Error, __FILE__, PYROC_STRINGIFY(__LINE__),
+                                 "Allocation of %zu bytes inside a no-allocation scope from %p",
+                                 size, caller);
+        assert(!"Allocation inside a no-allocation scope");
+    }
+
+    return tag;
+}
+
+void trackFree(size_t size, uint32_t tag)
+{
+    std::lock_guard<std::mutex> lock(gTracker.mutex);
+    addFree(gTracker.total, size);
+    addFree(gTracker.currentFrame, size);
+    addFree(gTracker.tags[tag].stats, size);
+}
+
+void* allocate(size_t size, const void* caller)
+{
+    auto* header = static_cast<AllocationHeader*>(cachedAllocate(sizeof(AllocationHeader) + size));
+    if (header == nullptr)
+    {
+        return nullptr;
+    }
+
+    header->size = size;
+    header->tag = trackAllocation(size, caller);
+    return header + 1;
+}
+
+void deallocate(void* p)
+{
+    if (p == nullptr)
+    {
+        return;
+    }
+
+    AllocationHeader* header = static_cast<AllocationHeader*>(p) - 1;
+    trackFree(header->size, header->tag);
+    cachedFree(header);
+}
+#else
+void* allocate(size_t size, const void*) { return cachedAllocate(size); }
+
+void deallocate(void* p) { cachedFree(p); }
+#endif
+}  // namespace
+
+void* operator new(size_t size) noexcept { return allocate(size, __builtin_return_address(0)); }
+
+void operator delete(void* p) noexcept { deallocate(p); }
+
+void operator delete(void* p, size_t) noexcept { deallocate(p); }
 
 void* operator new[](size_t size) noexcept
 {
-    return operator new(size);  // Same as regular new
+    return allocate(size, __builtin_return_address(0));  // Same as regular new
 }
 
 void operator delete[](void* p) noexcept
 {
-    operator delete(p);  // Same as regular delete
+    deallocate(p);  // Same as regular delete
 }
 
 void operator delete[](void* p, size_t) noexcept
 {
-    operator delete(p);  // Same as regular delete
+    deallocate(p);  // Same as regular delete
 }
 
 void* operator new(size_t size, std::nothrow_t) noexcept
 {
-    return operator new(size);  // Same as regular new
+    return allocate(size, __builtin_return_address(0));  // Same as regular new
 }
 
 void operator delete(void* p, std::nothrow_t) noexcept
 {
-    operator delete(p);  // Same as regular delete
+    deallocate(p);  // Same as regular delete
 }
 
 void* operator new[](size_t size, std::nothrow_t) noexcept
 {
-    return operator new(size);  // Same as regular new
+    return allocate(size, __builtin_return_address(0));  // Same as regular new
 }
 
 void operator delete[](void* p, std::nothrow_t) noexcept
 {
-    operator delete(p);  // Same as regular delete
-}
\ No newline at end of file
+    deallocate(p);  // Same as regular delete
+}
+
+#ifdef PYROC_TRACK_ALLOCATIONS
+namespace pyroc::util
+{
+void beginAllocationFrame()
+{
+    std::lock_guard<std::mutex> lock(gTracker.mutex);
+    gTracker.lastFrame = gTracker.currentFrame;
+    gTracker.currentFrame = {};
+}
+
+AllocationStats totalAllocationStats()
+{
+    std::lock_guard<std::mutex> lock(gTracker.mutex);
+    return gTracker.total;
+}
+
+AllocationStats currentFrameAllocationStats()
+{
+    std::lock_guard<std::mutex> lock(gTracker.mutex);
+    return gTracker.currentFrame;
+}
+
+AllocationStats lastFrameAllocationStats()
+{
+    std::lock_guard<std::mutex> lock(gTracker.mutex);
+    return gTracker.lastFrame;
+}
+
+AllocationStats taggedAllocationStats(const char* tag)
+{
+    std::lock_guard<std::mutex> lock(gTracker.mutex);
+    for (size_t i = 1; i < gTracker.tagCount; ++i)
+    {
+        if (gTracker.tags[i].name == tag || std::strcmp(gTracker.tags[i].name, tag) == 0)
+        {
+            return gTracker.tags[i].stats;
+        }
+    }
+    return {};
+}
+
+uint64_t allocationViolations()
+{
+    std::lock_guard<std::mutex> lock(gTracker.mutex);
+    return gTracker.violations;
+}
+
+size_t hotAllocationCallSites(std::span<AllocationCallSite> out)
+{
+    const auto busier = [](const AllocationCallSite& lhs, const AllocationCallSite& rhs)
+    { return lhs.allocations > rhs.allocations; };
+
+    size_t count = 0;
+    {
+        std::lock_guard<std::mutex> lock(gTracker.mutex);
+        for (const AllocationCallSite& site : gTracker.callSites)
+        {
+            if (site.address == nullptr)
+            {
+                continue;
+            }
+
+            // Keep out as a min-heap of the busiest sites seen so far
+            if (count < out.size())
+            {
+                out[count++] = site;
+                std::push_heap(out.begin(), out.begin() + static_cast<ptrdiff_t>(count), busier);
+            }
+            else if (count > 0 && busier(site, out.front()))
+            {
+                std::pop_heap(out.begin(), out.end(), busier);
+                out.back() = site;
+                std::push_heap(out.begin(), out.end(), busier);
+            }
+        }
+    }
+
+    std::sort_heap(out.begin(), out.begin() + static_cast<ptrdiff_t>(count), busier);
+    return count;
+}
+
+void logAllocationStats()
+{
+    const AllocationStats total = totalAllocationStats();
+    const AllocationStats frame = lastFrameAllocationStats();
+
+    LOG_DEBUG("Allocations: %llu total, %llu live bytes, %llu peak bytes",
+              static_cast<unsigned long long>(total.allocations),
+              static_cast<unsigned long long>(total.currentBytes),
+              static_cast<unsigned long long>(total.peakBytes));
+    LOG_DEBUG("Last frame: %llu allocations, %llu bytes, %llu violations",
+              static_cast<unsigned long long>(frame.allocations),
+              static_cast<unsigned long long>(frame.bytesAllocated),
+              static_cast<unsigned long long>(allocationViolations()));
+
+    AllocationTag tags[kMaxAllocationTags];
+    size_t tagCount = 0;
+    {
+        std::lock_guard<std::mutex> lock(gTracker.mutex);
+        tagCount = gTracker.tagCount;
+        std::copy_n(gTracker.tags, tagCount, tags);
+    }
+
+    for (size_t i = 0; i < tagCount; ++i)
+    {
+        LOG_DEBUG("  [%s] %llu allocations, %llu bytes, %llu live bytes", tags[i].name,
+                  static_cast<unsigned long long>(tags[i].stats.allocations),
+                  static_cast<unsigned long long>(tags[i].stats.bytesAllocated),
+                  static_cast<unsigned long long>(tags[i].stats.currentBytes));
+    }
+
+    AllocationCallSite sites[8];
+    const size_t siteCount = hotAllocationCallSites(sites);
+    for (size_t i = 0; i < siteCount; ++i)
+    {
+        LOG_DEBUG("  %p: %llu allocations, %llu bytes", sites[i].address,
+                  static_cast<unsigned long long>(sites[i].allocations),
+                  static_cast<unsigned long long>(sites[i].bytes));
+    }
+}
+
+ScopedAllocationTag::ScopedAllocationTag(const char* tag) : mPrevious(tAllocationTag)
+{
+    tAllocationTag = tag;
+}
+
+ScopedAllocationTag::~ScopedAllocationTag() { tAllocationTag = mPrevious; }
+
+NoAllocationScope::NoAllocationScope() { ++tNoAllocationDepth; }
+
+NoAllocationScope::~NoAllocationScope() { --tNoAllocationDepth; }
+}  // namespace pyroc::util
+#endif
+
+namespace pyroc::util
+{
+namespace
+{
+size_t alignUp(size_t value, size_t alignment)
+{
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+
+std::byte* alignUp(std::byte* p, size_t alignment)
+{
+    return reinterpret_cast<std::byte*>(alignUp(reinterpret_cast<uintptr_t>(p), alignment));
+}
+
+/*
+ * Aligned allocation on top of malloc, for overflow requests and for the resources' own blocks.
+ * std::aligned_alloc is missing from the MSVC runtime, so the raw malloc pointer is stored in
+ * front of the aligned block instead and arbitrary alignments can be released again.
+ */
+void* overflowAllocate(size_t bytes, size_t alignment)
+{
+    alignment = std::max(alignment, alignof(void*));
+    auto* raw = static_cast<std::byte*>(malloc(bytes + alignment + sizeof(void*)));
+    if (raw == nullptr)
+    {
+        return nullptr;
+    }
+
+    std::byte* aligned = alignUp(raw + sizeof(void*), alignment);
+    std::memcpy(aligned - sizeof(void*), &raw, sizeof(void*));
+    return aligned;
+}
+
+void overflowDeallocate(void* p)
+{
+    void* raw = nullptr;
+    std::memcpy(&raw, static_cast<std::byte*>(p) - sizeof(void*), sizeof(void*));
+    free(raw);
+}
+}  // namespace
+
+bool LinearArena::init(size_t capacity)
+{
+    mBuffer = static_cast<std::byte*>(malloc(capacity));
+    if (mBuffer == nullptr)
+    {
+        return false;
+    }
+
+    mCapacity = capacity;
+    reset();
+    mPeak = 0;
+    return true;
+}
+
+void LinearArena::destroy()
+{
+    reset();
+    free(mBuffer);
+    mBuffer = nullptr;
+    mCapacity = 0;
+}
+
+void LinearArena::reset()
+{
+    while (mOverflow != nullptr)
+    {
+        Overflow* next = mOverflow->next;
+        overflowDeallocate(mOverflow);
+        mOverflow = next;
+    }
+
+    mOffset = 0;
+    mOverflowBytes = 0;
+}
+
+void* LinearArena::do_allocate(size_t bytes, size_t alignment)
+{
+    const size_t begin = static_cast<size_t>(alignUp(mBuffer + mOffset, alignment) - mBuffer);
+    if (begin + bytes <= mCapacity)
+    {
+        mOffset = begin + bytes;
+        mPeak = std::max(mPeak, mOffset);
+        return mBuffer + begin;
+    }
+
+    // Out of space, chain a separate block that lives until the next reset
+    const size_t headerSize = alignUp(sizeof(Overflow), alignment);
+    auto* block = static_cast<std::byte*>(
+        overflowAllocate(headerSize + bytes, std::max(alignment, alignof(Overflow))));
+    if (block == nullptr)
+    {
+        return nullptr;
+    }
+
+    auto* overflow = reinterpret_cast<Overflow*>(block);
+    overflow->next = mOverflow;
+    mOverflow = overflow;
+    mOverflowBytes += bytes;
+    return block + headerSize;
+}
+
+void LinearArena::do_deallocate(void*, size_t, size_t) {}
+
+bool LinearArena::do_is_equal(const std::pmr::memory_resource& other) const noexcept
+{
+    return this == &other;
+}
+
+bool PoolResource::init(size_t blockSize, size_t blockAlignment, size_t blocksPerChunk)
+{
+    mBlockAlignment = std::max(blockAlignment, alignof(FreeBlock));
+    mBlockSize = alignUp(std::max(blockSize, sizeof(FreeBlock)), mBlockAlignment);
+    mBlocksPerChunk = std::max(blocksPerChunk, size_t{1});
+    mChunkHeaderSize = alignUp(sizeof(Chunk), mBlockAlignment);
+    return grow();
+}
+
+void PoolResource::destroy()
+{
+    while (mChunks != nullptr)
+    {
+        Chunk* next = mChunks->next;
+        overflowDeallocate(mChunks);
+        mChunks = next;
+    }
+
+    mFreeList = nullptr;
+    mBlocksInUse = 0;
+    mBlocksReserved = 0;
+    mOverflowBytes = 0;
+}
+
+bool PoolResource::grow()
+{
+    const size_t alignment = std::max(mBlockAlignment, alignof(Chunk));
+    const size_t size = mChunkHeaderSize + mBlockSize * mBlocksPerChunk;
+    auto* memory = static_cast<std::byte*>(overflowAllocate(size, alignment));
+    if (memory == nullptr)
+    {
+        return false;
+    }
+
+    auto* chunk = reinterpret_cast<Chunk*>(memory);
+    chunk->next = mChunks;
+    mChunks = chunk;
+
+    // Thread the new blocks onto the free list back to front so they are handed out in order
+    std::byte* blocks = memory + mChunkHeaderSize;
+    for (size_t i = mBlocksPerChunk; i-- > 0;)
+    {
+        auto* block = reinterpret_cast<FreeBlock*>(blocks + i * mBlockSize);
+        block->next = mFreeList;
+        mFreeList = block;
+    }
+
+    mBlocksReserved += mBlocksPerChunk;
+    return true;
+}
+
+void* PoolResource::do_allocate(size_t bytes, size_t alignment)
+{
+    if (bytes > mBlockSize || alignment > mBlockAlignment)
+    {
+        mOverflowBytes += bytes;
+        return overflowAllocate(bytes, alignment);
+    }
+
+    if (mFreeList == nullptr && !grow())
+    {
+        return nullptr;
+    }
+
+    FreeBlock* block = mFreeList;
+    mFreeList = block->next;
+    ++mBlocksInUse;
+    return block;
+}
+
+void PoolResource::do_deallocate(void* p, size_t bytes, size_t alignment)
+{
+    if (p == nullptr)
+    {
+        return;
+    }
+
+    if (bytes > mBlockSize || alignment > mBlockAlignment)
+    {
+        overflowDeallocate(p);
+        return;
+    }
+
+    auto* block = static_cast<FreeBlock*>(p);
+    block->next = mFreeList;
+    mFreeList = block;
+    --mBlocksInUse;
+}
+
+bool PoolResource::do_is_equal(const std::pmr::memory_resource& other) const noexcept
+{
+    return this == &other;
+}
+
+/*
+ * Every block starts with a header; the payload follows it and the next physical block follows
+ * the payload. Free blocks keep their free list links in the payload. Sizes are multiples of the
+ * alignment so the two low bits of size hold the flags.
+ */
+struct TlsfHeap::Block
+{
+    static constexpr size_t kFreeBit = 1;
+    static constexpr size_t kPrevFreeBit = 2;
+    static constexpr size_t kFlagMask = kFreeBit | kPrevFreeBit;
+
+    Block* prevPhys;  // Only valid when the previous block is free
+    size_t sizeAndFlags;
+
+    // Payload, first bytes overlap the free list links
+    Block* nextFree;
+    Block* prevFree;
+
+    size_t size() const { return sizeAndFlags & ~kFlagMask; }
+    void setSize(size_t size) { sizeAndFlags = size | (sizeAndFlags & kFlagMask); }
+
+    bool isFree() const { return (sizeAndFlags & kFreeBit) != 0; }
+    void setFree(bool free)
+    {
+        sizeAndFlags = free ? sizeAndFlags | kFreeBit : sizeAndFlags & ~kFreeBit;
+    }
+
+    bool isPrevFree() const { return (sizeAndFlags & kPrevFreeBit) != 0; }
+    void setPrevFree(bool free)
+    {
+        sizeAndFlags = free ? sizeAndFlags | kPrevFreeBit : sizeAndFlags & ~kPrevFreeBit;
+    }
+
+    std::byte* payload() { return reinterpret_cast<std::byte*>(this) + kHeaderSize; }
+    Block* nextPhys() { return reinterpret_cast<Block*>(payload() + size()); }
+
+    static Block* fromPayload(void* p)
+    {
+        return reinterpret_cast<Block*>(static_cast<std::byte*>(p) - kHeaderSize);
+    }
+
+    static constexpr size_t kAlignment = size_t{1} << kAlignSizeLog2;
+    static constexpr size_t kHeaderSize = 16;
+    static constexpr size_t kMinPayloadSize = 16;
+    static constexpr size_t kSmallBlockSize = size_t{1} << kFlIndexShift;
+};
+
+struct TlsfHeap::Pool
+{
+    Pool* next;
+    size_t size;
+};
+
+namespace
+{
+struct TlsfMapping
+{
+    uint32_t fl;
+    uint32_t sl;
+};
+
+template <uint32_t SlLog2, uint32_t FlShift>
+TlsfMapping tlsfMappingInsert(size_t size)
+{
+    constexpr size_t smallBlockSize = size_t{1} << FlShift;
+    if (size < smallBlockSize)
+    {
+        return {.fl = 0, .sl = static_cast<uint32_t>(size / (smallBlockSize >> SlLog2))};
+    }
+
+    const auto fl = static_cast<uint32_t>(std::bit_width(size) - 1);
+    const auto sl = static_cast<uint32_t>((size >> (fl - SlLog2)) ^ (size_t{1} << SlLog2));
+    return {.fl = fl - (FlShift - 1), .sl = sl};
+}
+}  // namespace
+
+bool TlsfHeap::init(size_t poolSize)
+{
+    static_assert(offsetof(Block, nextFree) == Block::kHeaderSize);
+    static_assert(sizeof(Pool) % Block::kAlignment == 0);
+
+    mPoolSize = poolSize;
+    return addPool(poolSize);
+}
+
+void TlsfHeap::destroy()
+{
+    while (mPools != nullptr)
+    {
+        Pool* next = mPools->next;
+        overflowDeallocate(mPools);
+        mPools = next;
+    }
+
+    mFlBitmap = 0;
+    std::fill(std::begin(mSlBitmap), std::end(mSlBitmap), 0u);
+    for (auto& lists : mFreeBlocks)
+    {
+        std::fill(std::begin(lists), std::end(lists), nullptr);
+    }
+
+    mCapacity = 0;
+    mUsed = 0;
+}
+
+bool TlsfHeap::addPool(size_t size)
+{
+    // Pool header, one free block spanning the pool and a zero sized sentinel block at the end
+    const size_t payloadSize = alignUp(std::max(size, Block::kMinPayloadSize), Block::kAlignment);
+    const size_t totalSize = sizeof(Pool) + Block::kHeaderSize + payloadSize + Block::kHeaderSize;
+    if (payloadSize >= (size_t{1} << kFlIndexMax))
+    {
+        return false;
+    }
+
+    auto* memory = static_cast<std::byte*>(overflowAllocate(totalSize, Block::kAlignment));
+    if (memory == nullptr)
+    {
+        return false;
+    }
+
+    auto* pool = reinterpret_cast<Pool*>(memory);
+    pool->next = mPools;
+    pool->size = totalSize;
+    mPools = pool;
+
+    auto* block = reinterpret_cast<Block*>(memory + sizeof(Pool));
+    block->prevPhys = nullptr;
+    block->sizeAndFlags = payloadSize;
+    block->setFree(true);
+
+    Block* sentinel = block->nextPhys();
+    sentinel->prevPhys = block;
+    sentinel->sizeAndFlags = 0;
+    sentinel->setPrevFree(true);
+
+    insertFreeBlock(block);
+    mCapacity += payloadSize;
+    return true;
+}
+
+void TlsfHeap::insertFreeBlock(Block* block)
+{
+    const TlsfMapping m = tlsfMappingInsert<kSlIndexCountLog2, kFlIndexShift>(block->size());
+
+    Block* head = mFreeBlocks[m.fl][m.sl];
+    block->nextFree = head;
+    block->prevFree = nullptr;
+    if (head != nullptr)
+    {
+        head->prevFree = block;
+    }
+
+    mFreeBlocks[m.fl][m.sl] = block;
+    mFlBitmap |= uint64_t{1} << m.fl;
+    mSlBitmap[m.fl] |= 1u << m.sl;
+}
+
+void TlsfHeap::removeFreeBlock(Block* block)
+{
+    const TlsfMapping m = tlsfMappingInsert<kSlIndexCountLog2, kFlIndexShift>(block->size());
+
+    if (block->nextFree != nullptr)
+    {
+        block->nextFree->prevFree = block->prevFree;
+    }
+    if (block->prevFree != nullptr)
+    {
+        block->prevFree->nextFree = block->nextFree;
+    }
+
+    if (mFreeBlocks[m.fl][m.sl] == block)
+    {
+        mFreeBlocks[m.fl][m.sl] = block->nextFree;
+        if (block->nextFree == nullptr)
+        {
+            mSlBitmap[m.fl] &= ~(1u << m.sl);
+            if (mSlBitmap[m.fl] == 0)
+            {
+                mFlBitmap &= ~(uint64_t{1} << m.fl);
+            }
+        }
+    }
+}
+
+TlsfHeap::Block* TlsfHeap::findFreeBlock(size_t size)
+{
+    // Round up to the next list so any block found is large enough
+    if (size >= Block::kSmallBlockSize)
+    {
+        size += (size_t{1} << (std::bit_width(size) - 1 - kSlIndexCountLog2)) - 1;
+    }
+
+    TlsfMapping m = tlsfMappingInsert<kSlIndexCountLog2, kFlIndexShift>(size);
+    if (m.fl >= kFlIndexCount)
+    {
+        return nullptr;
+    }
+
+    uint32_t slMap = m.sl < kSlIndexCount ? mSlBitmap[m.fl] & (~0u << m.sl) : 0;
+    if (slMap == 0)
+    {
+        const uint64_t flMap = m.fl + 1 < 64 ? mFlBitmap & (~uint64_t{0} << (m.fl + 1)) : 0;
+        if (flMap == 0)
+        {
+            return nullptr;
+        }
+
+        m.fl = static_cast<uint32_t>(std::countr_zero(flMap));
+        slMap = mSlBitmap[m.fl];
+    }
+
+    m.sl = static_cast<uint32_t>(std::countr_zero(slMap));
+    return mFreeBlocks[m.fl][m.sl];
+}
+
+void* TlsfHeap::allocateBlock(size_t bytes)
+{
+    const size_t size = alignUp(std::max(bytes, Block::kMinPayloadSize), Block::kAlignment);
+
+    Block* block = findFreeBlock(size);
+    if (block == nullptr)
+    {
+        if (!addPool(std::max(mPoolSize, size * 2)) || (block = findFreeBlock(size)) == nullptr)
+        {
+            return nullptr;
+        }
+    }
+
+    removeFreeBlock(block);
+
+    // Split off the tail when it can hold another block
+    if (block->size() >= size + Block::kHeaderSize + Block::kMinPayloadSize)
+    {
+        auto* remaining = reinterpret_cast<Block*>(block->payload() + size);
+        remaining->sizeAndFlags = block->size() - size - Block::kHeaderSize;
+        remaining->setFree(true);
+        remaining->prevPhys = block;
+
+        Block* next = remaining->nextPhys();
+        next->prevPhys = remaining;
+        next->setPrevFree(true);
+
+        block->setSize(size);
+        insertFreeBlock(remaining);
+    }
+    else
+    {
+        block->nextPhys()->setPrevFree(false);
+    }
+
+    block->setFree(false);
+
+    mUsed += block->size();
+    mPeak = std::max(mPeak, mUsed);
+    return block->payload();
+}
+
+void TlsfHeap::freeBlock(void* p)
+{
+    Block* block = Block::fromPayload(p);
+    mUsed -= block->size();
+    block->setFree(true);
+
+    if (block->isPrevFree())
+    {
+        Block* prev = block->prevPhys;
+        removeFreeBlock(prev);
+        prev->setSize(prev->size() + Block::kHeaderSize + block->size());
+        block = prev;
+    }
+
+    Block* next = block->nextPhys();
+    if (next->isFree())
+    {
+        removeFreeBlock(next);
+        block->setSize(block->size() + Block::kHeaderSize + next->size());
+        next = block->nextPhys();
+    }
+
+    next->prevPhys = block;
+    next->setPrevFree(true);
+    insertFreeBlock(block);
+}
+
+void* TlsfHeap::do_allocate(size_t bytes, size_t alignment)
+{
+    if (alignment <= Block::kAlignment)
+    {
+        return allocateBlock(bytes);
+    }
+
+    // Over-aligned, over-allocate and keep the block payload just in front of the aligned pointer
+    auto* raw = static_cast<std::byte*>(allocateBlock(bytes + alignment));
+    if (raw == nullptr)
+    {
+        return nullptr;
+    }
+
+    std::byte* aligned = alignUp(raw + sizeof(void*), alignment);
+    std::memcpy(aligned - sizeof(void*), &raw, sizeof(void*));
+    return aligned;
+}
+
+void TlsfHeap::do_deallocate(void* p, size_t, size_t alignment)
+{
+    if (p == nullptr)
+    {
+        return;
+    }
+
+    if (alignment > Block::kAlignment)
+    {
+        void* raw = nullptr;
+        std::memcpy(&raw, static_cast<std::byte*>(p) - sizeof(void*), sizeof(void*));
+        p = raw;
+    }
+
+    freeBlock(p);
+}
+
+bool TlsfHeap::do_is_equal(const std::pmr::memory_resource& other) const noexcept
+{
+    return this == &other;
+}
+}  // namespace pyroc::util
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace pyroc::util
+{
+constexpr uint64_t kFnvOffsetBasis = 0xcbf29ce484222325ull;
+
+// 64 bit FNV-1a, pass the previous result as seed to hash discontiguous data
+constexpr uint64_t hashBytes(const void* pData, size_t size, uint64_t seed = kFnvOffsetBasis)
+{
+    const auto* pBytes = static_cast<const uint8_t*>(pData);
+
+    uint64_t hash = seed;
+    for (size_t i = 0; i < size; ++i)
+    {
+        hash = (hash ^ pBytes[i]) * 0x100000001b3ull;
+    }
+    return hash;
+}
+}  // namespace pyroc::util
@@ -0,0 +1,125 @@
+#include "util/mapped_file.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace pyroc::util
+{
+#ifdef _WIN32
+
+bool MappedFile::open(const char* path)
+{
+    close();
+
+    HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                              FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        return false;
+    }
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size) || size.QuadPart == 0)
+    {
+        CloseHandle(file);
+        return false;
+    }
+
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!mapping)
+    {
+        CloseHandle(file);
+        return false;
+    }
+
+    const void* pData = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (!pData)
+    {
+        CloseHandle(mapping);
+        CloseHandle(file);
+        return false;
+    }
+
+    mFile = file;
+    mMapping = mapping;
+    mData = pData;
+    mSize = static_cast<size_t>(size.QuadPart);
+
+    return true;
+}
+
+void MappedFile::close()
+{
+    if (mData)
+    {
+        UnmapViewOfFile(mData);
+        CloseHandle(mMapping);
+        CloseHandle(mFile);
+    }
+
+    mFile = nullptr;
+    mMapping = nullptr;
+    mData = nullptr;
+    mSize = 0;
+}
+
+#else
+
+bool MappedFile::open(const char* path)
+{
+    close();
+
+    const int fd = ::open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+    {
+        return false;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size <= 0)
+    {
+        ::close(fd);
+        return false;
+    }
+
+    const auto size = static_cast<size_t>(st.st_size);
+    void* pData = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+    // The mapping keeps the file referenced
+    ::close(fd);
+
+    if (pData == MAP_FAILED)
+    {
+        return false;
+    }
+
+    // Everything mapped is about to be read in full
+    madvise(pData, size, MADV_WILLNEED);
+
+    mData = pData;
+    mSize = size;
+
+    return true;
+}
+
+void MappedFile::close()
+{
+    if (mData)
+    {
+        munmap(const_cast<void*>(mData), mSize);
+    }
+
+    mData = nullptr;
+    mSize = 0;
+}
+
+#endif
+}  // namespace pyroc::util
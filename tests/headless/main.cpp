@@ -0,0 +1,202 @@
+/*
+ * Smoke test for headless rendering: clears a small RenderTarget on a headless context, reads it
+ * back and checks the texels. Exits with kSkipped when no Vulkan device is available, so machines
+ * without one report the test as skipped rather than failed.
+ */
+
+#include "pyroc.h"
+
+#include <array>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+using namespace pyroc::backend::vulkan;
+
+namespace
+{
+constexpr int kSkipped = 77;
+
+constexpr vk::Extent2D kExtent = {.width = 16, .height = 16};
+
+// Red after the UNORM conversion, byte order follows eR8G8B8A8Unorm
+constexpr std::array<float, 4> kClearColor = {1.0f, 0.0f, 0.0f, 1.0f};
+constexpr std::array<uint8_t, 4> kExpectedTexel = {255, 0, 0, 255};
+
+vk::Result recordClear(vk::CommandBuffer cmdBuf, const RenderTarget& target)
+{
+    {
+        const vk::CommandBufferBeginInfo beginInfo = {
+            .flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit,
+        };
+
+        const auto res = cmdBuf.begin(beginInfo);
+        if (res != vk::Result::eSuccess)
+        {
+            return res;
+        }
+    }
+
+    const vk::ClearValue clearValue = {.color = vk::ClearColorValue{kClearColor}};
+
+    const vk::RenderPassBeginInfo renderPassInfo = {
+        .renderPass = target.renderPass,
+        .framebuffer = target.framebuffer,
+        .renderArea = {
+            .offset = {0, 0},
+            .extent = target.extent,
+        },
+        .clearValueCount = 1,
+        .pClearValues = &clearValue,
+    };
+
+    cmdBuf.beginRenderPass(renderPassInfo, vk::SubpassContents::eInline);
+    cmdBuf.endRenderPass();
+
+    return cmdBuf.end();
+}
+
+vk::Result clearAndRead(Context& ctx, vk::CommandPool commandPool, RenderTarget& target,
+                        std::vector<uint8_t>& texels)
+{
+    vk::Device device = ctx.device();
+
+    // One buffer for the clear, one for the readback, which resets its own
+    std::array<vk::CommandBuffer, 2> commandBuffers;
+    {
+        const vk::CommandBufferAllocateInfo allocInfo = {
+            .commandPool = commandPool,
+            .level = vk::CommandBufferLevel::ePrimary,
+            .commandBufferCount = static_cast<uint32_t>(commandBuffers.size()),
+        };
+
+        const auto [res, handle] = device.allocateCommandBuffers(allocInfo);
+        if (res != vk::Result::eSuccess)
+        {
+            return res;
+        }
+
+        for (size_t i = 0; i < commandBuffers.size(); ++i)
+        {
+            commandBuffers[i] = handle[i];
+        }
+    }
+
+    {
+        const auto res = recordClear(commandBuffers[0], target);
+        if (res != vk::Result::eSuccess)
+        {
+            return res;
+        }
+    }
+
+    {
+        const vk::SubmitInfo submitInfo = {
+            .commandBufferCount = 1,
+            .pCommandBuffers = &commandBuffers[0],
+        };
+
+        const auto res = ctx.graphicsQueue().submit(submitInfo);
+        if (res != vk::Result::eSuccess)
+        {
+            return res;
+        }
+    }
+
+    return readRenderTarget(&ctx, commandBuffers[1], target, texels.data());
+}
+
+bool checkTexel(const std::vector<uint8_t>& texels, uint32_t x, uint32_t y)
+{
+    const size_t offset = (size_t{y} * kExtent.width + x) * kExpectedTexel.size();
+    if (std::memcmp(texels.data() + offset, kExpectedTexel.data(), kExpectedTexel.size()) == 0)
+    {
+        return true;
+    }
+
+    std::printf("texel (%u, %u) is %u %u %u %u, expected %u %u %u %u\n", x, y, texels[offset],
+                texels[offset + 1], texels[offset + 2], texels[offset + 3], kExpectedTexel[0],
+                kExpectedTexel[1], kExpectedTexel[2], kExpectedTexel[3]);
+    return false;
+}
+}  // namespace
+
+int main()
+{
+    Context ctx;
+    {
+        const ContextCreateInfo createInfo = {
+            .headless = true,
+        };
+
+        const auto res = ctx.init(&createInfo);
+        if (res != vk::Result::eSuccess)
+        {
+            std::printf("No headless Vulkan device (%s), skipping\n",
+                        vk::to_string(res).c_str());
+            return kSkipped;
+        }
+    }
+
+    RenderTarget target;
+    {
+        const RenderTargetCreateInfo createInfo = {
+            .extent = kExtent,
+        };
+
+        const auto res = createRenderTarget(&ctx, &createInfo, target);
+        if (res != vk::Result::eSuccess)
+        {
+            std::printf("createRenderTarget failed: %s\n", vk::to_string(res).c_str());
+            ctx.destroy();
+            return 1;
+        }
+    }
+
+    vk::CommandPool commandPool;
+    {
+        const vk::CommandPoolCreateInfo poolInfo = {
+            .flags = vk::CommandPoolCreateFlagBits::eResetCommandBuffer,
+            .queueFamilyIndex = ctx.graphicsQueueIdx(),
+        };
+
+        const auto [res, handle] = ctx.device().createCommandPool(poolInfo);
+        if (res != vk::Result::eSuccess)
+        {
+            std::printf("createCommandPool failed: %s\n", vk::to_string(res).c_str());
+            destroyRenderTarget(&ctx, target);
+            ctx.destroy();
+            return 1;
+        }
+
+        commandPool = handle;
+    }
+
+    std::vector<uint8_t> texels(kExtent.width * kExtent.height * kExpectedTexel.size());
+    const auto res = clearAndRead(ctx, commandPool, target, texels);
+
+    bool passed = res == vk::Result::eSuccess;
+    if (passed)
+    {
+        passed = checkTexel(texels, 0, 0);
+        passed = checkTexel(texels, kExtent.width - 1, kExtent.height - 1) && passed;
+    }
+    else
+    {
+        std::printf("Clear and readback failed: %s\n", vk::to_string(res).c_str());
+    }
+
+    // Work may still be pending when the clear or readback submission failed half way
+    (void)ctx.device().waitIdle();
+    ctx.device().destroyCommandPool(commandPool);
+    destroyRenderTarget(&ctx, target);
+    ctx.destroy();
+
+    if (!passed)
+    {
+        return 1;
+    }
+
+    std::printf("Headless clear and readback passed\n");
+    return 0;
+}
@@ -0,0 +1,143 @@
+/*
+ * Checks the specialized inverses against the generic inverse on random transforms. Both the
+ * mat4 overloads (SIMD when enabled) and the generic templates are tested, the process exits
+ * non-zero on the first mismatch.
+ */
+
+#include "math/math.h"
+
+#include <cmath>
+#include <cstdio>
+#include <random>
+
+using namespace pyroc::math;
+
+namespace
+{
+constexpr int kIterations = 1000;
+constexpr float kTolerance = 1e-4f;
+
+int gFailures = 0;
+
+struct Transforms
+{
+    mat4 rigid;
+    mat4 affine;
+};
+
+Transforms randomTransforms(std::mt19937& rng)
+{
+    std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+    std::uniform_real_distribution<float> angle(-3.14159f, 3.14159f);
+    std::uniform_real_distribution<float> scale(0.25f, 4.0f);
+    std::uniform_real_distribution<float> offset(-50.0f, 50.0f);
+
+    const vec3 axis = normalize(vec3{unit(rng), unit(rng), unit(rng) + 2.0f});
+
+    Transforms transforms;
+    transforms.rigid = toMat4(angleAxis(angle(rng), axis));
+    transforms.rigid[3] = vec4{offset(rng), offset(rng), offset(rng), 1.0f};
+
+    // Non-uniform scale and a shear, so the basis is no longer orthonormal
+    transforms.affine = transforms.rigid;
+    for (size_t i = 0; i < 3; ++i)
+    {
+        const float s = scale(rng);
+        for (size_t j = 0; j < 3; ++j)
+        {
+            transforms.affine[i][j] *= s;
+        }
+    }
+    for (size_t j = 0; j < 3; ++j)
+    {
+        transforms.affine[1][j] += 0.5f * transforms.affine[0][j];
+    }
+
+    return transforms;
+}
+
+bool nearlyEqual(const mat4& a, const mat4& b)
+{
+    for (size_t i = 0; i < 4; ++i)
+    {
+        for (size_t j = 0; j < 4; ++j)
+        {
+            const float magnitude =
+                std::fmax(1.0f, std::fmax(std::fabs(a[i][j]), std::fabs(b[i][j])));
+            if (std::fabs(a[i][j] - b[i][j]) > kTolerance * magnitude)
+            {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+void check(const char* name, int iteration, const mat4& actual, const mat4& expected)
+{
+    if (nearlyEqual(actual, expected))
+    {
+        return;
+    }
+
+    ++gFailures;
+    std::printf("FAILED %s, iteration %d\n", name, iteration);
+    for (size_t j = 0; j < 4; ++j)
+    {
+        std::printf("  %10.5f %10.5f %10.5f %10.5f    %10.5f %10.5f %10.5f %10.5f\n",
+                    static_cast<double>(actual[0][j]), static_cast<double>(actual[1][j]),
+                    static_cast<double>(actual[2][j]), static_cast<double>(actual[3][j]),
+                    static_cast<double>(expected[0][j]), static_cast<double>(expected[1][j]),
+                    static_cast<double>(expected[2][j]), static_cast<double>(expected[3][j]));
+    }
+}
+
+// Upper 3x3 of transpose(inverse(m)), the translation row and column cleared
+mat4 normalMatrix(const mat4& m)
+{
+    mat4 result = transpose(inverse<float>(m));
+    for (size_t i = 0; i < 3; ++i)
+    {
+        result[i][3] = 0.0f;
+        result[3][i] = 0.0f;
+    }
+    result[3][3] = 1.0f;
+    return result;
+}
+}  // namespace
+
+int main()
+{
+    std::mt19937 rng(1234);
+
+    for (int i = 0; i < kIterations; ++i)
+    {
+        const Transforms transforms = randomTransforms(rng);
+        const mat4 rigid = inverse<float>(transforms.rigid);
+        const mat4 affine = inverse<float>(transforms.affine);
+        const mat4 normal = normalMatrix(transforms.affine);
+
+        check("inverse", i, inverse(transforms.affine), affine);
+        check("inverseRigid", i, inverseRigid(transforms.rigid), rigid);
+        check("inverseRigid<float>", i, inverseRigid<float>(transforms.rigid), rigid);
+        check("inverseAffine", i, inverseAffine(transforms.affine), affine);
+        check("inverseAffine<float>", i, inverseAffine<float>(transforms.affine), affine);
+        check("inverseTranspose", i, inverseTranspose(transforms.affine), normal);
+        check("inverseTranspose<float>", i, inverseTranspose<float>(transforms.affine), normal);
+    }
+
+    // Singular bases produce a zero matrix rather than infinities
+    mat4 singular = mat4::identity();
+    singular[2] = vec4{0.0f, 0.0f, 0.0f, 0.0f};
+    check("inverseAffine singular", 0, inverseAffine(singular), mat4{});
+    check("inverseTranspose singular", 0, inverseTranspose(singular), mat4{});
+
+    if (gFailures != 0)
+    {
+        std::printf("%d checks failed\n", gFailures);
+        return 1;
+    }
+
+    std::printf("All checks passed\n");
+    return 0;
+}
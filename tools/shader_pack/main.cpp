@@ -0,0 +1,302 @@
+/*
+ * Packs compiled SPIR-V into one shader archive, see backend/vulkan/shader_archive_format.h.
+ *
+ * usage: shader_pack <archive> <root directory> <spirv files...>
+ *
+ * A shader's name is its path relative to the root with the last extension dropped, so
+ * shaders/basic.vert.bin under shaders/ is "basic.vert". The stage and entry point name come from
+ * the binary's OpEntryPoint.
+ */
+
+#include "backend/vulkan/shader_archive_format.h"
+#include "util/hash.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+using namespace pyroc::backend::vulkan;
+
+namespace
+{
+constexpr uint32_t kSpirvMagic = 0x07230203;
+
+// Magic, version, generator, bound and schema words
+constexpr size_t kSpirvHeaderWords = 5;
+constexpr uint32_t kOpEntryPoint = 15;
+
+struct Shader
+{
+    std::string name;
+    std::string entryPoint;
+    std::vector<char> code;
+    uint32_t stage = 0;
+};
+
+bool readFile(const std::filesystem::path& path, std::vector<char>& data)
+{
+    std::ifstream file(path, std::ios::ate | std::ios::binary);
+
+    if (!file.is_open())
+    {
+        return false;
+    }
+
+    const auto fileSize = static_cast<std::streamsize>(file.tellg());
+    data.resize(static_cast<size_t>(fileSize));
+    file.seekg(0);
+    file.read(data.data(), fileSize);
+
+    return static_cast<bool>(file);
+}
+
+// VkShaderStageFlagBits of a SPIR-V execution model, zero when it has no Vulkan stage
+uint32_t stageFromExecutionModel(uint32_t executionModel)
+{
+    struct Stage
+    {
+        uint32_t executionModel;
+        uint32_t stage;
+    };
+
+    constexpr Stage kStages[] = {
+        {0, 0x01},       // Vertex
+        {1, 0x02},       // TessellationControl
+        {2, 0x04},       // TessellationEvaluation
+        {3, 0x08},       // Geometry
+        {4, 0x10},       // Fragment
+        {5, 0x20},       // GLCompute
+        {5267, 0x40},    // TaskNV
+        {5268, 0x80},    // MeshNV
+        {5313, 0x100},   // RayGenerationKHR
+        {5314, 0x1000},  // IntersectionKHR
+        {5315, 0x200},   // AnyHitKHR
+        {5316, 0x400},   // ClosestHitKHR
+        {5317, 0x800},   // MissKHR
+        {5318, 0x2000},  // CallableKHR
+        {5364, 0x40},    // TaskEXT
+        {5365, 0x80},    // MeshEXT
+    };
+
+    for (const Stage& stage : kStages)
+    {
+        if (stage.executionModel == executionModel)
+        {
+            return stage.stage;
+        }
+    }
+
+    return 0;
+}
+
+/*
+ * Reads the stage and name of the first OpEntryPoint, returns false when the binary has none or
+ * it is malformed. Further entry points are counted in entryPointCount.
+ */
+bool readEntryPoint(const std::vector<char>& code, Shader& shader, uint32_t& entryPointCount)
+{
+    std::vector<uint32_t> words(code.size() / sizeof(uint32_t));
+    std::memcpy(words.data(), code.data(), words.size() * sizeof(uint32_t));
+
+    entryPointCount = 0;
+    for (size_t i = kSpirvHeaderWords; i < words.size();)
+    {
+        const uint32_t wordCount = words[i] >> 16;
+        const uint32_t opcode = words[i] & 0xffff;
+        if (wordCount == 0 || i + wordCount > words.size())
+        {
+            return false;
+        }
+
+        // Execution model, function id, then the nul terminated name
+        if (opcode == kOpEntryPoint && wordCount >= 4 && entryPointCount++ == 0)
+        {
+            const auto* pName = reinterpret_cast<const char*>(&words[i + 3]);
+            const size_t maxLength = (wordCount - 3) * sizeof(uint32_t);
+
+            shader.stage = stageFromExecutionModel(words[i + 1]);
+            shader.entryPoint.assign(pName, strnlen(pName, maxLength));
+        }
+
+        i += wordCount;
+    }
+
+    return entryPointCount > 0;
+}
+
+uint32_t alignUp(uint32_t value, uint32_t alignment)
+{
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+
+uint32_t addString(std::vector<char>& strings, std::string_view value)
+{
+    const auto offset = static_cast<uint32_t>(strings.size());
+    strings.insert(strings.end(), value.begin(), value.end());
+    strings.push_back('\0');
+    return offset;
+}
+}  // namespace
+
+int main(int argc, char** argv)
+{
+    if (argc < 3)
+    {
+        std::fprintf(stderr, "usage: %s <archive> <root directory> <spirv files...>\n", argv[0]);
+        return 1;
+    }
+
+    const std::filesystem::path archivePath = argv[1];
+    const std::filesystem::path root = argv[2];
+
+    std::vector<Shader> shaders;
+    shaders.reserve(static_cast<size_t>(argc - 3));
+
+    for (int i = 3; i < argc; ++i)
+    {
+        const std::filesystem::path path = argv[i];
+
+        Shader shader;
+        shader.name = path.lexically_relative(root).replace_extension().generic_string();
+
+        if (!readFile(path, shader.code))
+        {
+            std::fprintf(stderr, "%s: failed to read\n", argv[i]);
+            return 1;
+        }
+
+        uint32_t magic = 0;
+        if (shader.code.size() >= sizeof(magic))
+        {
+            std::memcpy(&magic, shader.code.data(), sizeof(magic));
+        }
+
+        if (magic != kSpirvMagic || shader.code.size() % sizeof(uint32_t) != 0)
+        {
+            std::fprintf(stderr, "%s: not a SPIR-V binary\n", argv[i]);
+            return 1;
+        }
+
+        uint32_t entryPointCount = 0;
+        if (!readEntryPoint(shader.code, shader, entryPointCount))
+        {
+            std::fprintf(stderr, "%s: no entry point\n", argv[i]);
+            return 1;
+        }
+
+        if (shader.stage == 0)
+        {
+            std::fprintf(stderr, "%s: entry point %s has no Vulkan shader stage\n", argv[i],
+                         shader.entryPoint.c_str());
+            return 1;
+        }
+
+        if (entryPointCount > 1)
+        {
+            std::fprintf(stderr, "%s: %u entry points, only %s is packed\n", argv[i],
+                         entryPointCount, shader.entryPoint.c_str());
+        }
+
+        shaders.push_back(std::move(shader));
+    }
+
+    std::vector<ShaderArchiveEntry> entries;
+    entries.reserve(shaders.size());
+
+    std::vector<char> strings;
+
+    // Most shaders share "main"
+    std::unordered_map<std::string, uint32_t> entryPointOffsets;
+
+    for (const Shader& shader : shaders)
+    {
+        auto [it, inserted] = entryPointOffsets.try_emplace(shader.entryPoint, 0);
+        if (inserted)
+        {
+            it->second = addString(strings, shader.entryPoint);
+        }
+
+        const ShaderArchiveEntry entry = {
+            .nameHash = pyroc::util::hashBytes(shader.name.data(), shader.name.size()),
+            .contentHash = pyroc::util::hashBytes(shader.code.data(), shader.code.size()),
+            .nameOffset = addString(strings, shader.name),
+            .entryPointOffset = it->second,
+            .dataOffset = 0,
+            .dataSize = static_cast<uint32_t>(shader.code.size()),
+            .stage = shader.stage,
+            .reserved = 0,
+        };
+        entries.push_back(entry);
+    }
+
+    const ShaderArchiveHeader header = {
+        .magic = kShaderArchiveMagic,
+        .version = kShaderArchiveVersion,
+        .entryCount = static_cast<uint32_t>(entries.size()),
+        .stringTableOffset = static_cast<uint32_t>(sizeof(ShaderArchiveHeader)
+                                                   + entries.size() * sizeof(ShaderArchiveEntry)),
+        .stringTableSize = static_cast<uint32_t>(strings.size()),
+        .reserved = 0,
+    };
+
+    // Lay out the blobs, binaries shared between names are stored once
+    std::vector<char> data;
+    const uint32_t dataStart
+        = alignUp(header.stringTableOffset + header.stringTableSize, kShaderArchiveDataAlignment);
+
+    for (size_t i = 0; i < entries.size(); ++i)
+    {
+        ShaderArchiveEntry& entry = entries[i];
+
+        for (size_t j = 0; j < i; ++j)
+        {
+            if (entries[j].contentHash == entry.contentHash
+                && shaders[j].code == shaders[i].code)
+            {
+                entry.dataOffset = entries[j].dataOffset;
+                break;
+            }
+        }
+
+        if (entry.dataOffset == 0)
+        {
+            data.resize(alignUp(static_cast<uint32_t>(data.size()), kShaderArchiveDataAlignment));
+            entry.dataOffset = dataStart + static_cast<uint32_t>(data.size());
+            data.insert(data.end(), shaders[i].code.begin(), shaders[i].code.end());
+        }
+    }
+
+    std::sort(entries.begin(), entries.end(),
+              [](const ShaderArchiveEntry& a, const ShaderArchiveEntry& b)
+              { return a.nameHash < b.nameHash; });
+
+    std::ofstream file(archivePath, std::ios::binary | std::ios::trunc);
+    if (!file.is_open())
+    {
+        std::fprintf(stderr, "%s: failed to open for writing\n", argv[1]);
+        return 1;
+    }
+
+    const std::vector<char> padding(dataStart - header.stringTableOffset - header.stringTableSize);
+
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(entries.data()),
+               static_cast<std::streamsize>(entries.size() * sizeof(ShaderArchiveEntry)));
+    file.write(strings.data(), static_cast<std::streamsize>(strings.size()));
+    file.write(padding.data(), static_cast<std::streamsize>(padding.size()));
+    file.write(data.data(), static_cast<std::streamsize>(data.size()));
+
+    if (!file)
+    {
+        std::fprintf(stderr, "%s: failed to write\n", argv[1]);
+        return 1;
+    }
+
+    return 0;
+}